@@ -87,11 +87,140 @@ extern "C"
 	void ggkLogRegisterAlways(GGKLogReceiver receiver);
 	void ggkLogRegisterTrace(GGKLogReceiver receiver);
 
+	// Asynchronous log delivery (disabled by default)
+	//
+	// Normally, log receivers are called on whichever thread is logging, which includes the server's D-Bus thread. When async
+	// delivery is enabled, log messages are instead queued in a fixed-size ring and delivered, in order, by a background thread, so
+	// a slow receiver never blocks the server. Messages longer than 511 characters are truncated. If the ring fills up, further
+	// messages are dropped (see `ggkLogDropCount()`) until the background thread catches up.
+	//
+	// Disabling async delivery delivers any queued messages before returning.
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkLogSetAsync(int enabled);
+
+	// Returns 1 if async log delivery is enabled, otherwise 0
+	int ggkLogGetAsync();
+
+	// Returns the number of log messages that were dropped because the async ring was full
+	unsigned long long ggkLogDropCount();
+
+	// When enabled, messages delivered asynchronously are prefixed with the local time at which they were logged and the ID of the
+	// thread that logged them (ex: "2019-01-01 12:00:00.000123 [1234] Server started".) Disabled by default.
+	void ggkLogSetAsyncStamping(int enabled);
+
     void ggkServerRegisterBrand( const char * brand );
     void ggkServerRegisterDeviceModel( const char * model );
     void ggkServerRegisterSenderChar( const char * ch );
     void ggkServerRegisterReceiverCB( const char * ch, GGKMessageReceived receivedCB );
-    void ggkServerSendMessage( const char * message, int size );
+
+	// Outbound messages
+	//
+	// Messages sent with `ggkServerSendMessage()` are copied into a pooled buffer and queued; the server thread then sends them,
+	// in order, on the registered sender characteristic. Each queued message is identified by a positive message ID, and its
+	// outcome is reported to the send-complete callback (if one is registered):
+	//
+	//     EMessageSent      - the message was handed to BlueZ
+	//     EMessageFailed    - the message could not be sent
+	//     EMessageCancelled - the message was discarded before it was sent (ex: the server is shutting down)
+	enum GGKMessageStatus
+	{
+		EMessageSent,
+		EMessageFailed,
+		EMessageCancelled
+	};
+
+	// Type definition for the callback that receives each outbound message's completion status
+	//
+	// This is called from the server's thread.
+	typedef void (*GGKMessageSendComplete)(int messageId, enum GGKMessageStatus status);
+
+	// Queues a message for sending
+	//
+	// Messages may be up to 512 bytes, or up to 65535 bytes with framing enabled (see `ggkServerSetFraming()`.) A framed message
+	// takes one queue buffer per 512 bytes and must fit within the send queue's depth, so if the depth is lowered below its default
+	// (see `ggkServerSetSendQueueDepth()`) the largest message is 512 bytes times the depth.
+	//
+	// Returns the message's ID (a positive value) on success or 0 on failure (the message is empty, too large for framing or for
+	// the send queue's depth, the queue is at its maximum depth or there are no active connections.)
+	int ggkServerSendMessage( const char * message, int size );
+
+	// Registers the callback that receives each outbound message's completion status. To unregister, register with `nullptr`.
+	void ggkServerRegisterSendCompleteCB( GGKMessageSendComplete completeCB );
+
+	// Sets/gets the maximum number of outbound messages that may wait to be sent (1 to 256, default 128)
+	//
+	// The queue is made of 512-byte buffers and a larger (framed) message takes one buffer per 512 bytes, so the depth is really a
+	// limit on buffers. It also limits the size of a single message: the default depth holds one framed message of the largest
+	// size.
+	void ggkServerSetSendQueueDepth( int depth );
+	int ggkServerGetSendQueueDepth();
+
+	// Returns the number of outbound message buffers waiting to be sent
+	int ggkServerSendQueueSize();
+
+	// Message framing
+	//
+	// A single ATT write or indication carries at most MTU-3 bytes. With framing enabled, outbound messages are split into
+	// fragments that fit the connection's current MTU and inbound fragments are reassembled into whole messages before they are
+	// passed to the receiver callback. Both ends must speak the same framing, so it is disabled by default.
+	//
+	// Each fragment starts with a one-byte header:
+	//
+	//     bit 7    - START: the first fragment of a message
+	//     bit 6    - END: the last fragment of a message
+	//     bits 0-5 - sequence number (0 for the START fragment, incrementing by one per fragment and wrapping at 64)
+	//
+	// A START fragment follows its header with the message's total length (two bytes, little-endian.) The rest of each fragment is
+	// payload. A message that fits in one fragment has both START and END set.
+	void ggkServerSetFraming(int enabled);
+	int ggkServerGetFraming();
+
+	// Framing counters
+	//
+	// Byte counts are payload bytes (excluding fragment headers.) `elapsedUS` is the time since the counters were last reset, for
+	// computing throughput.
+	struct GGKFramingStats
+	{
+		unsigned long long messagesSent;
+		unsigned long long fragmentsSent;
+		unsigned long long bytesSent;
+		unsigned long long messagesReceived;
+		unsigned long long fragmentsReceived;
+		unsigned long long bytesReceived;
+		unsigned long long reassemblyErrors;
+		unsigned long long elapsedUS;
+	};
+
+	// Retrieves/resets the framing counters
+	void ggkServerGetFramingStats(struct GGKFramingStats *pStats);
+	void ggkServerResetFramingStats();
+
+	// Indication flow control
+	//
+	// Messages are sent as indications, each of which the central must confirm. Rather than handing BlueZ everything at once (where
+	// it queues up out of reach) the server keeps a limited number of indications awaiting confirmation and sends more as
+	// confirmations arrive. A larger window keeps the link busier; a smaller one keeps less data committed to BlueZ.
+	//
+	// Confirmations require BlueZ 5.42 or later. If none arrive, flow control turns itself off until they do.
+
+	// Type definition for the callback that receives each outbound message's latency
+	//
+	// `latencyUS` is the time from when the message was queued until the central confirmed its last indication. This is called
+	// from the server's thread, after the message's send-complete callback.
+	typedef void (*GGKMessageConfirmed)(int messageId, unsigned int latencyUS);
+
+	// Registers the callback that receives each outbound message's latency. To unregister, register with `nullptr`.
+	void ggkServerRegisterSendConfirmedCB( GGKMessageConfirmed confirmedCB );
+
+	// Sets/gets the number of indications that may await confirmation at once (1 to 32, default 4)
+	//
+	// While more than one device is connected, only one indication awaits confirmation at a time, whatever the window.
+	void ggkServerSetIndicationWindow( int window );
+	int ggkServerGetIndicationWindow();
+
+	// Returns the number of indications currently awaiting confirmation
+	int ggkServerIndicationsInFlight();
 
 	typedef const void *(*GGKServerDataGetter)(const char *pName);
 
@@ -129,6 +258,78 @@ extern "C"
 	// Removes all entries from the queue
 	void ggkUpdateQueueClear();
 
+	// The update queue is bounded. When an update is pushed onto a full queue, the overflow policy determines which update is
+	// discarded:
+	//
+	//     EDropNewest - the incoming update is rejected (the push returns 0)
+	//     EDropOldest - the oldest pending update is discarded to make room for the incoming update
+	enum GGKUpdateQueueOverflowPolicy
+	{
+		EDropNewest,
+		EDropOldest
+	};
+
+	// Sets the update queue's overflow policy (the default is EDropNewest)
+	void ggkUpdateQueueSetOverflowPolicy(enum GGKUpdateQueueOverflowPolicy policy);
+
+	// Returns the update queue's overflow policy
+	enum GGKUpdateQueueOverflowPolicy ggkUpdateQueueGetOverflowPolicy();
+
+	// Returns the maximum number of entries the queue can hold
+	int ggkUpdateQueueCapacity();
+
+	// Returns the number of updates that have been discarded because the queue was full
+	unsigned long long ggkUpdateQueueDropCount();
+
+	// Updates are processed on the server thread in batches. These set/get the maximum number of updates processed per batch
+	// (1 to 256, default 32.) Larger batches drain bursts with fewer main loop iterations, smaller ones interleave D-Bus traffic
+	// more finely.
+	void ggkUpdateQueueSetBatchSize(int batchSize);
+	int ggkUpdateQueueGetBatchSize();
+
+	// Retrieves the batch latency histogram: the time from the push of the oldest update in a batch until the batch has been
+	// processed. Bucket 0 counts batches under 2us, bucket n counts [2^n, 2^(n+1)) microseconds and the last bucket counts all
+	// longer batches.
+	//
+	// Up to `bucketCount` buckets are copied into `pBuckets`. Returns the number of buckets copied (at most 16.)
+	int ggkUpdateQueueGetLatencyHistogram(unsigned long long *pBuckets, int bucketCount);
+
+	// Update coalescing (disabled by default)
+	//
+	// When enabled, an update for an object path/interface that already has an update waiting in the queue is collapsed into the
+	// waiting one, so the value that is eventually sent is always the freshest and the queue holds at most one entry per
+	// characteristic.
+	void ggkUpdateQueueSetCoalescing(int enabled);
+	int ggkUpdateQueueGetCoalescing();
+
+	// Returns the number of updates that were collapsed into an already-waiting update
+	unsigned long long ggkUpdateQueueCoalescedCount();
+
+	// Sets the minimum interval, in milliseconds, between updates for the characteristic at the given object path (0 = no limit)
+	//
+	// Only applies when coalescing is enabled. Updates arriving sooner are held back and sent, once, when the interval expires.
+	//
+	// Returns non-zero value on success or 0 on failure (for example, if there is no characteristic at the given path.)
+	int ggkSetMinNotifyInterval(const char *pObjectPath, int intervalMS);
+
+	// Sets the minimum interval, in milliseconds, between updates for the named interface at the given object path (0 = no limit)
+	//
+	// This is the general form of `ggkSetMinNotifyInterval()`, for interfaces other than characteristics (ex: descriptors.)
+	//
+	// Returns non-zero value on success or 0 on failure (for example, if the object has no such interface.)
+	int ggkSetMinUpdateInterval(const char *pObjectPath, const char *pInterfaceName, int intervalMS);
+
+	// Subtree registration (disabled by default)
+	//
+	// Normally each interface of each object is registered with D-Bus individually, which for a large GATT database means hundreds
+	// of registrations at startup. With subtree registration enabled, the server registers a handful of D-Bus subtrees instead and
+	// describes its objects to D-Bus only as they are used, so startup time and memory no longer grow with the number of
+	// characteristics.
+	//
+	// This takes effect the next time the server registers its objects, so it should be called before `ggkStart()`.
+	void ggkSetSubtreeRegistration(int enabled);
+	int ggkGetSubtreeRegistration();
+
 	int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char *pAdvertisingShortName, 
 		GGKServerDataGetter getter, GGKServerDataSetter setter, int maxAsyncInitTimeoutMS, const RawAdvertisingData &advData);
 
@@ -184,6 +385,63 @@ extern "C"
 	// Convert a `GGKServerHealth` into a human-readable string
 	const char *ggkGetServerHealthString(enum GGKServerHealth state);
 
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// CONNECTIONS
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// Information about an active connection
+	//
+	// Connection parameters are only known once the peer has requested them, and the MTU once the peer has written to the
+	// server; until then they are 0. Outbound bytes are counted against every connected peer, since notifications and indications
+	// go to every subscriber.
+	struct GGKConnectionInfo
+	{
+		char address[18];                   // The peer's address ("AA:BB:CC:DD:EE:FF")
+		int addressType;                    // 0 = BR/EDR, 1 = LE public, 2 = LE random
+		long long connectTimeMS;            // When the connection was made (milliseconds since the epoch)
+		int mtu;                            // The ATT MTU
+		int minIntervalUS;                  // The connection interval range (microseconds)
+		int maxIntervalUS;
+		int latency;                        // The peripheral latency (connection events)
+		int supervisionTimeoutMS;           // The supervision timeout (milliseconds)
+		unsigned long long bytesIn;         // GATT payload bytes received from the peer
+		unsigned long long bytesOut;        // GATT payload bytes sent to the peer
+	};
+
+	// Returns the number of active connections
+	int ggkGetConnectionCount();
+
+	// Fills `pConnections` with up to `maxConnections` active connections, returning the number filled
+	//
+	// This may be called from any thread and never blocks.
+	int ggkGetConnections(struct GGKConnectionInfo *pConnections, int maxConnections);
+
+	// Fills `pConnection` with the connection to the peer with the given address ("AA:BB:CC:DD:EE:FF")
+	//
+	// Returns non-zero if the peer is connected, otherwise 0.
+	int ggkGetConnection(const char *pAddress, struct GGKConnectionInfo *pConnection);
+
+	// -----------------------------------------------------------------------------------------------------------------------------
+	// ADVERTISING
+	// -----------------------------------------------------------------------------------------------------------------------------
+
+	// The largest number of advertising instances (instances are numbered from 1; instance 1 carries the data given to ggkStart)
+	#define GGK_MAX_ADVERTISING_INSTANCES 5
+
+	// Sets the advertising and scan response data of an advertising instance, adding the instance if it doesn't exist
+	//
+	// The data is updated in place, without powering the adapter off, so connections are unaffected and an update costs a single
+	// round trip to the kernel (none if the data hasn't changed.) With several instances, the kernel rotates through them,
+	// advertising each for `durationS` seconds (0 for the kernel's default.)
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkSetAdvertisingInstance(int instance, const RawAdvertisingData *pData, int durationS);
+
+	// Removes an advertising instance (or every instance, if `instance` is 0)
+	//
+	// Returns non-zero value on success or 0 on failure.
+	int ggkRemoveAdvertisingInstance(int instance);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
@@ -36,4 +36,10 @@ elseif(CC_TARGET_ESP32)
 elseif(CC_TARGET_ESP8266)
     add_compile_definitions(CC_PLATFORM_ESP8266=1)
 endif()
-    
\ No newline at end of file
+    
+# GGK_LOG_LEVEL
+# Compile-time minimum log level. Log statements below this level are compiled out entirely (see Logger.h). Release builds
+# typically use INFO to strip DEBUG and TRACE logging.
+set(GGK_LOG_LEVEL "TRACE" CACHE STRING "Minimum log level compiled in (TRACE, DEBUG, INFO, STATUS, WARN, ERROR, FATAL)")
+set_property(CACHE GGK_LOG_LEVEL PROPERTY STRINGS TRACE DEBUG INFO STATUS WARN ERROR FATAL)
+add_compile_definitions(GGK_LOG_LEVEL=GGK_LOG_LEVEL_${GGK_LOG_LEVEL})
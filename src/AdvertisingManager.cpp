@@ -0,0 +1,149 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Manages the adapter's advertising instances, updating their data in place while the adapter is running
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The kernel keeps a set of advertising instances, each with its own advertising and scan response data. Sending Add Advertising
+// for an instance that already exists replaces its data in place, while the adapter stays powered and connected. So an
+// application that rotates its payload (sensor readings in manufacturer data, for example) pays one mgmt round trip per update,
+// and nothing else.
+//
+// With more than one instance, the kernel rotates through them itself, advertising each for its duration in turn, so rotating
+// between several payloads needs no timers here.
+//
+// We remember what we last sent for each instance and skip updates that wouldn't change anything. Updates are serialized so that
+// this record always matches the order in which the kernel saw the commands.
+//
+// The kernel also has an Add Extended Advertising Data command that replaces only the data of an instance. Its command code is
+// beyond the range this server knows about (see HciAdapter::kMaxCommandCode), and Add Advertising already updates in place in a
+// single round trip, so we don't use it.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <string.h>
+
+#include "AdvertisingManager.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Our constructor marks every instance unused
+AdvertisingManager::AdvertisingManager()
+: mgmt(Mgmt::kDefaultControllerIndex, false)
+{
+	forget();
+}
+
+// Returns true if `instance` already holds exactly this data
+bool AdvertisingManager::matches(const Instance &instance, const uint8_t *pAdvData, uint8_t advDataLength, const uint8_t *pScanResponse, uint8_t scanResponseLength, uint16_t durationS)
+{
+	return instance.active && instance.durationS == durationS &&
+		instance.advDataLength == advDataLength && (0 == advDataLength || 0 == memcmp(instance.advData, pAdvData, advDataLength)) &&
+		instance.scanResponseLength == scanResponseLength &&
+		(0 == scanResponseLength || 0 == memcmp(instance.scanResponse, pScanResponse, scanResponseLength));
+}
+
+// Sets the advertising and scan response data of advertising instance `instance` (1 to kMaxInstances), adding the instance if it
+// doesn't exist
+//
+// With several instances, the kernel rotates through them, advertising each for `durationS` seconds (0 for its default.) The
+// data is updated in place with a single mgmt command, without powering the adapter off; if nothing has changed since the last
+// successful update, no command is sent at all.
+//
+// Returns true on success, otherwise false
+bool AdvertisingManager::setInstance(uint8_t instance, const uint8_t *pAdvData, uint8_t advDataLength, const uint8_t *pScanResponse, uint8_t scanResponseLength, uint16_t durationS)
+{
+	if (instance < 1 || instance > kMaxInstances)
+	{
+		GGK_LOG_WARN(SSTR << "Advertising instance " << static_cast<int>(instance) << " is out of range (1 to " << kMaxInstances << ")");
+		return false;
+	}
+
+	if (advDataLength > Mgmt::kMaxAdvertisingDataLength || scanResponseLength > Mgmt::kMaxAdvertisingDataLength ||
+		(advDataLength > 0 && nullptr == pAdvData) || (scanResponseLength > 0 && nullptr == pScanResponse))
+	{
+		GGK_LOG_WARN(SSTR << "Invalid advertising data for instance " << static_cast<int>(instance));
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Instance &current = instances[instance - 1];
+	if (matches(current, pAdvData, advDataLength, pScanResponse, scanResponseLength, durationS))
+	{
+		return true;
+	}
+
+	// Until we hear otherwise, we don't know what the instance holds
+	current.active = false;
+
+	if (!mgmt.addAdvertising(instance, 0, durationS, 0, pAdvData, advDataLength, pScanResponse, scanResponseLength))
+	{
+		return false;
+	}
+
+	current.active = true;
+	current.durationS = durationS;
+	current.advDataLength = advDataLength;
+	current.scanResponseLength = scanResponseLength;
+	if (advDataLength > 0) { memcpy(current.advData, pAdvData, advDataLength); }
+	if (scanResponseLength > 0) { memcpy(current.scanResponse, pScanResponse, scanResponseLength); }
+
+	return true;
+}
+
+// Removes advertising instance `instance` (1 to kMaxInstances), or every instance if `instance` is 0
+//
+// Returns true on success, otherwise false
+bool AdvertisingManager::removeInstance(uint8_t instance)
+{
+	if (instance > kMaxInstances)
+	{
+		GGK_LOG_WARN(SSTR << "Advertising instance " << static_cast<int>(instance) << " is out of range (1 to " << kMaxInstances << ")");
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!mgmt.removeAdvertising(instance))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < kMaxInstances; ++i)
+	{
+		if (0 == instance || i == instance - 1)
+		{
+			instances[i].active = false;
+		}
+	}
+
+	return true;
+}
+
+// Forgets what we last sent for every instance, so that the next update of each is sent even if it hasn't changed
+//
+// Used when the adapter is (re)configured, since its instances may no longer match what we sent.
+void AdvertisingManager::forget()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int i = 0; i < kMaxInstances; ++i)
+	{
+		instances[i].active = false;
+	}
+}
+
+}; // namespace ggk
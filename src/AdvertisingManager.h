@@ -0,0 +1,106 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Manages the adapter's advertising instances, updating their data in place while the adapter is running
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of AdvertisingManager.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+
+#include "../include/Gobbledegook.h"
+#include "Mgmt.h"
+
+namespace ggk {
+
+struct AdvertisingManager
+{
+	//
+	// Constants
+	//
+
+	// The largest number of advertising instances we manage (instances are numbered from 1)
+	static const int kMaxInstances = GGK_MAX_ADVERTISING_INSTANCES;
+
+	// The instance used for the advertising data given to `ggkStart()`
+	static const uint8_t kDefaultInstance = 1;
+
+	//
+	// Accessors
+	//
+
+	// Returns the instance to this singleton class
+	static AdvertisingManager &getInstance()
+	{
+		static AdvertisingManager instance;
+		return instance;
+	}
+
+	// Sets the advertising and scan response data of advertising instance `instance` (1 to kMaxInstances), adding the instance if
+	// it doesn't exist
+	//
+	// With several instances, the kernel rotates through them, advertising each for `durationS` seconds (0 for its default.) The
+	// data is updated in place with a single mgmt command, without powering the adapter off; if nothing has changed since the
+	// last successful update, no command is sent at all.
+	//
+	// Returns true on success, otherwise false
+	bool setInstance(uint8_t instance, const uint8_t *pAdvData, uint8_t advDataLength, const uint8_t *pScanResponse, uint8_t scanResponseLength, uint16_t durationS);
+
+	// Removes advertising instance `instance` (1 to kMaxInstances), or every instance if `instance` is 0
+	//
+	// Returns true on success, otherwise false
+	bool removeInstance(uint8_t instance);
+
+	// Forgets what we last sent for every instance, so that the next update of each is sent even if it hasn't changed
+	//
+	// Used when the adapter is (re)configured, since its instances may no longer match what we sent.
+	void forget();
+
+private:
+
+	// Our constructor marks every instance unused
+	AdvertisingManager();
+
+	// What we last sent successfully for an instance
+	struct Instance
+	{
+		bool active;
+		uint16_t durationS;
+		uint8_t advDataLength;
+		uint8_t scanResponseLength;
+		uint8_t advData[Mgmt::kMaxAdvertisingDataLength];
+		uint8_t scanResponse[Mgmt::kMaxAdvertisingDataLength];
+	};
+
+	// Returns true if `instance` already holds exactly this data
+	static bool matches(const Instance &instance, const uint8_t *pAdvData, uint8_t advDataLength, const uint8_t *pScanResponse, uint8_t scanResponseLength, uint16_t durationS);
+
+	// Serializes updates, so that our record of each instance follows the order in which the commands were sent
+	std::mutex mutex;
+
+	// Our mgmt interface
+	//
+	// This doesn't sync the adapter: updates only send commands, and the adapter is synced when it is configured
+	Mgmt mgmt;
+
+	Instance instances[kMaxInstances];
+};
+
+}; // namespace ggk
@@ -0,0 +1,291 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// An optional asynchronous backend for the Logger: a lock-free ring of log records drained by a background thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// By default, the Logger calls the application's log receivers directly, on whatever thread is logging. That includes the GLib
+// main loop (which dispatches D-Bus calls) and the HciAdapter event thread, so a slow receiver stalls the server. With the
+// asynchronous backend enabled (see `ggkLogSetAsync()`), the Logger instead copies each message into a record in this ring and
+// returns immediately. A background drain thread delivers the records, in order, to the receivers registered for their levels.
+//
+// The ring works the same way as the UpdateQueue: a fixed array of records, each tagged with a sequence number. Producers claim a
+// position with a compare-and-swap and publish the record by advancing its sequence; the drain thread does the reverse. Logging
+// takes no locks and allocates nothing. If the ring is full the message is discarded and `dropCount` is incremented - a logger
+// that blocks would defeat the purpose.
+//
+// Since messages are delivered some time after they were logged (and from another thread), each record carries the time it was
+// logged and the kernel ID of the thread that logged it. With stamping enabled these are prepended to the delivered message.
+//
+// The drain thread sleeps on an eventfd. As with the UpdateQueue, only the first message after the drain thread wakes actually
+// writes to the eventfd, so a burst of logging costs a single system call.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <chrono>
+
+#include "AsyncLogger.h"
+
+namespace ggk {
+
+// True while the drain thread is running and the Logger should route messages through the ring
+std::atomic<bool> AsyncLogger::active(false);
+
+// Returns the kernel thread ID of the calling thread
+static long currentThreadId()
+{
+	static thread_local long threadId = static_cast<long>(syscall(SYS_gettid));
+	return threadId;
+}
+
+// Our constructor initializes the sequence numbers for each record in the ring
+AsyncLogger::AsyncLogger()
+: enqueuePos(0), dequeuePos(0), dropCount(0), stamping(false), stopRequested(false), wakeFd(-1), wakePending(false)
+{
+	for (size_t i = 0; i < kCapacity; ++i)
+	{
+		records[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// The drain thread blocks on reads, so this descriptor is not non-blocking
+	wakeFd = eventfd(0, EFD_CLOEXEC);
+	if (wakeFd < 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to create async logger eventfd: " << strerror(errno));
+	}
+}
+
+// Our destructor stops the drain thread and closes the wakeup descriptor
+AsyncLogger::~AsyncLogger()
+{
+	stop();
+
+	if (drainThread.joinable() && drainThread.get_id() != std::this_thread::get_id())
+	{
+		drainThread.join();
+	}
+
+	if (wakeFd >= 0)
+	{
+		close(wakeFd);
+		wakeFd = -1;
+	}
+}
+
+// Starts the drain thread
+//
+// Returns true if the drain thread is running on return
+bool AsyncLogger::start()
+{
+	std::lock_guard<std::mutex> lock(controlMutex);
+
+	if (active.load(std::memory_order_acquire))
+	{
+		return true;
+	}
+
+	if (wakeFd < 0)
+	{
+		return false;
+	}
+
+	// Reap a drain thread that was stopped from within a receiver
+	if (drainThread.joinable())
+	{
+		drainThread.join();
+	}
+
+	try
+	{
+		stopRequested.store(false, std::memory_order_release);
+		drainThread = std::thread(&AsyncLogger::runDrainThread, this);
+	}
+	catch(std::system_error &ex)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to start async logger thread: " << ex.what());
+		return false;
+	}
+
+	active.store(true, std::memory_order_release);
+	return true;
+}
+
+// Stops the drain thread, delivering any messages still in the ring on the calling thread before returning
+void AsyncLogger::stop()
+{
+	std::lock_guard<std::mutex> lock(controlMutex);
+
+	if (!active.exchange(false, std::memory_order_acq_rel))
+	{
+		return;
+	}
+
+	stopRequested.store(true, std::memory_order_release);
+	wakePending.exchange(false, std::memory_order_acq_rel);
+	wake();
+
+	// A receiver may turn off async logging from the drain thread itself. It can't join itself, so it just finishes its current
+	// pass and exits; the thread is joined by the next start() (or our destructor.)
+	if (drainThread.get_id() == std::this_thread::get_id())
+	{
+		return;
+	}
+
+	if (drainThread.joinable())
+	{
+		drainThread.join();
+	}
+
+	// Deliver anything that was pushed after the drain thread's last pass
+	while (deliverOne()) {}
+}
+
+// Signal the drain thread that messages are waiting
+void AsyncLogger::wake()
+{
+	if (wakeFd < 0 || wakePending.exchange(true, std::memory_order_acq_rel))
+	{
+		return;
+	}
+
+	// We can't log a failure here without recursing into ourselves, and a failure just means the drain thread picks this message
+	// up on its next wakeup
+	uint64_t one = 1;
+	if (write(wakeFd, &one, sizeof(one)) < 0) {}
+}
+
+// Adds a message to the ring for delivery by the drain thread
+//
+// This method is safe to call from any number of threads concurrently and never blocks. Returns false (and increments the drop
+// counter) if the ring is full.
+bool AsyncLogger::push(Logger::LogLevel level, const char *pText)
+{
+	size_t pos = enqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Record &record = records[pos & kMask];
+		size_t seq = record.sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				record.level = level;
+				record.timestampUS = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+				record.threadId = currentThreadId();
+
+				size_t length = strlen(pText);
+				if (length < kMaxMessageLength)
+				{
+					memcpy(record.text, pText, length + 1);
+				}
+				else
+				{
+					memcpy(record.text, pText, kMaxMessageLength - 4);
+					memcpy(record.text + kMaxMessageLength - 4, "...", 4);
+				}
+
+				record.sequence.store(pos + 1, std::memory_order_release);
+				wake();
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			// The record still holds a message from the previous lap - we're full
+			dropCount.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+// Removes the oldest record from the ring and delivers it to the receiver registered for its level
+//
+// Returns false if the ring was empty
+bool AsyncLogger::deliverOne()
+{
+	size_t pos = dequeuePos.load(std::memory_order_relaxed);
+	Record &record = records[pos & kMask];
+	size_t seq = record.sequence.load(std::memory_order_acquire);
+	if (seq != pos + 1)
+	{
+		return false;
+	}
+
+	// The receiver is looked up at delivery time so that unregistering a receiver takes effect for messages still in the ring
+	GGKLogReceiver receiver = Logger::getReceiver(record.level);
+	if (nullptr != receiver)
+	{
+		if (getStamping())
+		{
+			char stamped[kMaxMessageLength + 64];
+			time_t seconds = static_cast<time_t>(record.timestampUS / 1000000);
+			struct tm local;
+			localtime_r(&seconds, &local);
+
+			size_t prefixLength = strftime(stamped, sizeof(stamped), "%Y-%m-%d %H:%M:%S", &local);
+			snprintf(stamped + prefixLength, sizeof(stamped) - prefixLength, ".%06d [%ld] %s",
+				static_cast<int>(record.timestampUS % 1000000), record.threadId, record.text);
+			receiver(stamped);
+		}
+		else
+		{
+			receiver(record.text);
+		}
+	}
+
+	dequeuePos.store(pos + 1, std::memory_order_relaxed);
+	record.sequence.store(pos + kCapacity, std::memory_order_release);
+	return true;
+}
+
+// Entry point for the drain thread
+void AsyncLogger::runDrainThread()
+{
+	while (true)
+	{
+		// Sleep until there's something to deliver (or we're asked to stop)
+		uint64_t count;
+		if (read(wakeFd, &count, sizeof(count)) < 0 && errno != EINTR)
+		{
+			break;
+		}
+
+		// As in UpdateQueue::acknowledgeWake(), clearing the flag with an exchange guarantees that any message whose push saw the
+		// flag still set is visible to the pass below
+		wakePending.exchange(false, std::memory_order_acq_rel);
+
+		while (deliverOne()) {}
+
+		if (stopRequested.load(std::memory_order_acquire))
+		{
+			break;
+		}
+	}
+}
+
+}; // namespace ggk
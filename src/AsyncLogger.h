@@ -0,0 +1,170 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// An optional asynchronous backend for the Logger: a lock-free ring of log records drained by a background thread
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of AsyncLogger.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+
+#include "Logger.h"
+
+namespace ggk {
+
+struct AsyncLogger
+{
+	//
+	// Constants
+	//
+
+	// The number of log records the ring can hold
+	//
+	// This must be a power of two
+	static const size_t kCapacity = 1024;
+
+	// The maximum length of a single log message, including the terminator
+	//
+	// Longer messages are truncated (and end with "...")
+	static const size_t kMaxMessageLength = 512;
+
+	//
+	// Types
+	//
+
+	// A single log record within the ring
+	//
+	// The sequence number tells producers and the drain thread whether the record is free to write (sequence == position) or holds
+	// a message ready to be delivered (sequence == position + 1). The remaining fields are only touched by whoever currently owns
+	// the record, as decided by the sequence number.
+	struct Record
+	{
+		std::atomic<size_t> sequence;
+		Logger::LogLevel level;
+
+		// Wall-clock time (in microseconds since the epoch) at which the message was logged
+		int64_t timestampUS;
+
+		// Kernel thread ID of the thread that logged the message
+		long threadId;
+
+		char text[kMaxMessageLength];
+	};
+
+	//
+	// Accessors
+	//
+
+	// Returns the instance to this singleton class
+	static AsyncLogger &getInstance()
+	{
+		static AsyncLogger instance;
+		return instance;
+	}
+
+	// Returns true if the asynchronous backend is accepting messages
+	//
+	// This is static so that the Logger can check it on every log without constructing the (fairly large) instance.
+	static bool isActive() { return active.load(std::memory_order_acquire); }
+
+	// Returns the number of log messages that were discarded because the ring was full
+	uint64_t getDropCount() const { return dropCount.load(std::memory_order_relaxed); }
+
+	// Returns true if delivered messages are prefixed with the time they were logged and the ID of the thread that logged them
+	bool getStamping() const { return stamping.load(std::memory_order_relaxed); }
+
+	// Enables or disables the timestamp/thread ID prefix on delivered messages
+	void setStamping(bool enabled) { stamping.store(enabled, std::memory_order_relaxed); }
+
+	//
+	// Control
+	//
+
+	// Starts the drain thread
+	//
+	// Returns true if the drain thread is running on return
+	bool start();
+
+	// Stops the drain thread, delivering any messages still in the ring on the calling thread before returning
+	void stop();
+
+	//
+	// Logging
+	//
+
+	// Adds a message to the ring for delivery by the drain thread
+	//
+	// This method is safe to call from any number of threads concurrently and never blocks. Returns false (and increments the drop
+	// counter) if the ring is full.
+	bool push(Logger::LogLevel level, const char *pText);
+
+private:
+
+	// Our constructor initializes the sequence numbers for each record in the ring
+	AsyncLogger();
+
+	// Our destructor stops the drain thread and closes the wakeup descriptor
+	~AsyncLogger();
+
+	// Removes the oldest record from the ring and delivers it to the receiver registered for its level
+	//
+	// Returns false if the ring was empty
+	bool deliverOne();
+
+	// Entry point for the drain thread
+	void runDrainThread();
+
+	// Signal the drain thread that messages are waiting
+	void wake();
+
+	static const size_t kMask = kCapacity - 1;
+
+	// Our ring of records
+	Record records[kCapacity];
+
+	// The next position to write (shared by all producers)
+	alignas(64) std::atomic<size_t> enqueuePos;
+
+	// The next position to read (drain thread only)
+	alignas(64) std::atomic<size_t> dequeuePos;
+
+	// Statistics and configuration
+	std::atomic<uint64_t> dropCount;
+	std::atomic<bool> stamping;
+
+	// Our drain thread and its state
+	//
+	// `controlMutex` serializes start() and stop(); it is never taken while logging.
+	std::mutex controlMutex;
+	std::thread drainThread;
+	std::atomic<bool> stopRequested;
+
+	// True while the drain thread is running and the Logger should route messages through the ring
+	static std::atomic<bool> active;
+
+	// Our wakeup eventfd and whether a wakeup is already pending on it
+	int wakeFd;
+	std::atomic<bool> wakePending;
+};
+
+}; // namespace ggk
@@ -0,0 +1,329 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A fixed-size table of the adapter's active connections, readable from any thread without locking
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// The HciAdapter's event thread sees every connection and disconnection (and any connection parameters a peer requests) and
+// records them here. The server thread adds what only it knows: each peer's ATT MTU and how much data has gone each way. The
+// application reads the table from its own threads (see `ggkGetConnections()`) to route and rate-limit messages per peer.
+//
+// None of these should wait on the others, so the table is a fixed array of slots made entirely of atomics. The fields that
+// describe a connection are only written by the event thread and are guarded by a per-slot seqlock, so a reader always sees a
+// consistent connection - never the address of one peer with the connect time of another that used the slot before it. The
+// MTU and byte counters can be updated from any thread; they're independent values and are read as they are.
+//
+// Slots are found by address. With a handful of connections at most, a linear scan is as fast as anything cleverer.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <string.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "ConnectionTable.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Our constructor marks every slot free
+ConnectionTable::ConnectionTable()
+: activeCount(0)
+{
+	for (int i = 0; i < kMaxConnections; ++i)
+	{
+		slots[i].sequence.store(0, std::memory_order_relaxed);
+		slots[i].key.store(0, std::memory_order_relaxed);
+		slots[i].connectTimeMS.store(0, std::memory_order_relaxed);
+		slots[i].parameters.store(0, std::memory_order_relaxed);
+		slots[i].mtu.store(0, std::memory_order_relaxed);
+		slots[i].bytesIn.store(0, std::memory_order_relaxed);
+		slots[i].bytesOut.store(0, std::memory_order_relaxed);
+	}
+}
+
+// Returns the key for an address and type
+uint64_t ConnectionTable::makeKey(const uint8_t *pAddress, uint8_t addressType)
+{
+	uint64_t key = 0;
+	for (int i = 5; i >= 0; --i)
+	{
+		key = (key << 8) | pAddress[i];
+	}
+
+	return kInUse | (static_cast<uint64_t>(addressType) << 48) | key;
+}
+
+// Returns the slot in use by the given address (ignoring the type if `matchType` is false), or nullptr
+ConnectionTable::Slot *ConnectionTable::findSlot(const uint8_t *pAddress, uint8_t addressType, bool matchType) const
+{
+	uint64_t wanted = makeKey(pAddress, addressType);
+	uint64_t mask = matchType ? ~0ULL : (kInUse | kAddressMask);
+
+	for (int i = 0; i < kMaxConnections; ++i)
+	{
+		if ((slots[i].key.load(std::memory_order_acquire) & mask) == (wanted & mask))
+		{
+			return &slots[i];
+		}
+	}
+
+	return nullptr;
+}
+
+// Adds a connection
+void ConnectionTable::connected(const uint8_t *pAddress, uint8_t addressType)
+{
+	// A peer that reconnects before we saw it disconnect keeps its slot (and is already counted); otherwise take a free one
+	Slot *pSlot = findSlot(pAddress, addressType, true);
+	if (nullptr == pSlot)
+	{
+		// Count the connection even if the table is too full to track it, to match the count of disconnections
+		activeCount.fetch_add(1, std::memory_order_release);
+	}
+
+	for (int i = 0; nullptr == pSlot && i < kMaxConnections; ++i)
+	{
+		if (0 == slots[i].key.load(std::memory_order_relaxed))
+		{
+			pSlot = &slots[i];
+		}
+	}
+
+	if (nullptr == pSlot)
+	{
+		GGK_LOG_WARN(SSTR << "Connection table is full; not tracking " << addressString(pAddress));
+		return;
+	}
+
+	int64_t nowMS = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	uint32_t sequence = pSlot->sequence.load(std::memory_order_relaxed);
+	pSlot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	pSlot->key.store(makeKey(pAddress, addressType), std::memory_order_relaxed);
+	pSlot->connectTimeMS.store(nowMS, std::memory_order_relaxed);
+	pSlot->parameters.store(0, std::memory_order_relaxed);
+	pSlot->mtu.store(0, std::memory_order_relaxed);
+	pSlot->bytesIn.store(0, std::memory_order_relaxed);
+	pSlot->bytesOut.store(0, std::memory_order_relaxed);
+
+	pSlot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Removes a connection, returning false if it wasn't in the table
+bool ConnectionTable::disconnected(const uint8_t *pAddress, uint8_t addressType)
+{
+	// Keep the count in step with the connection events, even for peers the table was too full to track
+	int count = activeCount.load(std::memory_order_relaxed);
+	while (count > 0 && !activeCount.compare_exchange_weak(count, count - 1, std::memory_order_release)) {}
+
+	Slot *pSlot = findSlot(pAddress, addressType, true);
+	if (nullptr == pSlot)
+	{
+		return false;
+	}
+
+	uint32_t sequence = pSlot->sequence.load(std::memory_order_relaxed);
+	pSlot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	pSlot->key.store(0, std::memory_order_relaxed);
+
+	pSlot->sequence.store(sequence + 2, std::memory_order_release);
+	return true;
+}
+
+// Records the connection parameters requested by a peer
+void ConnectionTable::parametersChanged(const uint8_t *pAddress, uint8_t addressType, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t supervisionTimeout)
+{
+	Slot *pSlot = findSlot(pAddress, addressType, true);
+	if (nullptr == pSlot)
+	{
+		return;
+	}
+
+	uint64_t parameters = static_cast<uint64_t>(minInterval)
+		| (static_cast<uint64_t>(maxInterval) << 16)
+		| (static_cast<uint64_t>(latency) << 32)
+		| (static_cast<uint64_t>(supervisionTimeout) << 48);
+
+	uint32_t sequence = pSlot->sequence.load(std::memory_order_relaxed);
+	pSlot->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	pSlot->parameters.store(parameters, std::memory_order_relaxed);
+
+	pSlot->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Records the ATT MTU for a peer (ignored if the peer isn't connected)
+void ConnectionTable::setMtu(const uint8_t *pAddress, uint16_t mtu)
+{
+	Slot *pSlot = findSlot(pAddress, 0, false);
+	if (nullptr != pSlot && 0 != mtu)
+	{
+		pSlot->mtu.store(mtu, std::memory_order_relaxed);
+	}
+}
+
+// Adds to the bytes received from a peer (ignored if the peer isn't connected)
+void ConnectionTable::addBytesIn(const uint8_t *pAddress, uint64_t count)
+{
+	Slot *pSlot = findSlot(pAddress, 0, false);
+	if (nullptr != pSlot)
+	{
+		pSlot->bytesIn.fetch_add(count, std::memory_order_relaxed);
+	}
+}
+
+// Adds to the bytes sent to every connected peer
+//
+// Notifications and indications go to every subscriber, so outbound bytes are counted against each connection.
+void ConnectionTable::addBytesOut(uint64_t count)
+{
+	for (int i = 0; i < kMaxConnections; ++i)
+	{
+		if (0 != slots[i].key.load(std::memory_order_relaxed))
+		{
+			slots[i].bytesOut.fetch_add(count, std::memory_order_relaxed);
+		}
+	}
+}
+
+// Copies a slot into a snapshot, returning false if the slot is (or became) free
+bool ConnectionTable::readSlot(const Slot &slot, Connection &connection)
+{
+	uint64_t key;
+	uint64_t parameters;
+	uint32_t before;
+	uint32_t after;
+
+	do
+	{
+		before = slot.sequence.load(std::memory_order_acquire);
+		key = slot.key.load(std::memory_order_relaxed);
+		connection.connectTimeMS = slot.connectTimeMS.load(std::memory_order_relaxed);
+		parameters = slot.parameters.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		after = slot.sequence.load(std::memory_order_relaxed);
+	} while (0 != (before & 1) || before != after);
+
+	if (0 == key)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		connection.address[i] = static_cast<uint8_t>((key >> (i * 8)) & 0xff);
+	}
+	connection.addressType = static_cast<uint8_t>((key >> 48) & 0xff);
+	connection.minInterval = static_cast<uint16_t>(parameters & 0xffff);
+	connection.maxInterval = static_cast<uint16_t>((parameters >> 16) & 0xffff);
+	connection.latency = static_cast<uint16_t>((parameters >> 32) & 0xffff);
+	connection.supervisionTimeout = static_cast<uint16_t>((parameters >> 48) & 0xffff);
+	connection.mtu = slot.mtu.load(std::memory_order_relaxed);
+	connection.bytesIn = slot.bytesIn.load(std::memory_order_relaxed);
+	connection.bytesOut = slot.bytesOut.load(std::memory_order_relaxed);
+	return true;
+}
+
+// Copies up to `maxCount` connections into `pConnections`, returning the number copied
+int ConnectionTable::snapshot(Connection *pConnections, int maxCount) const
+{
+	int copied = 0;
+	for (int i = 0; i < kMaxConnections && copied < maxCount; ++i)
+	{
+		if (readSlot(slots[i], pConnections[copied]))
+		{
+			++copied;
+		}
+	}
+
+	return copied;
+}
+
+// Copies the connection to the peer with the given address (of any type) into `connection`, returning false if not connected
+bool ConnectionTable::find(const uint8_t *pAddress, Connection &connection) const
+{
+	const Slot *pSlot = findSlot(pAddress, 0, false);
+	return nullptr != pSlot && readSlot(*pSlot, connection) && 0 == memcmp(connection.address, pAddress, 6);
+}
+
+// Parses a BlueZ device object path (ex: "/org/bluez/hci0/dev_AA_BB_CC_DD_EE_FF") into an address
+//
+// Returns false if the path doesn't end with a device element
+bool ConnectionTable::addressFromDevicePath(const char *pPath, uint8_t *pAddress)
+{
+	if (nullptr == pPath)
+	{
+		return false;
+	}
+
+	const char *pDevice = strstr(pPath, "/dev_");
+	if (nullptr == pDevice || strlen(pDevice) != 22)
+	{
+		return false;
+	}
+
+	// The path holds the address most significant byte first, separated by underscores
+	unsigned int bytes[6];
+	if (6 != sscanf(pDevice, "/dev_%2x_%2x_%2x_%2x_%2x_%2x", &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0]))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		pAddress[i] = static_cast<uint8_t>(bytes[i]);
+	}
+
+	return true;
+}
+
+// Parses a colon-separated address (ex: "AA:BB:CC:DD:EE:FF"), returning false if it is malformed
+bool ConnectionTable::addressFromString(const char *pString, uint8_t *pAddress)
+{
+	if (nullptr == pString || strlen(pString) != 17)
+	{
+		return false;
+	}
+
+	unsigned int bytes[6];
+	if (6 != sscanf(pString, "%2x:%2x:%2x:%2x:%2x:%2x", &bytes[5], &bytes[4], &bytes[3], &bytes[2], &bytes[1], &bytes[0]))
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 6; ++i)
+	{
+		pAddress[i] = static_cast<uint8_t>(bytes[i]);
+	}
+
+	return true;
+}
+
+// Returns an address in its conventional colon-separated form (most significant byte first)
+std::string ConnectionTable::addressString(const uint8_t *pAddress)
+{
+	char text[18];
+	snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X",
+		pAddress[5], pAddress[4], pAddress[3], pAddress[2], pAddress[1], pAddress[0]);
+	return text;
+}
+
+}; // namespace ggk
@@ -0,0 +1,165 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A fixed-size table of the adapter's active connections, readable from any thread without locking
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of ConnectionTable.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+namespace ggk {
+
+struct ConnectionTable
+{
+	//
+	// Constants
+	//
+
+	// The largest number of connections we track at once
+	static const int kMaxConnections = 8;
+
+	//
+	// Types
+	//
+
+	// A snapshot of one connection
+	struct Connection
+	{
+		// The peer's address, in the order the Bluetooth Management API uses (least significant byte first), and its type
+		// (0 = BR/EDR, 1 = LE public, 2 = LE random)
+		uint8_t address[6];
+		uint8_t addressType;
+
+		// Wall-clock time (in milliseconds since the epoch) at which the connection was made
+		int64_t connectTimeMS;
+
+		// The ATT MTU, or 0 until BlueZ reports it
+		uint16_t mtu;
+
+		// The connection parameters most recently requested by the peer (in the Bluetooth units: 1.25ms intervals and 10ms
+		// timeout), or 0 until it requests some
+		uint16_t minInterval;
+		uint16_t maxInterval;
+		uint16_t latency;
+		uint16_t supervisionTimeout;
+
+		// GATT payload bytes received from and sent to the peer
+		uint64_t bytesIn;
+		uint64_t bytesOut;
+	};
+
+	// Our constructor marks every slot free
+	ConnectionTable();
+
+	//
+	// Event thread (the only writer of connections and their parameters)
+	//
+
+	// Adds a connection
+	void connected(const uint8_t *pAddress, uint8_t addressType);
+
+	// Removes a connection, returning false if it wasn't in the table
+	bool disconnected(const uint8_t *pAddress, uint8_t addressType);
+
+	// Records the connection parameters requested by a peer
+	void parametersChanged(const uint8_t *pAddress, uint8_t addressType, uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t supervisionTimeout);
+
+	//
+	// Any thread
+	//
+
+	// Records the ATT MTU for a peer (ignored if the peer isn't connected)
+	void setMtu(const uint8_t *pAddress, uint16_t mtu);
+
+	// Adds to the bytes received from a peer (ignored if the peer isn't connected)
+	void addBytesIn(const uint8_t *pAddress, uint64_t count);
+
+	// Adds to the bytes sent to every connected peer
+	//
+	// Notifications and indications go to every subscriber, so outbound bytes are counted against each connection.
+	void addBytesOut(uint64_t count);
+
+	// Returns the number of active connections
+	int count() const { return activeCount.load(std::memory_order_acquire); }
+
+	// Copies up to `maxCount` connections into `pConnections`, returning the number copied
+	int snapshot(Connection *pConnections, int maxCount) const;
+
+	// Copies the connection to the peer with the given address (of any type) into `connection`, returning false if not connected
+	bool find(const uint8_t *pAddress, Connection &connection) const;
+
+	//
+	// Address helpers
+	//
+
+	// Parses a BlueZ device object path (ex: "/org/bluez/hci0/dev_AA_BB_CC_DD_EE_FF") into an address
+	//
+	// Returns false if the path doesn't end with a device element
+	static bool addressFromDevicePath(const char *pPath, uint8_t *pAddress);
+
+	// Parses a colon-separated address (ex: "AA:BB:CC:DD:EE:FF"), returning false if it is malformed
+	static bool addressFromString(const char *pString, uint8_t *pAddress);
+
+	// Returns an address in its conventional colon-separated form (most significant byte first)
+	static std::string addressString(const uint8_t *pAddress);
+
+private:
+
+	// A slot in the table
+	//
+	// Everything is atomic so that readers on other threads never race with the event thread. `sequence` is a seqlock guarding the
+	// fields the event thread writes: it is odd while they are being rewritten, so a reader that sees it change (or odd) retries.
+	// The MTU and byte counters are updated by other threads and are read as they are.
+	struct Slot
+	{
+		std::atomic<uint32_t> sequence;
+
+		// The address (low 48 bits), address type (next 8 bits) and an in-use bit (kInUse), or 0 for a free slot
+		std::atomic<uint64_t> key;
+
+		std::atomic<int64_t> connectTimeMS;
+
+		// minInterval, maxInterval, latency and supervisionTimeout, 16 bits each
+		std::atomic<uint64_t> parameters;
+
+		std::atomic<uint16_t> mtu;
+		std::atomic<uint64_t> bytesIn;
+		std::atomic<uint64_t> bytesOut;
+	};
+
+	static const uint64_t kInUse = 1ULL << 63;
+	static const uint64_t kAddressMask = (1ULL << 48) - 1;
+
+	// Returns the key for an address and type
+	static uint64_t makeKey(const uint8_t *pAddress, uint8_t addressType);
+
+	// Returns the slot in use by the given address (ignoring the type if `matchType` is false), or nullptr
+	Slot *findSlot(const uint8_t *pAddress, uint8_t addressType, bool matchType) const;
+
+	// Copies a slot into a snapshot, returning false if the slot is (or became) free
+	static bool readSlot(const Slot &slot, Connection &connection);
+
+	mutable Slot slots[kMaxConnections];
+	std::atomic<int> activeCount;
+};
+
+}; // namespace ggk
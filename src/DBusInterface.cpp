@@ -57,6 +57,10 @@ namespace ggk {
 DBusInterface::DBusInterface(DBusObject &owner, const std::string &name)
 : owner(owner), name(name)
 {
+	updateState.pending = UpdateState::ENotPending;
+	updateState.minIntervalMS = 0;
+	updateState.lastProcessedUS = 0;
+	updateState.deferredSourceId = 0;
 }
 
 DBusInterface::~DBusInterface()
@@ -91,13 +95,13 @@ DBusObject &DBusInterface::getOwner() const
 }
 
 // Returns the path node of this interface's owner
-DBusObjectPath DBusInterface::getPathNode() const
+const DBusObjectPath &DBusInterface::getPathNode() const
 {
 	return owner.getPathNode();
 }
 
 // Returns the full path of this interface's owner
-DBusObjectPath DBusInterface::getPath() const
+const DBusObjectPath &DBusInterface::getPath() const
 {
 	return owner.getPath();
 }
@@ -112,9 +116,23 @@ DBusObjectPath DBusInterface::getPath() const
 DBusInterface &DBusInterface::addMethod(const std::string &name, const char *pInArgs[], const char *pOutArgs, DBusMethod::Callback callback)
 {
 	methods.push_back(DBusMethod(this, name, pInArgs, pOutArgs, callback));
+
+	// The table is keyed on the method's own copy of its name, which lives as long as the method does. If a method is added twice,
+	// the first one wins (this matches the original linear search)
+	const DBusMethod *pMethod = &methods.back();
+	methodTable.insert(std::make_pair(pMethod->getName().c_str(), pMethod));
 	return *this;
 }
 
+// Finds a method by name in this interface's method table
+//
+// Returns the method, or nullptr if this interface has no method with the given name
+const DBusMethod *DBusInterface::findMethod(const char *pMethodName) const
+{
+	std::unordered_map<const char *, const DBusMethod *, Utils::CStringHash, Utils::CStringEqual>::const_iterator it = methodTable.find(pMethodName);
+	return it == methodTable.end() ? nullptr : it->second;
+}
+
 // Calls a named method on this interface
 //
 // This method returns false if the method could not be found, otherwise it returns true. Note that the return value is not related
@@ -122,18 +140,16 @@ DBusInterface &DBusInterface::addMethod(const std::string &name, const char *pIn
 //
 // NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
 // their subclass type.
-bool DBusInterface::callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
+bool DBusInterface::callMethod(const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-	for (const DBusMethod &method : methods)
+	const DBusMethod *pMethod = findMethod(pMethodName);
+	if (nullptr == pMethod)
 	{
-		if (methodName == method.getName())
-		{
-			method.call<DBusInterface>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
-			return true;
-		}
+		return false;
 	}
 
-	return false;
+	pMethod->call<DBusInterface>(pConnection, getPath(), getName(), pMethod->getName(), pParameters, pInvocation, pUserData);
+	return true;
 }
 
 // Add an event to this interface
@@ -151,6 +167,16 @@ DBusInterface &DBusInterface::onEvent(int tickFrequency, void *pUserData, TickEv
 	return *this;
 }
 
+// Adds an event that fires every `periodMS` milliseconds
+//
+// NOTE: As with `onEvent()`, subclasses are encouraged to overload this method for their own callback types.
+DBusInterface &DBusInterface::onTimerEvent(int periodMS, void *pUserData, TickEvent::Callback callback)
+{
+	events.push_back(TickEvent(this, 1, callback, pUserData));
+	events.back().setPeriodMS(periodMS);
+	return *this;
+}
+
 // Ticks each event within this interface
 //
 // For details on events, see TickEvent.cpp.
@@ -165,6 +191,15 @@ void DBusInterface::tickEvents(GDBusConnection *pConnection, void *pUserData) co
 	}
 }
 
+// Fires one of this interface's events (see TimerWheel.cpp)
+//
+// NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
+// their subclass type.
+void DBusInterface::fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const
+{
+	event.fire<DBusInterface>(getPath(), pConnection, pUserData);
+}
+
 // Internal method used to generate introspection XML used to describe our services on D-Bus
 std::string DBusInterface::generateIntrospectionXML(int depth) const
 {
@@ -193,4 +228,39 @@ std::string DBusInterface::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Internal method used to build the introspection data used to register our services on D-Bus
+//
+// This describes the same interface as `generateIntrospectionXML()`, but builds the structure directly rather than leaving GIO to
+// parse it from XML. The caller owns the returned reference.
+//
+// NOTE: Subclasses that describe more than methods should override this method, extending the base description.
+GDBusInterfaceInfo *DBusInterface::generateInterfaceInfo() const
+{
+	GDBusInterfaceInfo *pInterface = g_new0(GDBusInterfaceInfo, 1);
+	pInterface->ref_count = 1;
+	pInterface->name = g_strdup(getName().c_str());
+
+	// Member arrays are null-terminated
+	pInterface->methods = g_new0(GDBusMethodInfo *, methods.size() + 1);
+	int index = 0;
+	for (const DBusMethod &method : methods)
+	{
+		pInterface->methods[index++] = method.generateMethodInfo();
+	}
+
+	pInterface->signals = g_new0(GDBusSignalInfo *, 1);
+	pInterface->properties = g_new0(GDBusPropertyInfo *, 1);
+
+	return pInterface;
+}
+
+// Sets the minimum time between processed updates for this interface, in milliseconds (0 = no limit)
+//
+// This only takes effect when update coalescing is enabled (see `ggkUpdateQueueSetCoalescing`.)
+DBusInterface &DBusInterface::setMinUpdateInterval(int intervalMS)
+{
+	updateState.minIntervalMS = intervalMS < 0 ? 0 : intervalMS;
+	return *this;
+}
+
 }; // namespace ggk
\ No newline at end of file
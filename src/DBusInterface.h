@@ -25,9 +25,13 @@
 #include <gio/gio.h>
 #include <string>
 #include <list>
+#include <unordered_map>
+#include <atomic>
+#include <stdint.h>
 
 #include "TickEvent.h"
 #include "DBusMethod.h"
+#include "Utils.h"
 
 namespace ggk {
 
@@ -95,8 +99,8 @@ struct DBusInterface
 	//
 
 	DBusObject &getOwner() const;
-	DBusObjectPath getPathNode() const;
-	DBusObjectPath getPath() const;
+	const DBusObjectPath &getPathNode() const;
+	const DBusObjectPath &getPath() const;
 
 	//
 	// D-Bus interface methods
@@ -104,9 +108,14 @@ struct DBusInterface
 
 	DBusInterface &addMethod(const std::string &name, const char *pInArgs[], const char *pOutArgs, DBusMethod::Callback callback);
 
+	// Finds a method by name in this interface's method table
+	//
+	// Returns the method, or nullptr if this interface has no method with the given name
+	const DBusMethod *findMethod(const char *pMethodName) const;
+
 	// NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
 	// their subclass type.
-	virtual bool callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
+	virtual bool callMethod(const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
 
 	//
 	// Interface events (our home-grown poor-mans's method of allowing interfaces to do things periodically)
@@ -117,18 +126,78 @@ struct DBusInterface
 	// calls to chain.
 	DBusInterface &onEvent(int tickFrequency, void *pUserData, TickEvent::Callback callback);
 
+	// Adds an event that fires every `periodMS` milliseconds
+	//
+	// NOTE: As with `onEvent()`, subclasses are encouraged to overload this method for their own callback types.
+	DBusInterface &onTimerEvent(int periodMS, void *pUserData, TickEvent::Callback callback);
+
+	// Returns the events added to this interface
+	const std::list<TickEvent> &getEvents() const { return events; }
+
 	// NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
 	// their subclass type.
 	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
 
+	// Fires one of this interface's events (see TimerWheel.cpp)
+	//
+	// NOTE: Subclasses are encouraged to override this method in order to support different callback types that are specific to
+	// their subclass type.
+	virtual void fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const;
+
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	virtual std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to build the introspection data used to register our services on D-Bus
+	//
+	// This describes the same interface as `generateIntrospectionXML()`, but builds the structure directly rather than leaving GIO
+	// to parse it from XML. The caller owns the returned reference.
+	//
+	// NOTE: Subclasses that describe more than methods should override this method, extending the base description.
+	virtual GDBusInterfaceInfo *generateInterfaceInfo() const;
+
+	//
+	// Update coalescing (see UpdateQueue.cpp)
+	//
+
+	// Per-interface state used by the update queue when coalescing is enabled
+	struct UpdateState
+	{
+		// Where this interface's update stands: not pending, being queued by a push, or waiting in the queue to be processed
+		enum PendingState
+		{
+			ENotPending,
+			EPushing,
+			EQueued
+		};
+
+		// One of PendingState
+		std::atomic<int> pending;
+
+		// The minimum time between processed updates, in milliseconds (0 = no limit)
+		std::atomic<int> minIntervalMS;
+
+		// Monotonic time (in microseconds) of the last processed update (server thread only)
+		int64_t lastProcessedUS;
+
+		// GLib source ID of a deferred update, or 0 if none is scheduled (server thread only)
+		guint deferredSourceId;
+	};
+
+	// Returns the update state for this interface
+	UpdateState &getUpdateState() const { return updateState; }
+
+	// Sets the minimum time between processed updates for this interface, in milliseconds (0 = no limit)
+	//
+	// This only takes effect when update coalescing is enabled (see `ggkUpdateQueueSetCoalescing`.)
+	DBusInterface &setMinUpdateInterval(int intervalMS);
+
 protected:
 	DBusObject &owner;
 	std::string name;
 	std::list<DBusMethod> methods;
+	std::unordered_map<const char *, const DBusMethod *, Utils::CStringHash, Utils::CStringEqual> methodTable;
 	std::list<TickEvent> events;
+	mutable UpdateState updateState;
 };
 
 }; // namespace ggk
\ No newline at end of file
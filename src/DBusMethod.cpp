@@ -66,12 +66,22 @@ std::string DBusMethod::generateIntrospectionXML(int depth) const
 		xml += prefix + "  </arg>\n";
 	}
 
+	// Add our output arguments - the output signature may hold more than one complete type (ex: "hq"), each of which is a
+	// separate argument
 	const std::string &outArgs = getOutArgs();
-	if (!outArgs.empty())
+	const gchar *pOutArg = outArgs.c_str();
+	while (*pOutArg)
 	{
-		xml += prefix + "  <arg type='" + outArgs + "' direction='out'>\n";
+		const gchar *pEnd = nullptr;
+		if (!g_variant_type_string_scan(pOutArg, nullptr, &pEnd))
+		{
+			break;
+		}
+
+		xml += prefix + "  <arg type='" + std::string(pOutArg, pEnd) + "' direction='out'>\n";
 		xml += prefix + "    <annotation name='org.gtk.GDBus.C.ForceGVariant' value='true' />\n";
 		xml += prefix + "  </arg>\n";
+		pOutArg = pEnd;
 	}
 
 	xml += prefix + "</method>\n";
@@ -79,4 +89,54 @@ std::string DBusMethod::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Returns a new argument description with the given signature
+static GDBusArgInfo *newArgInfo(const std::string &signature)
+{
+	GDBusArgInfo *pArg = g_new0(GDBusArgInfo, 1);
+	pArg->ref_count = 1;
+	pArg->signature = g_strdup(signature.c_str());
+	return pArg;
+}
+
+// Internal method used to build the introspection data used to register our services on D-Bus
+//
+// This describes the same method as `generateIntrospectionXML()`, but builds the structure directly rather than leaving GIO to
+// parse it from XML. The caller owns the returned reference.
+GDBusMethodInfo *DBusMethod::generateMethodInfo() const
+{
+	// The output signature may hold more than one complete type (ex: "hq"), each of which is a separate argument
+	std::vector<std::string> outArgList;
+	const gchar *pOutArg = outArgs.c_str();
+	while (*pOutArg)
+	{
+		const gchar *pEnd = nullptr;
+		if (!g_variant_type_string_scan(pOutArg, nullptr, &pEnd))
+		{
+			break;
+		}
+
+		outArgList.push_back(std::string(pOutArg, pEnd));
+		pOutArg = pEnd;
+	}
+
+	GDBusMethodInfo *pMethod = g_new0(GDBusMethodInfo, 1);
+	pMethod->ref_count = 1;
+	pMethod->name = g_strdup(getName().c_str());
+
+	// Argument arrays are null-terminated
+	pMethod->in_args = g_new0(GDBusArgInfo *, inArgs.size() + 1);
+	for (size_t i = 0; i < inArgs.size(); ++i)
+	{
+		pMethod->in_args[i] = newArgInfo(inArgs[i]);
+	}
+
+	pMethod->out_args = g_new0(GDBusArgInfo *, outArgList.size() + 1);
+	for (size_t i = 0; i < outArgList.size(); ++i)
+	{
+		pMethod->out_args[i] = newArgInfo(outArgList[i]);
+	}
+
+	return pMethod;
+}
+
 }; // namespace ggk
\ No newline at end of file
@@ -90,18 +90,24 @@ struct DBusMethod
 		// This should never happen, but technically possible if instantiated with a nullptr for `callback`
 		if (!callback)
 		{
-			Logger::error(SSTR << "DBusMethod contains no callback: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
+			GGK_LOG_ERROR(SSTR << "DBusMethod contains no callback: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
 			g_dbus_method_invocation_return_dbus_error(pInvocation, kErrorNotImplemented.c_str(), "This method is not implemented");
 			return;
 		}
 
-		Logger::info(SSTR << "Calling method: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
+		GGK_LOG_INFO(SSTR << "Calling method: [" << path << "]:[" << interfaceName << "]:[" << methodName << "]");
 		callback(*static_cast<const T *>(pOwner), pConnection, methodName, pParameters, pInvocation, pUserData);
 	}
 
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to build the introspection data used to register our services on D-Bus
+	//
+	// This describes the same method as `generateIntrospectionXML()`, but builds the structure directly rather than leaving GIO to
+	// parse it from XML. The caller owns the returned reference.
+	GDBusMethodInfo *generateMethodInfo() const;
+
 private:
 	const DBusInterface *pOwner;
 	std::string name;
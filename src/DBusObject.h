@@ -66,7 +66,11 @@ struct DBusObject
 	// Returns the full path for this object within the hierarchy
 	//
 	// This method returns the full path. To get the current node, use `getPathNode()`
-	DBusObjectPath getPath() const;
+	//
+	// The full path is computed once, when the object is added to the hierarchy, so this is cheap to call. Objects live in
+	// node-based lists that never move their elements, so the returned path (and its `c_str()`) remains valid for the lifetime
+	// of the server.
+	const DBusObjectPath &getPath() const;
 
 	// Returns the parent object in the hierarchy
 	DBusObject &getParent();
@@ -91,6 +95,12 @@ struct DBusObject
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	std::string generateIntrospectionXML(int depth = 0) const;
 
+	// Internal method used to build the introspection data used to register our services on D-Bus
+	//
+	// This describes the same hierarchy as `generateIntrospectionXML()`, but builds the structures directly rather than leaving
+	// GIO to parse them from XML. The caller owns the returned reference and releases it with `g_dbus_node_info_unref()`.
+	GDBusNodeInfo *generateNodeInfo() const;
+
 	// Convenience functions to add a GATT service to the hierarchy
 	//
 	// We simply add a new child at the given path and add an interface configured as a GATT service to it using the given UUID.
@@ -103,10 +113,10 @@ struct DBusObject
 	//
 
 	// Finds an interface by name within this D-Bus object
-	std::shared_ptr<const DBusInterface> findInterface(const DBusObjectPath &path, const std::string &interfaceName, const DBusObjectPath &basePath = DBusObjectPath()) const;
+	std::shared_ptr<const DBusInterface> findInterface(const DBusObjectPath &path, const std::string &interfaceName) const;
 
 	// Finds a BlueZ method by name within the specified D-Bus interface
-	bool callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData, const DBusObjectPath &basePath = DBusObjectPath()) const;
+	bool callMethod(const DBusObjectPath &path, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
 
 	// Periodic timer tick propagation
 	void tickEvents(GDBusConnection *pConnection, void *pUserData = nullptr) const;
@@ -116,11 +126,15 @@ struct DBusObject
 	// -----------------------------------------------------------------------------------------------------------------------------
 
 	// Emits a signal on the bus from the given path, interface name and signal name, containing a GVariant set of parameters
-	void emitSignal(GDBusConnection *pBusConnection, const std::string &interfaceName, const std::string &signalName, GVariant *pParameters);
+	//
+	// Returns true if the signal was emitted
+	bool emitSignal(GDBusConnection *pBusConnection, const std::string &interfaceName, const std::string &signalName, GVariant *pParameters);
+	bool emitSignal(GDBusConnection *pBusConnection, const char *pInterfaceName, const char *pSignalName, GVariant *pParameters);
 
 private:
 	bool publish;
 	DBusObjectPath path;
+	DBusObjectPath fullPath;
 	InterfaceList interfaces;
 	std::list<DBusObject> children;
 	DBusObject *pParent;
@@ -22,6 +22,13 @@
 // in Server.cpp.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
+#include <gio/gunixfdlist.h>
+#include <glib-unix.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
 #include "GattCharacteristic.h"
 #include "GattDescriptor.h"
 #include "GattProperty.h"
@@ -29,6 +36,7 @@
 #include "DBusObject.h"
 #include "GattService.h"
 #include "Utils.h"
+#include "ServerUtils.h"
 #include "Logger.h"
 
 namespace ggk {
@@ -42,8 +50,31 @@ namespace ggk {
 // Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
 // in `GattService`.
 GattCharacteristic::GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name)
-: GattInterface(owner, name), service(service), pOnUpdatedValueFunc(nullptr)
+: GattInterface(owner, name), service(service), pOnUpdatedValueFunc(nullptr), pOnAcquiredWriteFunc(nullptr)
 {
+	notifyState.fd = -1;
+	notifyState.mtu = 0;
+	notifyState.watchId = 0;
+	notifyState.writableWatchId = 0;
+	notifyState.pConnection = nullptr;
+	writeState = notifyState;
+}
+
+// Our destructor closes any acquired sockets
+//
+// The server (and therefore this characteristic) is destroyed after the main loop has shut down, so there's nobody left to tell
+// about it and the socket watches have already gone with the main loop's context.
+GattCharacteristic::~GattCharacteristic()
+{
+	if (notifyState.fd >= 0)
+	{
+		close(notifyState.fd);
+	}
+
+	if (writeState.fd >= 0)
+	{
+		close(writeState.fd);
+	}
 }
 
 // Returning the owner pops us one level up the hierarchy
@@ -55,18 +86,16 @@ GattService &GattCharacteristic::gattCharacteristicEnd()
 }
 
 // Locates a D-Bus method within this D-Bus interface and invokes the method
-bool GattCharacteristic::callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
+bool GattCharacteristic::callMethod(const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-	for (const DBusMethod &method : methods)
+	const DBusMethod *pMethod = findMethod(pMethodName);
+	if (nullptr == pMethod)
 	{
-		if (methodName == method.getName())
-		{
-			method.call<GattCharacteristic>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
-			return true;
-		}
+		return false;
 	}
 
-	return false;
+	pMethod->call<GattCharacteristic>(pConnection, getPath(), getName(), pMethod->getName(), pParameters, pInvocation, pUserData);
+	return true;
 }
 
 // Adds an event to the characteristic and returns a refereence to 'this` to enable method chaining in the server description
@@ -79,6 +108,16 @@ GattCharacteristic &GattCharacteristic::onEvent(int tickFrequency, void *pUserDa
 	return *this;
 }
 
+// Adds an event that fires every `periodMS` milliseconds and returns a reference to 'this` to enable method chaining
+//
+// NOTE: As with `onEvent()`, we overload this method in order to accept our custom EventCallback type.
+GattCharacteristic &GattCharacteristic::onTimerEvent(int periodMS, void *pUserData, EventCallback callback)
+{
+	events.push_back(TickEvent(this, 1, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
+	events.back().setPeriodMS(periodMS);
+	return *this;
+}
+
 // Ticks events within this characteristic
 //
 // Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
@@ -90,6 +129,14 @@ void GattCharacteristic::tickEvents(GDBusConnection *pConnection, void *pUserDat
 	}
 }
 
+// Fires one of this characteristic's events
+//
+// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
+void GattCharacteristic::fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const
+{
+	event.fire<GattCharacteristic>(getPath(), pConnection, pUserData);
+}
+
 // Specialized support for ReadlValue method
 //
 // Defined as: array{byte} ReadValue(dict options)
@@ -106,6 +153,24 @@ GattCharacteristic &GattCharacteristic::onReadValue(MethodCallback callback)
 	return *this;
 }
 
+// Specialized support for Characteristic Confirm method
+//
+// Defined as: void Confirm() [noreply]
+//
+// D-Bus breakdown:
+//
+//     Input args:  void
+//     Output args: void
+//
+// BlueZ calls this each time a client confirms an indication sent through this characteristic (whether it was sent as a
+// PropertiesChanged signal or through an acquired notification socket.) It does not say which client confirmed it.
+GattCharacteristic &GattCharacteristic::onConfirm(MethodCallback callback)
+{
+	static const char *inArgs[] = {nullptr};
+	addMethod("Confirm", inArgs, nullptr, reinterpret_cast<DBusMethod::Callback>(callback));
+	return *this;
+}
+
 // Specialized support for WriteValue method
 //
 // Defined as: void WriteValue(array{byte} value, dict options)
@@ -138,6 +203,360 @@ GattCharacteristic &GattCharacteristic::onUpdatedValue(UpdatedValueCallback call
 	return *this;
 }
 
+// Enables BlueZ's AcquireNotify method for this characteristic
+//
+// Defined as: fd, uint16 AcquireNotify(dict options)
+//
+// D-Bus breakdown:
+//
+//     Input args:  options - "a{sv}"
+//     Output args: fd      - "h"
+//                  mtu     - "q"
+//
+// This also adds the `NotifyAcquired` property, which tells BlueZ to use AcquireNotify rather than PropertiesChanged signals.
+// When a client subscribes, BlueZ acquires a socket from us and change notifications sent through this characteristic (see
+// `sendChangeNotificationBytes()`) are written directly to that socket rather than emitted as D-Bus signals.
+GattCharacteristic &GattCharacteristic::enableAcquireNotify()
+{
+	static const char *inArgs[] = {"a{sv}", nullptr};
+	addMethod("AcquireNotify", inArgs, "hq", reinterpret_cast<DBusMethod::Callback>(onAcquireNotify));
+	addProperty<GattCharacteristic>("NotifyAcquired", false, onGetNotifyAcquired);
+	return *this;
+}
+
+// Creates a socket pair for an Acquire* method, returning BlueZ's end to the caller of `pInvocation` and storing ours in `state`
+//
+// We create a connected pair of sequenced-packet sockets, hand one end to BlueZ (along with the MTU it told us about) and keep the
+// other. Each packet on the socket is a single ATT value. Any socket previously held in `state` is closed - BlueZ only acquires
+// once per subscription, so a stale socket here means we haven't seen the hangup for it yet.
+//
+// Returns false (having already replied with an error) on failure
+bool GattCharacteristic::acquireSocket(AcquiredSocketState &state, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation) const
+{
+	guint16 mtu = 0;
+	const gchar *pDevicePath = nullptr;
+	GVariant *pOptions = g_variant_get_child_value(pParameters, 0);
+	g_variant_lookup(pOptions, "mtu", "q", &mtu);
+	g_variant_lookup(pOptions, "device", "&o", &pDevicePath);
+	std::string devicePath = nullptr != pDevicePath ? pDevicePath : "";
+	g_variant_unref(pOptions);
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to create socket pair for '" << getPath() << "': " << strerror(errno));
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.Failed", "Unable to create socket");
+		return false;
+	}
+
+	GUnixFDList *pFdList = g_unix_fd_list_new();
+	GError *pError = nullptr;
+	if (g_unix_fd_list_append(pFdList, fds[1], &pError) < 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to pass socket for '" << getPath() << "': " << (pError ? pError->message : "unknown error"));
+		g_clear_error(&pError);
+		g_object_unref(pFdList);
+		close(fds[0]);
+		close(fds[1]);
+		g_dbus_method_invocation_return_dbus_error(pInvocation, "org.bluez.Error.Failed", "Unable to pass socket");
+		return false;
+	}
+
+	// The fd list holds its own duplicate of BlueZ's end
+	close(fds[1]);
+
+	releaseSocket(state);
+	state.fd = fds[0];
+	state.mtu = mtu;
+	state.devicePath = devicePath;
+	state.pConnection = pConnection;
+
+	g_dbus_method_invocation_return_value_with_unix_fd_list(pInvocation, g_variant_new("(hq)", 0, mtu), pFdList);
+	g_object_unref(pFdList);
+	return true;
+}
+
+// Closes an acquired socket and removes its watch
+//
+// Returns false if the socket was not acquired
+bool GattCharacteristic::releaseSocket(AcquiredSocketState &state)
+{
+	if (state.fd < 0)
+	{
+		return false;
+	}
+
+	if (0 != state.watchId)
+	{
+		g_source_remove(state.watchId);
+		state.watchId = 0;
+	}
+
+	if (0 != state.writableWatchId)
+	{
+		g_source_remove(state.writableWatchId);
+		state.writableWatchId = 0;
+	}
+
+	close(state.fd);
+	state.fd = -1;
+	state.mtu = 0;
+	state.devicePath.clear();
+	return true;
+}
+
+// Emits a PropertiesChanged signal for a boolean `*Acquired` property
+//
+// The cached reply to `GetManagedObjects` reports the property through its getter, so it is rebuilt as well
+void GattCharacteristic::emitAcquiredChanged(const AcquiredSocketState &state, const char *pPropertyName) const
+{
+	ServerUtils::invalidateManagedObjects();
+
+	if (nullptr == state.pConnection)
+	{
+		return;
+	}
+
+	g_auto(GVariantBuilder) builder;
+	g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
+	g_variant_builder_add(&builder, "{sv}", pPropertyName, Utils::gvariantFromBoolean(state.fd >= 0));
+	GVariant *pSasv = g_variant_new("(sa{sv}as)", getName().c_str(), &builder, nullptr);
+	owner.emitSignal(state.pConnection, "org.freedesktop.DBus.Properties", "PropertiesChanged", pSasv);
+}
+
+// Handler for BlueZ's AcquireNotify method (see `enableAcquireNotify()`)
+//
+// Each packet we write to our end of the socket is sent by BlueZ as a single notification (or indication) to the subscribed
+// clients.
+void GattCharacteristic::onAcquireNotify(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &/*methodName*/, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void */*pUserData*/)
+{
+	if (!self.acquireSocket(self.notifyState, pConnection, pParameters, pInvocation))
+	{
+		return;
+	}
+
+	self.notifyState.watchId = g_unix_fd_add(self.notifyState.fd, static_cast<GIOCondition>(G_IO_HUP | G_IO_ERR), onNotifySocketHangup, const_cast<GattCharacteristic *>(&self));
+
+	GGK_LOG_DEBUG(SSTR << "Notification socket acquired for '" << self.getPath() << "' (MTU " << self.notifyState.mtu << ")");
+	self.emitAcquiredChanged(self.notifyState, "NotifyAcquired");
+}
+
+// Getter for the `NotifyAcquired` property
+GVariant *GattCharacteristic::onGetNotifyAcquired(GDBusConnection */*pConnection*/, const gchar */*pSender*/, const gchar *pObjectPath, const gchar *pInterfaceName, const gchar */*pPropertyName*/, GError **/*ppError*/, gpointer /*pUserData*/)
+{
+	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(pObjectPath, pInterfaceName);
+	std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+	return Utils::gvariantFromBoolean(nullptr != pCharacteristic && pCharacteristic->isNotifyAcquired());
+}
+
+// Called from the main loop when BlueZ closes its end of the notification socket
+//
+// BlueZ closes its end when the last client unsubscribes (or disconnects.) Returning G_SOURCE_REMOVE removes this watch.
+gboolean GattCharacteristic::onNotifySocketHangup(gint /*fd*/, GIOCondition /*condition*/, gpointer pUserData)
+{
+	const GattCharacteristic &self = *static_cast<const GattCharacteristic *>(pUserData);
+
+	GGK_LOG_DEBUG(SSTR << "Notification socket released for '" << self.getPath() << "'");
+
+	// The watch is being removed by returning G_SOURCE_REMOVE, so make sure releaseNotify() doesn't also remove it
+	self.notifyState.watchId = 0;
+	self.releaseNotify();
+	return G_SOURCE_REMOVE;
+}
+
+// Closes the notification socket (if acquired) and signals that `NotifyAcquired` is now false
+void GattCharacteristic::releaseNotify() const
+{
+	if (releaseSocket(notifyState))
+	{
+		emitAcquiredChanged(notifyState, "NotifyAcquired");
+	}
+}
+
+// Called from the main loop when a full notification socket has room again
+//
+// We push an update for ourselves so that whatever couldn't be sent goes out from `onUpdatedValue`, in order with anything sent
+// since. Returning G_SOURCE_REMOVE removes this watch; the next full socket adds a new one.
+gboolean GattCharacteristic::onNotifySocketWritable(gint /*fd*/, GIOCondition /*condition*/, gpointer pUserData)
+{
+	const GattCharacteristic &self = *static_cast<const GattCharacteristic *>(pUserData);
+
+	self.notifyState.writableWatchId = 0;
+	ggkPushUpdateQueue(self.getPath().c_str(), self.getName().c_str());
+	return G_SOURCE_REMOVE;
+}
+
+// Writes a value directly to the notification socket
+//
+// This must be called from the server thread. Returns false if the socket is not acquired, the value does not fit within the
+// MTU (in which case the caller may fall back to a PropertiesChanged signal), the socket is full (see `isNotifyBlocked()`) or
+// the write failed.
+//
+// A full socket means BlueZ hasn't caught up with what we've already sent (it waits for each indication to be confirmed), so
+// that's our backpressure: we stop and wait for the socket to become writable.
+bool GattCharacteristic::writeNotifySocket(const guint8 *pBytes, int byteLen) const
+{
+	if (notifyState.fd < 0 || isNotifyBlocked())
+	{
+		return false;
+	}
+
+	// A notification carries at most MTU - 3 bytes (the ATT opcode and handle take the rest)
+	if (notifyState.mtu > 3 && byteLen > notifyState.mtu - 3)
+	{
+		GGK_LOG_WARN(SSTR << "Notification for '" << getPath() << "' (" << byteLen << " bytes) exceeds the MTU (" << notifyState.mtu << "); sending via D-Bus");
+		return false;
+	}
+
+	ssize_t written = send(notifyState.fd, pBytes, byteLen, MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (written == byteLen)
+	{
+		return true;
+	}
+
+	if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		GGK_LOG_DEBUG(SSTR << "Notification socket for '" << getPath() << "' is full; waiting for it to drain");
+		notifyState.writableWatchId = g_unix_fd_add(notifyState.fd, G_IO_OUT, onNotifySocketWritable, const_cast<GattCharacteristic *>(this));
+		return false;
+	}
+
+	GGK_LOG_WARN(SSTR << "Unable to write to notification socket for '" << getPath() << "': " << strerror(errno));
+	releaseNotify();
+	return false;
+}
+
+// Enables BlueZ's AcquireWrite method for this characteristic
+//
+// Defined as: fd, uint16 AcquireWrite(dict options)
+//
+// D-Bus breakdown:
+//
+//     Input args:  options - "a{sv}"
+//     Output args: fd      - "h"
+//                  mtu     - "q"
+//
+// This also adds the `WriteAcquired` property, which tells BlueZ to use AcquireWrite rather than WriteValue. Once acquired,
+// each write from the client arrives as a single packet on a socket, which is read from the main loop as soon as it arrives and
+// passed to `callback` - no D-Bus method call or GVariant is involved. The `onWriteValue` handler (if any) is still used
+// for writes that BlueZ does not route through the socket.
+//
+// BlueZ only acquires a write socket for characteristics with the "write-without-response" flag, and only uses it for write
+// commands (writes with a response still arrive as WriteValue calls.)
+GattCharacteristic &GattCharacteristic::enableAcquireWrite(AcquiredWriteCallback callback)
+{
+	static const char *inArgs[] = {"a{sv}", nullptr};
+	addMethod("AcquireWrite", inArgs, "hq", reinterpret_cast<DBusMethod::Callback>(onAcquireWrite));
+	addProperty<GattCharacteristic>("WriteAcquired", false, onGetWriteAcquired);
+	pOnAcquiredWriteFunc = callback;
+	return *this;
+}
+
+// Handler for BlueZ's AcquireWrite method (see `enableAcquireWrite()`)
+//
+// BlueZ writes each value it receives from the client to its end of the socket as a single packet.
+void GattCharacteristic::onAcquireWrite(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &/*methodName*/, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void */*pUserData*/)
+{
+	if (!self.acquireSocket(self.writeState, pConnection, pParameters, pInvocation))
+	{
+		return;
+	}
+
+	self.writeState.watchId = g_unix_fd_add(self.writeState.fd, static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR), onWriteSocketReady, const_cast<GattCharacteristic *>(&self));
+
+	GGK_LOG_DEBUG(SSTR << "Write socket acquired for '" << self.getPath() << "' (MTU " << self.writeState.mtu << ")");
+	self.emitAcquiredChanged(self.writeState, "WriteAcquired");
+}
+
+// Getter for the `WriteAcquired` property
+GVariant *GattCharacteristic::onGetWriteAcquired(GDBusConnection */*pConnection*/, const gchar */*pSender*/, const gchar *pObjectPath, const gchar *pInterfaceName, const gchar */*pPropertyName*/, GError **/*ppError*/, gpointer /*pUserData*/)
+{
+	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(pObjectPath, pInterfaceName);
+	std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic);
+	return Utils::gvariantFromBoolean(nullptr != pCharacteristic && pCharacteristic->isWriteAcquired());
+}
+
+// Called from the main loop when packets arrive on the write socket (or BlueZ closes its end)
+//
+// We read every packet that's waiting, so a burst of writes is handled in a single wakeup. Packets are read into a reusable
+// buffer and handed to the callback directly. Any data still waiting when BlueZ hangs up is delivered before the socket is
+// released.
+gboolean GattCharacteristic::onWriteSocketReady(gint fd, GIOCondition condition, gpointer pUserData)
+{
+	static guint8 buffer[kMaxAcquiredWriteSize];
+
+	const GattCharacteristic &self = *static_cast<const GattCharacteristic *>(pUserData);
+
+	while (true)
+	{
+		ssize_t length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT | MSG_TRUNC);
+		if (length < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				GGK_LOG_WARN(SSTR << "Unable to read from write socket for '" << self.getPath() << "': " << strerror(errno));
+				condition = static_cast<GIOCondition>(condition | G_IO_ERR);
+			}
+			break;
+		}
+
+		// A zero-length read on a sequenced-packet socket means the other end has closed
+		if (length == 0)
+		{
+			condition = static_cast<GIOCondition>(condition | G_IO_HUP);
+			break;
+		}
+
+		// With MSG_TRUNC, recv() returns the real packet length even if it didn't fit
+		if (length > static_cast<ssize_t>(sizeof(buffer)))
+		{
+			GGK_LOG_WARN(SSTR << "Dropping oversized write (" << length << " bytes) on '" << self.getPath() << "'");
+			continue;
+		}
+
+		if (nullptr != self.pOnAcquiredWriteFunc)
+		{
+			self.pOnAcquiredWriteFunc(self, buffer, static_cast<int>(length));
+		}
+	}
+
+	if (0 != (condition & (G_IO_HUP | G_IO_ERR)))
+	{
+		GGK_LOG_DEBUG(SSTR << "Write socket released for '" << self.getPath() << "'");
+
+		// The watch is being removed by returning G_SOURCE_REMOVE, so make sure releaseWrite() doesn't also remove it
+		self.writeState.watchId = 0;
+		self.releaseWrite();
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+// Closes the write socket (if acquired) and signals that `WriteAcquired` is now false
+void GattCharacteristic::releaseWrite() const
+{
+	if (releaseSocket(writeState))
+	{
+		emitAcquiredChanged(writeState, "WriteAcquired");
+	}
+}
+
+// Limits how often this characteristic's `onUpdatedValue` is called in response to queued updates
+//
+// When update coalescing is enabled (see `ggkUpdateQueueSetCoalescing`), updates that arrive within `intervalMS` milliseconds
+// of the previous one are held back and delivered (once, with the latest value) when the interval expires.
+GattCharacteristic &GattCharacteristic::minNotifyInterval(int intervalMS)
+{
+	setMinUpdateInterval(intervalMS);
+	return *this;
+}
+
 // Calls the onUpdatedValue method, if one was set.
 //
 // Returns false if there was no method set, otherwise, returns the boolean result of the method call.
@@ -162,7 +581,7 @@ bool GattCharacteristic::callOnUpdatedValue(GDBusConnection *pConnection, void *
 		return false;
 	}
 
-	Logger::debug(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
+	GGK_LOG_DEBUG(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
 	return pOnUpdatedValueFunc(*this, pConnection, pUserData);
 }
 
@@ -188,7 +607,7 @@ bool GattCharacteristic::callOnUpdatedValue(GDBusConnection *pConnection, void *
 GattDescriptor &GattCharacteristic::gattDescriptorBegin(const std::string &pathElement, const GattUuid &uuid, const std::vector<const char *> &flags)
 {
 	DBusObject &child = owner.addChild(DBusObjectPath(pathElement));
-	GattDescriptor &descriptor = *child.addInterface(std::make_shared<GattDescriptor>(child, *this, "org.bluez.GattDescriptor1"));
+	GattDescriptor &descriptor = *child.addInterface(std::make_shared<GattDescriptor>(child, *this, std::string(GattDescriptor::kInterfaceName)));
 	descriptor.addProperty<GattDescriptor>("UUID", uuid);
 	descriptor.addProperty<GattDescriptor>("Characteristic", getPath());
 	descriptor.addProperty<GattDescriptor>("Flags", flags);
@@ -202,23 +621,70 @@ GattDescriptor &GattCharacteristic::gattDescriptorBegin(const std::string &pathE
 //
 // The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
 // active connections before sending a change notification.
-void GattCharacteristic::sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const
+//
+// Returns true if the notification was handed to BlueZ (written to the notification socket or emitted as a signal)
+bool GattCharacteristic::sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const
+{
+	// If BlueZ has acquired a notification socket, byte array values go straight to it
+	bool ownsValue = false;
+	if (isNotifyAcquired() && g_variant_is_of_type(pNewValue, G_VARIANT_TYPE_BYTESTRING))
+	{
+		g_variant_ref_sink(pNewValue);
+		ownsValue = true;
+
+		gsize size = 0;
+		const guint8 *pBytes = static_cast<const guint8 *>(g_variant_get_fixed_array(pNewValue, &size, sizeof(guint8)));
+		if (writeNotifySocket(pBytes, static_cast<int>(size)) || isNotifyBlocked())
+		{
+			g_variant_unref(pNewValue);
+			return !isNotifyBlocked();
+		}
+	}
+
+	bool emitted = emitValueChangedSignal(pBusConnection, pNewValue);
+
+	// The signal took its own reference to the (no longer floating) value
+	if (ownsValue)
+	{
+		g_variant_unref(pNewValue);
+	}
+
+	return emitted;
+}
+
+// Emits a PropertiesChanged signal carrying the characteristic's new value, returning true if it was emitted
+bool GattCharacteristic::emitValueChangedSignal(GDBusConnection *pBusConnection, GVariant *pNewValue) const
 {
 	g_auto(GVariantBuilder) builder;
 	g_variant_builder_init(&builder, G_VARIANT_TYPE_ARRAY);
 	g_variant_builder_add(&builder, "{sv}", "Value", pNewValue);
-	GVariant *pSasv = g_variant_new("(sa{sv})", "org.bluez.GattCharacteristic1", &builder);
-	owner.emitSignal(pBusConnection, "org.freedesktop.DBus.Properties", "PropertiesChanged", pSasv);
+	GVariant *pSasv = g_variant_new("(sa{sv})", kInterfaceName, &builder);
+	return owner.emitSignal(pBusConnection, "org.freedesktop.DBus.Properties", "PropertiesChanged", pSasv);
 }
 
 /*
  * MARK
  * For raw bytes
+ *
+ * Returns true if the notification was handed to BlueZ (written to the notification socket or emitted as a signal). If the
+ * notification socket is full, nothing is sent and isNotifyBlocked() is true.
  */
-void GattCharacteristic::sendChangeNotificationBytes(GDBusConnection *pBusConnection, guint8 * bytes, int byteLen ) const
+bool GattCharacteristic::sendChangeNotificationBytes(GDBusConnection *pBusConnection, guint8 * bytes, int byteLen ) const
 {
+    // With an acquired notification socket, this is a single write with no GVariant or D-Bus involvement
+    if (writeNotifySocket(bytes, byteLen))
+    {
+        return true;
+    }
+
+    // Don't let this one overtake what's waiting in the socket
+    if (isNotifyBlocked())
+    {
+        return false;
+    }
+
     GVariant *pVariant = Utils::gvariantFromByteArray(bytes, byteLen);
-    sendChangeNotificationVariant(pBusConnection, pVariant);
+    return emitValueChangedSignal(pBusConnection, pVariant);
 }
 
 }; // namespace ggk
\ No newline at end of file
@@ -74,6 +74,13 @@ struct DBusObject;
        void *pUserData \
 )
 
+#define CHARACTERISTIC_ACQUIRED_WRITE_CALLBACK_LAMBDA [] \
+( \
+	const GattCharacteristic &self, \
+	const guint8 *pData, \
+	int dataLen \
+)
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Representation of a Bluetooth GATT Characteristic
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -83,16 +90,25 @@ struct GattCharacteristic : GattInterface
 	// Our interface type
 	static constexpr const char *kInterfaceType = "GattCharacteristic";
 
+	// The D-Bus interface name we register characteristics under
+	static constexpr const char *kInterfaceName = "org.bluez.GattCharacteristic1";
+
 	typedef void (*MethodCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
 	typedef void (*EventCallback)(const GattCharacteristic &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 	typedef bool (*UpdatedValueCallback)(const GattCharacteristic &self, GDBusConnection *pConnection, void *pUserData);
+	typedef void (*AcquiredWriteCallback)(const GattCharacteristic &self, const guint8 *pData, int dataLen);
+
+	// The largest packet we will read from an acquired write socket
+	//
+	// This is the largest ATT MTU (517); a write can never carry more than MTU - 3 bytes.
+	static const int kMaxAcquiredWriteSize = 517;
 
 	// Construct a GattCharacteristic
 	//
 	// Genreally speaking, these objects should not be constructed directly. Rather, use the `gattCharacteristicBegin()` method
 	// in `GattService`.
 	GattCharacteristic(DBusObject &owner, GattService &service, const std::string &name);
-	virtual ~GattCharacteristic() {}
+	virtual ~GattCharacteristic();
 
 	// Returns a string identifying the type of interface
 	virtual const std::string getInterfaceType() const { return GattCharacteristic::kInterfaceType; }
@@ -103,7 +119,7 @@ struct GattCharacteristic : GattInterface
 	GattService &gattCharacteristicEnd();
 
 	// Locates a D-Bus method within this D-Bus interface and invokes the method
-	virtual bool callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
+	virtual bool callMethod(const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
 
 	// Adds an event to the characteristic and returns a refereence to 'this` to enable method chaining in the server description
 	//
@@ -111,11 +127,21 @@ struct GattCharacteristic : GattInterface
 	// TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
 	GattCharacteristic &onEvent(int tickFrequency, void *pUserData, EventCallback callback);
 
+	// Adds an event that fires every `periodMS` milliseconds and returns a reference to 'this` to enable method chaining
+	//
+	// NOTE: As with `onEvent()`, we overload this method in order to accept our custom EventCallback type.
+	GattCharacteristic &onTimerEvent(int periodMS, void *pUserData, EventCallback callback);
+
 	// Ticks events within this characteristic
 	//
 	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
 	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
 
+	// Fires one of this characteristic's events
+	//
+	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
+	virtual void fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const;
+
 	// Specialized support for Characteristic ReadlValue method
 	//
 	// Defined as: array{byte} ReadValue(dict options)
@@ -149,6 +175,59 @@ struct GattCharacteristic : GattInterface
 	// `callOnUpdatedValue` for more information.
 	GattCharacteristic &onUpdatedValue(UpdatedValueCallback callback);
 
+	// Specialized support for Characteristic Confirm method
+	//
+	// Defined as: void Confirm() [noreply]
+	//
+	// D-Bus breakdown:
+	//
+	//     Input args:  void
+	//     Output args: void
+	//
+	// BlueZ calls this each time a client confirms an indication sent through this characteristic (whether it was sent as a
+	// PropertiesChanged signal or through an acquired notification socket.) It does not say which client confirmed it.
+	GattCharacteristic &onConfirm(MethodCallback callback);
+
+	// Enables BlueZ's AcquireNotify method for this characteristic
+	//
+	// Defined as: fd, uint16 AcquireNotify(dict options)
+	//
+	// D-Bus breakdown:
+	//
+	//     Input args:  options - "a{sv}"
+	//     Output args: fd      - "h"
+	//                  mtu     - "q"
+	//
+	// This also adds the `NotifyAcquired` property, which tells BlueZ to use AcquireNotify rather than PropertiesChanged signals.
+	// When a client subscribes, BlueZ acquires a socket from us and change notifications sent through this characteristic (see
+	// `sendChangeNotificationBytes()`) are written directly to that socket rather than emitted as D-Bus signals.
+	GattCharacteristic &enableAcquireNotify();
+
+	// Enables BlueZ's AcquireWrite method for this characteristic
+	//
+	// Defined as: fd, uint16 AcquireWrite(dict options)
+	//
+	// D-Bus breakdown:
+	//
+	//     Input args:  options - "a{sv}"
+	//     Output args: fd      - "h"
+	//                  mtu     - "q"
+	//
+	// This also adds the `WriteAcquired` property, which tells BlueZ to use AcquireWrite rather than WriteValue. Once acquired,
+	// each write from the client arrives as a single packet on a socket, which is read from the main loop as soon as it arrives and
+	// passed to `callback` - no D-Bus method call or GVariant is involved. The `onWriteValue` handler (if any) is still used
+	// for writes that BlueZ does not route through the socket.
+	//
+	// BlueZ only acquires a write socket for characteristics with the "write-without-response" flag, and only uses it for write
+	// commands (writes with a response still arrive as WriteValue calls.)
+	GattCharacteristic &enableAcquireWrite(AcquiredWriteCallback callback);
+
+	// Limits how often this characteristic's `onUpdatedValue` is called in response to queued updates
+	//
+	// When update coalescing is enabled (see `ggkUpdateQueueSetCoalescing`), updates that arrive within `intervalMS` milliseconds
+	// of the previous one are held back and delivered (once, with the latest value) when the interval expires.
+	GattCharacteristic &minNotifyInterval(int intervalMS);
+
 	// Calls the onUpdatedValue method, if one was set.
 	//
 	// Returns false if there was no method set, otherwise, returns the boolean result of the method call.
@@ -195,7 +274,9 @@ struct GattCharacteristic : GattInterface
 	//
 	// The caller may choose to consult HciAdapter::getInstance().getActiveConnectionCount() in order to determine if there are any
 	// active connections before sending a change notification.
-	void sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const;
+	//
+	// Returns true if the notification was handed to BlueZ (written to the notification socket or emitted as a signal)
+	bool sendChangeNotificationVariant(GDBusConnection *pBusConnection, GVariant *pNewValue) const;
 
 	// Sends a change notification to subscribers to this characteristic
 	//
@@ -208,20 +289,131 @@ struct GattCharacteristic : GattInterface
     /*
      * MARK
      * For raw bytes
+     *
+     * Returns true if the notification was handed to BlueZ (written to the notification socket or emitted as a signal). If the
+     * notification socket is full, nothing is sent and isNotifyBlocked() is true.
      */
-    void sendChangeNotificationBytes(GDBusConnection *pBusConnection, guint8 * byteArr, int byteLen ) const;
+    bool sendChangeNotificationBytes(GDBusConnection *pBusConnection, guint8 * byteArr, int byteLen ) const;
 
 	template<typename T>
-	void sendChangeNotificationValue(GDBusConnection *pBusConnection, T value) const
+	bool sendChangeNotificationValue(GDBusConnection *pBusConnection, T value) const
 	{
 		GVariant *pVariant = Utils::gvariantFromByteArray(value);
-		sendChangeNotificationVariant(pBusConnection, pVariant);
+		return sendChangeNotificationVariant(pBusConnection, pVariant);
 	}
 
+	//
+	// AcquireNotify support
+	//
+
+	// Returns true if BlueZ currently holds a notification socket for this characteristic
+	bool isNotifyAcquired() const { return notifyState.fd >= 0; }
+
+	// Returns the ATT MTU BlueZ reported when the notification socket was acquired (0 if it is not acquired)
+	uint16_t getNotifyMtu() const { return notifyState.mtu; }
+
+	// Returns true if the notification socket is full
+	//
+	// Notifications are not sent while the socket is full (falling back to a signal would deliver them out of order.) When BlueZ
+	// drains the socket, an update is pushed for this characteristic so that its `onUpdatedValue` can send what's left.
+	bool isNotifyBlocked() const { return 0 != notifyState.writableWatchId; }
+
+	// Writes a value directly to the notification socket
+	//
+	// This must be called from the server thread. Returns false if the socket is not acquired, the value does not fit within the
+	// MTU (in which case the caller may fall back to a PropertiesChanged signal), the socket is full (see `isNotifyBlocked()`) or
+	// the write failed.
+	bool writeNotifySocket(const guint8 *pBytes, int byteLen) const;
+
+	// Closes the notification socket (if acquired) and signals that `NotifyAcquired` is now false
+	void releaseNotify() const;
+
+	//
+	// AcquireWrite support
+	//
+
+	// Returns true if BlueZ currently holds a write socket for this characteristic
+	bool isWriteAcquired() const { return writeState.fd >= 0; }
+
+	// Returns the ATT MTU BlueZ reported when the write socket was acquired (0 if it is not acquired)
+	uint16_t getWriteMtu() const { return writeState.mtu; }
+
+	// Returns the object path of the device that BlueZ acquired the write socket for (empty if not acquired or not reported)
+	const std::string &getWriteDevicePath() const { return writeState.devicePath; }
+
+	// Closes the write socket (if acquired) and signals that `WriteAcquired` is now false
+	void releaseWrite() const;
+
 protected:
 
+	// State of an acquired socket (notify or write)
+	//
+	// This is only accessed from the server thread. It is mutable because the server description only exposes const
+	// characteristics to method callbacks.
+	struct AcquiredSocketState
+	{
+		// Our end of the socket pair, or -1 if not acquired
+		int fd;
+
+		// The ATT MTU reported by BlueZ when the socket was acquired
+		uint16_t mtu;
+
+		// The object path of the device the socket was acquired for, if BlueZ reported it
+		std::string devicePath;
+
+		// GLib source ID watching our end of the socket
+		guint watchId;
+
+		// GLib source ID waiting for a full socket to become writable (notify only)
+		guint writableWatchId;
+
+		// The connection on which the socket was acquired, used to signal changes to the `*Acquired` property
+		GDBusConnection *pConnection;
+	};
+
+	// Handler for BlueZ's AcquireNotify method (see `enableAcquireNotify()`)
+	static void onAcquireNotify(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+
+	// Getter for the `NotifyAcquired` property
+	static GVariant *onGetNotifyAcquired(GDBusConnection *pConnection, const gchar *pSender, const gchar *pObjectPath, const gchar *pInterfaceName, const gchar *pPropertyName, GError **ppError, gpointer pUserData);
+
+	// Called from the main loop when BlueZ closes its end of the notification socket
+	static gboolean onNotifySocketHangup(gint fd, GIOCondition condition, gpointer pUserData);
+
+	// Called from the main loop when a full notification socket has room again
+	static gboolean onNotifySocketWritable(gint fd, GIOCondition condition, gpointer pUserData);
+
+	// Handler for BlueZ's AcquireWrite method (see `enableAcquireWrite()`)
+	static void onAcquireWrite(const GattCharacteristic &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
+
+	// Getter for the `WriteAcquired` property
+	static GVariant *onGetWriteAcquired(GDBusConnection *pConnection, const gchar *pSender, const gchar *pObjectPath, const gchar *pInterfaceName, const gchar *pPropertyName, GError **ppError, gpointer pUserData);
+
+	// Called from the main loop when packets arrive on the write socket (or BlueZ closes its end)
+	static gboolean onWriteSocketReady(gint fd, GIOCondition condition, gpointer pUserData);
+
+	// Creates a socket pair for an Acquire* method, returning BlueZ's end to the caller of `pInvocation` and storing ours in
+	// `state`
+	//
+	// Returns false (having already replied with an error) on failure
+	bool acquireSocket(AcquiredSocketState &state, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation) const;
+
+	// Closes an acquired socket and removes its watch
+	//
+	// Returns false if the socket was not acquired
+	static bool releaseSocket(AcquiredSocketState &state);
+
+	// Emits a PropertiesChanged signal for a boolean `*Acquired` property
+	void emitAcquiredChanged(const AcquiredSocketState &state, const char *pPropertyName) const;
+
+	// Emits a PropertiesChanged signal carrying the characteristic's new value, returning true if it was emitted
+	bool emitValueChangedSignal(GDBusConnection *pBusConnection, GVariant *pNewValue) const;
+
 	GattService &service;
 	UpdatedValueCallback pOnUpdatedValueFunc;
+	mutable AcquiredSocketState notifyState;
+	AcquiredWriteCallback pOnAcquiredWriteFunc;
+	mutable AcquiredSocketState writeState;
 };
 
 }; // namespace ggk
\ No newline at end of file
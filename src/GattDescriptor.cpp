@@ -56,18 +56,16 @@ GattCharacteristic &GattDescriptor::gattDescriptorEnd()
 //
 
 // Locates a D-Bus method within this D-Bus interface
-bool GattDescriptor::callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
+bool GattDescriptor::callMethod(const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-	for (const DBusMethod &method : methods)
+	const DBusMethod *pMethod = findMethod(pMethodName);
+	if (nullptr == pMethod)
 	{
-		if (methodName == method.getName())
-		{
-			method.call<GattDescriptor>(pConnection, getPath(), getName(), methodName, pParameters, pInvocation, pUserData);
-			return true;
-		}
+		return false;
 	}
 
-	return false;
+	pMethod->call<GattDescriptor>(pConnection, getPath(), getName(), pMethod->getName(), pParameters, pInvocation, pUserData);
+	return true;
 }
 
 // Adds an event to the descriptor and returns a refereence to 'this` to enable method chaining in the server description
@@ -80,6 +78,16 @@ GattDescriptor &GattDescriptor::onEvent(int tickFrequency, void *pUserData, Even
 	return *this;
 }
 
+// Adds an event that fires every `periodMS` milliseconds and returns a reference to 'this` to enable method chaining
+//
+// NOTE: As with `onEvent()`, we overload this method in order to accept our custom EventCallback type.
+GattDescriptor &GattDescriptor::onTimerEvent(int periodMS, void *pUserData, EventCallback callback)
+{
+	events.push_back(TickEvent(this, 1, reinterpret_cast<TickEvent::Callback>(callback), pUserData));
+	events.back().setPeriodMS(periodMS);
+	return *this;
+}
+
 // Ticks events within this descriptor
 //
 // Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
@@ -91,6 +99,14 @@ void GattDescriptor::tickEvents(GDBusConnection *pConnection, void *pUserData) c
 	}
 }
 
+// Fires one of this descriptor's events
+//
+// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
+void GattDescriptor::fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const
+{
+	event.fire<GattDescriptor>(getPath(), pConnection, pUserData);
+}
+
 // Specialized support for ReadlValue method
 //
 // Defined as: array{byte} ReadValue(dict options)
@@ -163,7 +179,7 @@ bool GattDescriptor::callOnUpdatedValue(GDBusConnection *pConnection, void *pUse
 		return false;
 	}
 
-	Logger::debug(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
+	GGK_LOG_DEBUG(SSTR << "Calling OnUpdatedValue function for interface at path '" << getPath() << "'");
 	return pOnUpdatedValueFunc(*this, pConnection, pUserData);
 }
 
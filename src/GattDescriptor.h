@@ -79,6 +79,9 @@ struct GattDescriptor : GattInterface
 	// Our interface type
 	static constexpr const char *kInterfaceType = "GattDescriptor";
 
+	// The D-Bus interface name we register descriptors under
+	static constexpr const char *kInterfaceName = "org.bluez.GattDescriptor1";
+
 	typedef void (*MethodCallback)(const GattDescriptor &self, GDBusConnection *pConnection, const std::string &methodName, GVariant *pParameters, GDBusMethodInvocation *pInvocation, void *pUserData);
 	typedef void (*EventCallback)(const GattDescriptor &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 	typedef bool (*UpdatedValueCallback)(const GattDescriptor &self, GDBusConnection *pConnection, void *pUserData);
@@ -103,7 +106,7 @@ struct GattDescriptor : GattInterface
 	GattCharacteristic &gattDescriptorEnd();
 
 	// Locates a D-Bus method within this D-Bus interface and invokes the method
-	virtual bool callMethod(const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
+	virtual bool callMethod(const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
 
 	// Adds an event to the descriptor and returns a refereence to 'this` to enable method chaining in the server description
 	//
@@ -111,11 +114,21 @@ struct GattDescriptor : GattInterface
 	// TickEvent::Callback type. We also return our own type. This simplifies the server description by allowing call to chain.
 	GattDescriptor &onEvent(int tickFrequency, void *pUserData, EventCallback callback);
 
+	// Adds an event that fires every `periodMS` milliseconds and returns a reference to 'this` to enable method chaining
+	//
+	// NOTE: As with `onEvent()`, we overload this method in order to accept our custom EventCallback type.
+	GattDescriptor &onTimerEvent(int periodMS, void *pUserData, EventCallback callback);
+
 	// Ticks events within this descriptor
 	//
 	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
 	virtual void tickEvents(GDBusConnection *pConnection, void *pUserData) const;
 
+	// Fires one of this descriptor's events
+	//
+	// Note: we specifically override this method in order to translate the generic TickEvent::Callback into our own EventCallback
+	virtual void fireEvent(const TickEvent &event, GDBusConnection *pConnection, void *pUserData) const;
+
 	// Specialized support for Descriptor ReadlValue method
 	//
 	// Defined as: array{byte} ReadValue(dict options)
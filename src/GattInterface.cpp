@@ -55,8 +55,21 @@ const std::list<GattProperty> &GattInterface::getProperties() const
 //
 // This is the generalized form that accepts a GVariant *. There is a templated helper method (`methodReturnValue()`) that accepts
 // common types.
+//
+// If the caller doesn't expect a reply (see `isReplyExpected()`), none is built or sent.
 void GattInterface::methodReturnVariant(GDBusMethodInvocation *pInvocation, GVariant *pVariant, bool wrapInTuple) const
 {
+	if (!isReplyExpected(pInvocation))
+	{
+		// The value and the invocation are ours to release, just as they would have been consumed by the reply
+		if (nullptr != pVariant)
+		{
+			g_variant_unref(g_variant_ref_sink(pVariant));
+		}
+		g_object_unref(pInvocation);
+		return;
+	}
+
 	if (wrapInTuple)
 	{
 		pVariant = g_variant_new_tuple(&pVariant, 1);
@@ -64,14 +77,32 @@ void GattInterface::methodReturnVariant(GDBusMethodInvocation *pInvocation, GVar
 	g_dbus_method_invocation_return_value(pInvocation, pVariant);
 }
 
+// Returns false if the caller of a method doesn't want a reply (the D-Bus NO_REPLY_EXPECTED flag is set)
+//
+// BlueZ calls WriteValue this way for write-without-response (ATT Write Command) writes, since there's no ATT response to wait
+// for. GLib would discard our reply anyway, but only after we've built it and it has been type-checked.
+bool GattInterface::isReplyExpected(GDBusMethodInvocation *pInvocation)
+{
+	GDBusMessage *pMessage = g_dbus_method_invocation_get_message(pInvocation);
+	return 0 == (g_dbus_message_get_flags(pMessage) & G_DBUS_MESSAGE_FLAGS_NO_REPLY_EXPECTED);
+}
+
 // Locates a `GattProperty` within the interface
 //
 // This method returns a pointer to the property or nullptr if not found
 const GattProperty *GattInterface::findProperty(const std::string &name) const
+{
+	return findProperty(name.c_str());
+}
+
+// Locates a `GattProperty` within the interface
+//
+// This method returns a pointer to the property or nullptr if not found
+const GattProperty *GattInterface::findProperty(const char *pName) const
 {
 	for (const GattProperty &property : properties)
 	{
-		if (property.getName() == name)
+		if (strcmp(property.getName().c_str(), pName) == 0)
 		{
 			return &property;
 		}
@@ -114,4 +145,23 @@ std::string GattInterface::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Internal method used to build the introspection data used to register our services on D-Bus
+//
+// This extends the base description with our properties.
+GDBusInterfaceInfo *GattInterface::generateInterfaceInfo() const
+{
+	GDBusInterfaceInfo *pInterface = DBusInterface::generateInterfaceInfo();
+
+	// Replace the base class's empty (null-terminated) property array with ours
+	g_free(pInterface->properties);
+	pInterface->properties = g_new0(GDBusPropertyInfo *, getProperties().size() + 1);
+	int index = 0;
+	for (const GattProperty &property : getProperties())
+	{
+		pInterface->properties[index++] = property.generatePropertyInfo();
+	}
+
+	return pInterface;
+}
+
 }; // namespace ggk
\ No newline at end of file
@@ -194,8 +194,16 @@ struct GattInterface : DBusInterface
 	//
 	// This is the generalized form that accepts a GVariant *. There is a templated helper method (`methodReturnValue()`) that accepts
 	// common types.
+	//
+	// If the caller doesn't expect a reply (see `isReplyExpected()`), none is built or sent.
 	void methodReturnVariant(GDBusMethodInvocation *pInvocation, GVariant *pVariant, bool wrapInTuple = false) const;
 
+	// Returns false if the caller of a method doesn't want a reply (the D-Bus NO_REPLY_EXPECTED flag is set)
+	//
+	// BlueZ calls WriteValue this way for write-without-response (ATT Write Command) writes, since there's no ATT response to
+	// wait for.
+	static bool isReplyExpected(GDBusMethodInvocation *pInvocation);
+
 	// When responding to a ReadValue method, we need to return a GVariant value in the form "(ay)" (a tuple containing an array of
 	// bytes). This method will simplify this slightly by wrapping a GVariant of the type "ay" and wrapping it in a tuple before
 	// sending it off as the method response.
@@ -213,10 +221,16 @@ struct GattInterface : DBusInterface
 	//
 	// This method returns a pointer to the property or nullptr if not found
 	const GattProperty *findProperty(const std::string &name) const;
+	const GattProperty *findProperty(const char *pName) const;
 
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	virtual std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to build the introspection data used to register our services on D-Bus
+	//
+	// This extends the base description with our properties.
+	virtual GDBusInterfaceInfo *generateInterfaceInfo() const;
+
 protected:
 
 	std::list<GattProperty> properties;
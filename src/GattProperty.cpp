@@ -26,6 +26,7 @@
 
 #include "Utils.h"
 #include "GattProperty.h"
+#include "ServerUtils.h"
 
 namespace ggk {
 
@@ -33,9 +34,43 @@ namespace ggk {
 //
 // In general, properties should not be constructed directly as properties are typically instanticated by adding them to to an
 // interface using one of the the interface's `addProperty` methods.
+//
+// We take our own (non-floating) reference to `pValue` so that the value survives being sent in a reply, which sinks floating
+// references.
 GattProperty::GattProperty(const std::string &name, GVariant *pValue, GDBusInterfaceGetPropertyFunc getter, GDBusInterfaceSetPropertyFunc setter)
-: name(name), pValue(pValue), getterFunc(getter), setterFunc(setter)
+: name(name), pValue(nullptr == pValue ? nullptr : g_variant_ref_sink(pValue)), getterFunc(getter), setterFunc(setter)
+{
+}
+
+// Copies share the value, each holding its own reference
+GattProperty::GattProperty(const GattProperty &other)
+: name(other.name), pValue(nullptr == other.pValue ? nullptr : g_variant_ref(other.pValue)), getterFunc(other.getterFunc), setterFunc(other.setterFunc)
+{
+}
+
+// Copies share the value, each holding its own reference
+GattProperty &GattProperty::operator =(const GattProperty &other)
+{
+	GVariant *pOtherValue = nullptr == other.pValue ? nullptr : g_variant_ref(other.pValue);
+	if (nullptr != pValue)
+	{
+		g_variant_unref(pValue);
+	}
+
+	name = other.name;
+	pValue = pOtherValue;
+	getterFunc = other.getterFunc;
+	setterFunc = other.setterFunc;
+	return *this;
+}
+
+// Releases our reference to the value
+GattProperty::~GattProperty()
 {
+	if (nullptr != pValue)
+	{
+		g_variant_unref(pValue);
+	}
 }
 
 //
@@ -72,9 +107,20 @@ const GVariant *GattProperty::getValue() const
 //
 // In general, this method should not be called directly as properties are typically added to an interface using one of the the
 // interface's `addProperty` methods.
+//
+// Our reference to the previous value is released. Since properties are reported in the cached reply to `GetManagedObjects`,
+// this invalidates that reply.
 GattProperty &GattProperty::setValue(GVariant *pValue)
 {
-	this->pValue = pValue;
+	// Take the new reference before releasing the old one, in case they're the same value
+	GVariant *pOldValue = this->pValue;
+	this->pValue = nullptr == pValue ? nullptr : g_variant_ref_sink(pValue);
+	if (nullptr != pOldValue)
+	{
+		g_variant_unref(pOldValue);
+	}
+
+	ServerUtils::invalidateManagedObjects();
 	return *this;
 }
 
@@ -176,4 +222,17 @@ std::string GattProperty::generateIntrospectionXML(int depth) const
 	return xml;
 }
 
+// Internal method used to build the introspection data used to register our services on D-Bus
+//
+// The caller owns the returned reference.
+GDBusPropertyInfo *GattProperty::generatePropertyInfo() const
+{
+	GDBusPropertyInfo *pProperty = g_new0(GDBusPropertyInfo, 1);
+	pProperty->ref_count = 1;
+	pProperty->name = g_strdup(getName().c_str());
+	pProperty->signature = g_strdup(g_variant_get_type_string(const_cast<GVariant *>(getValue())));
+	pProperty->flags = G_DBUS_PROPERTY_INFO_FLAGS_READABLE;
+	return pProperty;
+}
+
 }; // namespace ggk
\ No newline at end of file
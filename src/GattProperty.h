@@ -36,8 +36,18 @@ struct GattProperty
 	//
 	// In general, properties should not be constructed directly as properties are typically instanticated by adding them to to an
 	// interface using one of the the interface's `addProperty` methods.
+	//
+	// We take our own (non-floating) reference to `pValue` so that the value survives being sent in a reply, which sinks floating
+	// references.
 	GattProperty(const std::string &name, GVariant *pValue, GDBusInterfaceGetPropertyFunc getter = nullptr, GDBusInterfaceSetPropertyFunc setter = nullptr);
 
+	// Copies share the value, each holding its own reference
+	GattProperty(const GattProperty &other);
+	GattProperty &operator =(const GattProperty &other);
+
+	// Releases our reference to the value
+	~GattProperty();
+
 	//
 	// Name
 	//
@@ -62,6 +72,9 @@ struct GattProperty
 	//
 	// In general, this method should not be called directly as properties are typically added to an interface using one of the the
 	// interface's `addProperty` methods.
+	//
+	// Our reference to the previous value is released. Since properties are reported in the cached reply to `GetManagedObjects`,
+	// this invalidates that reply.
 	GattProperty &setValue(GVariant *pValue);
 
 	//
@@ -89,6 +102,11 @@ struct GattProperty
 	// Internal method used to generate introspection XML used to describe our services on D-Bus
 	std::string generateIntrospectionXML(int depth) const;
 
+	// Internal method used to build the introspection data used to register our services on D-Bus
+	//
+	// The caller owns the returned reference.
+	GDBusPropertyInfo *generatePropertyInfo() const;
+
 private:
 
 	std::string name;
@@ -37,25 +37,34 @@
 #include <string.h>
 #include <string>
 #include <thread>
-#include <memory>
-#include <deque>
 #include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
 
 #include "Init.h"
 #include "Logger.h"
+#include "AsyncLogger.h"
 #include "Server.h"
+#include "DBusInterface.h"
+#include "GattCharacteristic.h"
+#include "GattDescriptor.h"
+#include "UpdateQueue.h"
+#include "HciAdapter.h"
+#include "AdvertisingManager.h"
 
 namespace ggk
 {
-	// During initialization, we'll check for complation at this interval
-	static const int kMaxAsyncInitCheckIntervalMS = 10;
-
 	// Our server thread
 	static std::thread serverThread;
 
 	// The current server state
 	volatile static GGKServerRunState serverRunState = EUninitialized;
 
+	// Signalled whenever the server state changes, so that `ggkStart()` can wait for initialization without polling
+	static std::mutex serverRunStateMutex;
+	static std::condition_variable serverRunStateChanged;
+
 	// The current server health
 	volatile static GGKServerHealth serverHealth = EOk;
 
@@ -64,22 +73,20 @@ namespace ggk
 	static GPrintFunc printerrHandlerGLib;
 	static GLogFunc logHandlerGLib;
 
-	// Our update queue
-	typedef std::tuple<std::string, std::string> QueueEntry;
-	std::deque<QueueEntry> updateQueue;
-	std::mutex updateQueueMutex;
-
 	// Internal method to set the run state of the server
 	void setServerRunState(GGKServerRunState newState)
 	{
-		Logger::status(SSTR << "** SERVER RUN STATE CHANGED: " << ggkGetServerRunStateString(serverRunState) << " -> " << ggkGetServerRunStateString(newState));
+		GGK_LOG_STATUS(SSTR << "** SERVER RUN STATE CHANGED: " << ggkGetServerRunStateString(serverRunState) << " -> " << ggkGetServerRunStateString(newState));
+
+		std::lock_guard<std::mutex> lock(serverRunStateMutex);
 		serverRunState = newState;
+		serverRunStateChanged.notify_all();
 	}
 
 	// Internal method to set the health of the server
 	void setServerHealth(GGKServerHealth newHealth)
 	{
-		Logger::status(SSTR << "** SERVER HEALTH CHANGED: " << ggkGetServerHealthString(serverHealth) << " -> " << ggkGetServerHealthString(newHealth));
+		GGK_LOG_STATUS(SSTR << "** SERVER HEALTH CHANGED: " << ggkGetServerHealthString(serverHealth) << " -> " << ggkGetServerHealthString(newHealth));
 		serverHealth = newHealth;
 	}
 }; // namespace ggk
@@ -105,6 +112,32 @@ void ggkLogRegisterFatal(GGKLogReceiver receiver) { Logger::registerFatalReceive
 void ggkLogRegisterTrace(GGKLogReceiver receiver) { Logger::registerTraceReceiver(receiver); }
 void ggkLogRegisterAlways(GGKLogReceiver receiver) { Logger::registerAlwaysReceiver(receiver); }
 
+// Enables or disables asynchronous log delivery
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkLogSetAsync(int enabled)
+{
+	return Logger::setAsync(enabled != 0) ? 1 : 0;
+}
+
+// Returns 1 if async log delivery is enabled, otherwise 0
+int ggkLogGetAsync()
+{
+	return Logger::getAsync() ? 1 : 0;
+}
+
+// Returns the number of log messages that were dropped because the async ring was full
+unsigned long long ggkLogDropCount()
+{
+	return AsyncLogger::getInstance().getDropCount();
+}
+
+// Enables or disables the timestamp/thread ID prefix on asynchronously delivered messages
+void ggkLogSetAsyncStamping(int enabled)
+{
+	AsyncLogger::getInstance().setStamping(enabled != 0);
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 //  _   _           _       _                                                                                                     _
 // | | | |_ __   __| | __ _| |_ ___     __ _ _   _  ___ _   _  ___    _ __ ___   __ _ _ __   __ _  __ _  ___ _ __ ___   ___ _ __ | |_
@@ -115,6 +148,9 @@ void ggkLogRegisterAlways(GGKLogReceiver receiver) { Logger::registerAlwaysRecei
 //
 // Push/pop update notifications onto a queue. As these methods are where threads collide (i.e., this is how they communicate),
 // these methods are thread-safe.
+//
+// The queue itself (see UpdateQueue.cpp) is lock-free and stores resolved interfaces rather than strings. The string-based
+// push/pop methods below are kept for compatibility and translate to and from those interfaces.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 // Adds an update to the front of the queue for a characteristic at the given object path
@@ -122,7 +158,7 @@ void ggkLogRegisterAlways(GGKLogReceiver receiver) { Logger::registerAlwaysRecei
 // Returns non-zero value on success or 0 on failure.
 int ggkNofifyUpdatedCharacteristic(const char *pObjectPath)
 {
-	return ggkPushUpdateQueue(pObjectPath, "org.bluez.GattCharacteristic1") != 0;
+	return ggkPushUpdateQueue(pObjectPath, GattCharacteristic::kInterfaceName) != 0;
 }
 
 // Adds an update to the front of the queue for a descriptor at the given object path
@@ -130,7 +166,7 @@ int ggkNofifyUpdatedCharacteristic(const char *pObjectPath)
 // Returns non-zero value on success or 0 on failure.
 int ggkNofifyUpdatedDescriptor(const char *pObjectPath)
 {
-	return ggkPushUpdateQueue(pObjectPath, "org.bluez.GattDescriptor1") != 0;
+	return ggkPushUpdateQueue(pObjectPath, GattDescriptor::kInterfaceName) != 0;
 }
 
 // Adds a named update to the front of the queue. Generally, this routine should not be used directly. Instead, use the
@@ -139,11 +175,20 @@ int ggkNofifyUpdatedDescriptor(const char *pObjectPath)
 // Returns non-zero value on success or 0 on failure.
 int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName)
 {
-	QueueEntry t(pObjectPath, pInterfaceName);
+	if (nullptr == TheServer || nullptr == pObjectPath || nullptr == pInterfaceName)
+	{
+		return 0;
+	}
 
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	updateQueue.push_front(t);
-	return 1;
+	// Resolve the interface now so the server thread doesn't have to
+	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(pObjectPath, pInterfaceName);
+	if (nullptr == pInterface)
+	{
+		GGK_LOG_WARN(SSTR << "Unable to find interface for update: path[" << pObjectPath << "], name[" << pInterfaceName << "]");
+		return 0;
+	}
+
+	return UpdateQueue::getInstance().push(pInterface.get()) ? 1 : 0;
 }
 
 // Get the next update from the back of the queue and returns the element in `element` as a string in the format:
@@ -161,26 +206,39 @@ int ggkPushUpdateQueue(const char *pObjectPath, const char *pInterfaceName)
 // Returns 1 on success, 0 if the queue is empty, -1 on error (such as the length too small to store the element)
 int ggkPopUpdateQueue(char *pElementBuffer, int elementLen, int keep)
 {
-	std::string result;
+	UpdateQueue &queue = UpdateQueue::getInstance();
 
-	{
-		std::lock_guard<std::mutex> guard(updateQueueMutex);
-
-		// Check for an empty queue
-		if (updateQueue.empty()) { return 0; }
+	// Check for an empty queue
+	const DBusInterface *pInterface = nullptr;
+	if (!queue.peek(pInterface)) { return 0; }
 
-		// Get the last element
-		QueueEntry t = updateQueue.back();
+	// Get the result string
+	std::string result = pInterface->getPath().toString() + "|" + pInterface->getName();
 
-		// Get the result string
-		result = std::get<0>(t) + "|" + std::get<1>(t);
+	// Ensure there's enough room for it
+	if (result.length() + 1 > static_cast<size_t>(elementLen)) { return -1; }
 
-		// Ensure there's enough room for it
-		if (result.length() + 1 > static_cast<size_t>(elementLen)) { return -1; }
+	if (keep == 0)
+	{
+		// The server thread and EDropOldest producers also pop, so the head may have changed since we peeked; report the entry
+		// we actually removed
+		const DBusInterface *pPeeked = pInterface;
+		if (!queue.pop(pInterface)) { return 0; }
+		queue.release(pInterface);
 
-		if (keep == 0)
+		if (pInterface != pPeeked)
 		{
-			updateQueue.pop_back();
+			result = pInterface->getPath().toString() + "|" + pInterface->getName();
+
+			// It can't go back at the head, so it is queued again behind any other pending updates
+			if (result.length() + 1 > static_cast<size_t>(elementLen))
+			{
+				if (!queue.push(pInterface))
+				{
+					GGK_LOG_WARN(SSTR << "Update lost while re-queueing: path[" << pInterface->getPath() << "], name[" << pInterface->getName() << "]");
+				}
+				return -1;
+			}
 		}
 	}
 
@@ -193,22 +251,140 @@ int ggkPopUpdateQueue(char *pElementBuffer, int elementLen, int keep)
 // Returns 1 if the queue is empty, otherwise 0
 int ggkUpdateQueueIsEmpty()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	return updateQueue.empty() ? 1 : 0;
+	return UpdateQueue::getInstance().empty() ? 1 : 0;
 }
 
 // Returns the number of entries waiting in the queue
 int ggkUpdateQueueSize()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	return updateQueue.size();
+	return static_cast<int>(UpdateQueue::getInstance().size());
 }
 
 // Removes all entries from the queue
 void ggkUpdateQueueClear()
 {
-	std::lock_guard<std::mutex> guard(updateQueueMutex);
-	updateQueue.clear();
+	UpdateQueue::getInstance().clear();
+}
+
+// Sets the update queue's overflow policy (the default is EDropNewest)
+void ggkUpdateQueueSetOverflowPolicy(GGKUpdateQueueOverflowPolicy policy)
+{
+	UpdateQueue::getInstance().setOverflowPolicy(policy);
+}
+
+// Returns the update queue's overflow policy
+GGKUpdateQueueOverflowPolicy ggkUpdateQueueGetOverflowPolicy()
+{
+	return UpdateQueue::getInstance().getOverflowPolicy();
+}
+
+// Returns the maximum number of entries the queue can hold
+int ggkUpdateQueueCapacity()
+{
+	return static_cast<int>(UpdateQueue::kCapacity);
+}
+
+// Returns the number of updates that have been discarded because the queue was full
+unsigned long long ggkUpdateQueueDropCount()
+{
+	return UpdateQueue::getInstance().getDropCount();
+}
+
+// Sets the maximum number of updates processed per batch
+void ggkUpdateQueueSetBatchSize(int batchSize)
+{
+	UpdateQueue::getInstance().setBatchSize(batchSize);
+}
+
+// Returns the maximum number of updates processed per batch
+int ggkUpdateQueueGetBatchSize()
+{
+	return UpdateQueue::getInstance().getBatchSize();
+}
+
+// Retrieves the batch latency histogram
+//
+// Returns the number of buckets copied
+int ggkUpdateQueueGetLatencyHistogram(unsigned long long *pBuckets, int bucketCount)
+{
+	if (nullptr == pBuckets || bucketCount <= 0) { return 0; }
+
+	uint64_t buckets[UpdateQueue::kLatencyBuckets];
+	int count = UpdateQueue::getInstance().getLatencyHistogram(buckets, bucketCount);
+	for (int i = 0; i < count; ++i)
+	{
+		pBuckets[i] = buckets[i];
+	}
+
+	return count;
+}
+
+// Enables or disables update coalescing
+void ggkUpdateQueueSetCoalescing(int enabled)
+{
+	UpdateQueue::getInstance().setCoalescing(enabled != 0);
+}
+
+// Returns non-zero if update coalescing is enabled
+int ggkUpdateQueueGetCoalescing()
+{
+	return UpdateQueue::getInstance().getCoalescing() ? 1 : 0;
+}
+
+// Returns the number of updates that were collapsed into an already-waiting update
+unsigned long long ggkUpdateQueueCoalescedCount()
+{
+	return UpdateQueue::getInstance().getCoalescedCount();
+}
+
+// Sets the minimum interval, in milliseconds, between updates for the characteristic at the given object path (0 = no limit)
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkSetMinNotifyInterval(const char *pObjectPath, int intervalMS)
+{
+	return ggkSetMinUpdateInterval(pObjectPath, GattCharacteristic::kInterfaceName, intervalMS) != 0;
+}
+
+// Sets the minimum interval, in milliseconds, between updates for the named interface at the given object path (0 = no limit)
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkSetMinUpdateInterval(const char *pObjectPath, const char *pInterfaceName, int intervalMS)
+{
+	if (nullptr == TheServer || nullptr == pObjectPath || nullptr == pInterfaceName)
+	{
+		return 0;
+	}
+
+	const DBusObject *pObject = TheServer->findObject(pObjectPath);
+	if (nullptr == pObject)
+	{
+		return 0;
+	}
+
+	for (const std::shared_ptr<DBusInterface> &pInterface : pObject->getInterfaces())
+	{
+		if (strcmp(pInterface->getName().c_str(), pInterfaceName) == 0)
+		{
+			pInterface->setMinUpdateInterval(intervalMS);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Enables or disables subtree registration with D-Bus (disabled by default)
+//
+// This takes effect the next time the server registers its objects, so it should be called before `ggkStart()`.
+void ggkSetSubtreeRegistration(int enabled)
+{
+	setSubtreeRegistration(enabled != 0);
+}
+
+// Returns non-zero if subtree registration is enabled
+int ggkGetSubtreeRegistration()
+{
+	return getSubtreeRegistration() ? 1 : 0;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -279,6 +455,100 @@ const char *ggkGetServerHealthString(GGKServerHealth state)
 	}
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Connections
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Converts a connection table entry into the public structure
+static void connectionInfoFromConnection(const ConnectionTable::Connection &connection, GGKConnectionInfo &info)
+{
+	snprintf(info.address, sizeof(info.address), "%s", ConnectionTable::addressString(connection.address).c_str());
+	info.addressType = connection.addressType;
+	info.connectTimeMS = connection.connectTimeMS;
+	info.mtu = connection.mtu;
+
+	// Intervals are in units of 1.25ms and the timeout in units of 10ms
+	info.minIntervalUS = connection.minInterval * 1250;
+	info.maxIntervalUS = connection.maxInterval * 1250;
+	info.latency = connection.latency;
+	info.supervisionTimeoutMS = connection.supervisionTimeout * 10;
+	info.bytesIn = connection.bytesIn;
+	info.bytesOut = connection.bytesOut;
+}
+
+// Returns the number of active connections
+int ggkGetConnectionCount()
+{
+	return HciAdapter::getInstance().getActiveConnectionCount();
+}
+
+// Fills `pConnections` with up to `maxConnections` active connections, returning the number filled
+//
+// This may be called from any thread and never blocks.
+int ggkGetConnections(GGKConnectionInfo *pConnections, int maxConnections)
+{
+	if (nullptr == pConnections || maxConnections <= 0)
+	{
+		return 0;
+	}
+
+	ConnectionTable::Connection connections[ConnectionTable::kMaxConnections];
+	int count = HciAdapter::getInstance().getConnections().snapshot(connections, std::min(maxConnections, static_cast<int>(ConnectionTable::kMaxConnections)));
+	for (int i = 0; i < count; ++i)
+	{
+		connectionInfoFromConnection(connections[i], pConnections[i]);
+	}
+
+	return count;
+}
+
+// Fills `pConnection` with the connection to the peer with the given address ("AA:BB:CC:DD:EE:FF")
+//
+// Returns non-zero if the peer is connected, otherwise 0.
+int ggkGetConnection(const char *pAddress, GGKConnectionInfo *pConnection)
+{
+	uint8_t address[6];
+	ConnectionTable::Connection connection;
+	if (nullptr == pConnection || !ConnectionTable::addressFromString(pAddress, address) ||
+		!HciAdapter::getInstance().getConnections().find(address, connection))
+	{
+		return 0;
+	}
+
+	connectionInfoFromConnection(connection, *pConnection);
+	return 1;
+}
+
+// Sets the advertising and scan response data of an advertising instance, adding the instance if it doesn't exist
+//
+// The data is updated in place, without powering the adapter off, so connections are unaffected and an update costs a single
+// round trip to the kernel (none if the data hasn't changed.) With several instances, the kernel rotates through them, advertising
+// each for `durationS` seconds (0 for the kernel's default.)
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkSetAdvertisingInstance(int instance, const RawAdvertisingData *pData, int durationS)
+{
+	if (nullptr == pData || instance < 1 || instance > AdvertisingManager::kMaxInstances || durationS < 0 || durationS > 0xffff)
+	{
+		return 0;
+	}
+
+	return AdvertisingManager::getInstance().setInstance(static_cast<uint8_t>(instance), pData->advData, pData->advDataLen, pData->rspData, pData->rspDataLen, static_cast<uint16_t>(durationS)) ? 1 : 0;
+}
+
+// Removes an advertising instance (or every instance, if `instance` is 0)
+//
+// Returns non-zero value on success or 0 on failure.
+int ggkRemoveAdvertisingInstance(int instance)
+{
+	if (instance < 0 || instance > AdvertisingManager::kMaxInstances)
+	{
+		return 0;
+	}
+
+	return AdvertisingManager::getInstance().removeInstance(static_cast<uint8_t>(instance)) ? 1 : 0;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 //  ____  _                 _   _
 // / ___|| |_ ___  _ __    | |_| |__   ___    ___  ___ _ ____   _____ _ __
@@ -340,7 +610,7 @@ int ggkWait()
 	{
 		if (ggkGetServerRunState() <= ERunning)
 		{
-			Logger::info("Waiting for GGK server to stop");
+			GGK_LOG_INFO("Waiting for GGK server to stop");
 		}
 
 		if (serverThread.joinable())
@@ -354,19 +624,19 @@ int ggkWait()
 	{
 		if (ex.code() == std::errc::invalid_argument)
 		{
-			Logger::warn(SSTR << "Server thread was not joinable during ggkWait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Server thread was not joinable during ggkWait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::no_such_process)
 		{
-			Logger::warn(SSTR << "Server thread was not valid during ggkWait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Server thread was not valid during ggkWait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::resource_deadlock_would_occur)
 		{
-			Logger::warn(SSTR << "Deadlock avoided in call to ggkWait() (did the server thread try to stop itself?): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Deadlock avoided in call to ggkWait() (did the server thread try to stop itself?): " << ex.what());
 		}
 		else
 		{
-			Logger::warn(SSTR << "Unknown system_error code (" << ex.code() << ") during ggkWait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Unknown system_error code (" << ex.code() << ") during ggkWait(): " << ex.what());
 		}
 	}
 
@@ -450,38 +720,38 @@ int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char
 		// Redirect GLib output to this log method
 		printHandlerGLib = g_set_print_handler([](const gchar *string)
 		{
-			Logger::info(string);
+			GGK_LOG_INFO(string);
 		});
 		printerrHandlerGLib = g_set_printerr_handler([](const gchar *string)
 		{
-			Logger::error(string);
+			GGK_LOG_ERROR(string);
 		});
 		logHandlerGLib = g_log_set_default_handler([](const gchar *log_domain, GLogLevelFlags log_levels, const gchar *message, gpointer /*user_data*/)
 		{
 			std::string str = std::string(log_domain) + ": " + message;
 			if ((log_levels & (G_LOG_FLAG_RECURSION|G_LOG_FLAG_FATAL)) != 0)
 			{
-				Logger::fatal(str);
+				GGK_LOG_FATAL(str);
 			}
 			else if ((log_levels & (G_LOG_LEVEL_CRITICAL|G_LOG_LEVEL_ERROR)) != 0)
 			{
-				Logger::error(str);
+				GGK_LOG_ERROR(str);
 			}
 			else if ((log_levels & G_LOG_LEVEL_WARNING) != 0)
 			{
-				Logger::warn(str);
+				GGK_LOG_WARN(str);
 			}
 			else if ((log_levels & G_LOG_LEVEL_DEBUG) != 0)
 			{
-				Logger::debug(str);
+				GGK_LOG_DEBUG(str);
 			}
 			else
 			{
-				Logger::info(str);
+				GGK_LOG_INFO(str);
 			}
 		}, nullptr);
 
-		Logger::info(SSTR << "Starting GGK server '" << pAdvertisingName << "'");
+		GGK_LOG_INFO(SSTR << "Starting GGK server '" << pAdvertisingName << "'");
 
 		// Allocate our server
 		TheServer = std::make_shared<Server>(pServiceName, pAdvertisingName, pAdvertisingShortName, getter, setter, advData );
@@ -493,24 +763,28 @@ int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char
 		}
 		catch(std::system_error &ex)
 		{
-			Logger::error(SSTR << "Server thread was unable to start (code " << ex.code() << ") during ggkStart(): " << ex.what());
+			GGK_LOG_ERROR(SSTR << "Server thread was unable to start (code " << ex.code() << ") during ggkStart(): " << ex.what());
 
 			setServerRunState(EStopped);
 			return 0;
 		}
 
 		// Waits for the server to pass the EInitializing state
-		int retryTimeMS = 0;
-		while (retryTimeMS < maxAsyncInitTimeoutMS && ggkGetServerRunState() <= EInitializing)
+		//
+		// The server thread signals every state change, so we wake as soon as initialization completes (or fails.)
+		bool initialized = false;
 		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(kMaxAsyncInitCheckIntervalMS));
-			retryTimeMS += kMaxAsyncInitCheckIntervalMS;
+			std::unique_lock<std::mutex> lock(serverRunStateMutex);
+			initialized = serverRunStateChanged.wait_for(lock, std::chrono::milliseconds(maxAsyncInitTimeoutMS), []
+			{
+				return serverRunState > EInitializing;
+			});
 		}
 
 		// If something went wrong, shut down
-		if (retryTimeMS >= maxAsyncInitTimeoutMS)
+		if (!initialized)
 		{
-			Logger::error("GGK server initialization timed out");
+			GGK_LOG_ERROR("GGK server initialization timed out");
 
 			setServerHealth(EFailedInit);
 
@@ -522,19 +796,19 @@ int ggkStart(const char *pServiceName, const char *pAdvertisingName, const char
 		{
 			if (!ggkWait())
 			{
-				Logger::warn(SSTR << "Unable to stop the server after an error in ggkStart()");
+				GGK_LOG_WARN(SSTR << "Unable to stop the server after an error in ggkStart()");
 			}
 
 			return 0;
 		}
 
 		// Everything looks good
-		Logger::trace("GGK server has started");
+		GGK_LOG_TRACE("GGK server has started");
 		return 1;
 	}
 	catch(...)
 	{
-		Logger::error(SSTR << "Unknown exception during ggkStart()");
+		GGK_LOG_ERROR(SSTR << "Unknown exception during ggkStart()");
 		return 0;
 	}
 }
@@ -40,11 +40,26 @@
 // However, for initialization, it seems to be generally safe to treat them as "nearly 1:1". The solution below is to consume all
 // events and look for the event that we're waiting on. This seems to work in my environment (Raspberry Pi) fairly well, but please
 // do use this with caution.
+//
+// COMMANDS AND RESPONSES:
+//
+// Each command sent to the adapter is answered by a Command Complete or Command Status event carrying the command's code and
+// controller index. The kernel processes a socket's commands in the order they were written, so we keep a list of commands
+// awaiting a response and hand each response to the oldest command with a matching code and controller. Every command carries a
+// promise that the event thread fulfills when its response arrives, which means that several commands can be in flight at once:
+// `submitCommand()` writes a command and returns immediately, and `waitForCommand()` collects the response later. No thread is
+// created per command; `sendCommand()` is simply a submit followed by a wait.
+//
+// Events are decoded in place, in the HCI socket's receive buffer, through bounds-checked views (see `EventView`.) Each event
+// code indexes a table of handlers, so the event thread does no heap allocation for the events it handles in steady state.
+//
+// A response resolves its command with a `CommandResult` holding the response's status code and return parameters. A command the
+// adapter rejects therefore fails as soon as its Command Status event arrives, rather than looking like a success (or waiting out
+// the timeout.) Only a command that gets no response at all waits for kMaxEventWaitTimeMS.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <string.h>
 #include <chrono>
-#include <future>
 
 #include "HciAdapter.h"
 #include "HciSocket.h"
@@ -200,6 +215,49 @@ const char * const HciAdapter::kStatusCodes[kMaxStatusCode + 1] =
 	"Permission Denied",                                 // 0x14
 };
 
+// Our event handlers, indexed by event code (nullptr for events we ignore)
+const HciAdapter::EventHandler HciAdapter::kEventHandlers[kMaxEventType + 1] =
+{
+	nullptr,                                             // 0x0000 Invalid Event
+	&HciAdapter::onCommandComplete,                      // 0x0001 Command Complete Event
+	&HciAdapter::onCommandStatus,                        // 0x0002 Command Status Event
+	nullptr,                                             // 0x0003 Controller Error Event
+	nullptr,                                             // 0x0004 Index Added Event
+	nullptr,                                             // 0x0005 Index Removed Event
+	nullptr,                                             // 0x0006 New Settings Event
+	nullptr,                                             // 0x0007 Class Of Device Changed Event
+	nullptr,                                             // 0x0008 Local Name Changed Event
+	nullptr,                                             // 0x0009 New Link Key Event
+	nullptr,                                             // 0x000A New Long Term Key Event
+	&HciAdapter::onDeviceConnected,                      // 0x000B Device Connected Event
+	&HciAdapter::onDeviceDisconnected,                   // 0x000C Device Disconnected Event
+	nullptr,                                             // 0x000D Connect Failed Event
+	nullptr,                                             // 0x000E PIN Code Request Event
+	nullptr,                                             // 0x000F User Confirmation Request Event
+	nullptr,                                             // 0x0010 User Passkey Request Event
+	nullptr,                                             // 0x0011 Authentication Failed Event
+	nullptr,                                             // 0x0012 Device Found Event
+	nullptr,                                             // 0x0013 Discovering Event
+	nullptr,                                             // 0x0014 Device Blocked Event
+	nullptr,                                             // 0x0015 Device Unblocked Event
+	nullptr,                                             // 0x0016 Device Unpaired Event
+	nullptr,                                             // 0x0017 Passkey Notify Event
+	nullptr,                                             // 0x0018 New Identity Resolving Key Event
+	nullptr,                                             // 0x0019 New Signature Resolving Key Event
+	nullptr,                                             // 0x001a Device Added Event
+	nullptr,                                             // 0x001b Device Removed Event
+	&HciAdapter::onNewConnectionParameter,               // 0x001c New Connection Parameter Event
+	nullptr,                                             // 0x001d Unconfigured Index Added Event
+	nullptr,                                             // 0x001e Unconfigured Index Removed Event
+	nullptr,                                             // 0x001f New Configuration Options Event
+	nullptr,                                             // 0x0020 Extended Index Added Event
+	nullptr,                                             // 0x0021 Extended Index Removed Event
+	nullptr,                                             // 0x0022 Local Out Of Band Extended Data Updated Event
+	nullptr,                                             // 0x0023 Advertising Added Event
+	nullptr,                                             // 0x0024 Advertising Removed Event
+	nullptr                                              // 0x0025 Extended Controller Information Changed Event
+};
+
 // Our thread interface, which simply launches our the thread processor on our HciAdapter instance
 void runEventThread()
 {
@@ -213,166 +271,202 @@ void runEventThread()
 // It isn't necessary to disconnect manually; the HCI socket will get disocnnected automatically at before this method returns
 void HciAdapter::runEventThread()
 {
-	Logger::trace("Entering the HciAdapter event thread");
+	GGK_LOG_TRACE("Entering the HciAdapter event thread");
 
 	while (ggkGetServerRunState() <= ERunning && hciSocket.isConnected())
 	{
 		// Read the next event, waiting until one arrives
-		std::vector<uint8_t> responsePacket = std::vector<uint8_t>();
-		if (!hciSocket.read(responsePacket))
+		const uint8_t *pPacket = nullptr;
+		size_t packetLength = 0;
+		if (!hciSocket.read(pPacket, packetLength))
 		{
 			break;
 		}
 
+		// The event is decoded in place, in the socket's receive buffer
+		EventView event(pPacket, packetLength);
+
 		// Do we have enough to check the event code?
-		if (responsePacket.size() < 2)
+		if (event.size() < sizeof(HciHeader))
 		{
-			Logger::error(SSTR << "Invalid command response: too short");
+			GGK_LOG_ERROR(SSTR << "Invalid command response: too short");
 			continue;
 		}
 
-		// Our response, as a usable object type
-		uint16_t eventCode = Utils::endianToHost(*reinterpret_cast<uint16_t *>(responsePacket.data()));
-
 		// Ensure our event code is valid
+		uint16_t eventCode = event.code();
 		if (eventCode < HciAdapter::kMinEventType || eventCode > HciAdapter::kMaxEventType)
 		{
-			Logger::error(SSTR << "Invalid command response: event code (" << eventCode << ") out of range");
+			GGK_LOG_ERROR(SSTR << "Invalid command response: event code (" << eventCode << ") out of range");
 			continue;
 		}
 
-		switch(eventCode)
+		EventHandler handler = kEventHandlers[eventCode];
+		if (nullptr == handler)
 		{
-			// Command complete event
-			case Mgmt::ECommandCompleteEvent:
-			{
-				// Extract our event
-				CommandCompleteEvent event(responsePacket);
+			GGK_LOG_DEBUG(SSTR << "Ignoring event type: " << Utils::hex(eventCode) << " (" << kEventTypeNames[eventCode] << ")");
+			continue;
+		}
 
-				// Point to the data following the event
-				uint8_t *data = responsePacket.data() + sizeof(CommandCompleteEvent);
-				size_t dataLen = responsePacket.size() - sizeof(CommandCompleteEvent);
+		(this->*handler)(event);
+	}
 
-				switch(event.commandCode)
-				{
-					// We just log the version/revision info
-					case Mgmt::EReadVersionInformationCommand:
-					{
-						// Verify the size is what we expect
-						if (dataLen != sizeof(VersionInformation))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						versionInformation = *reinterpret_cast<VersionInformation *>(data);
-						versionInformation.toHost();
-						Logger::debug(versionInformation.debugText());
-						break;
-					}
-					case Mgmt::EReadControllerInformationCommand:
-					{
-						if (dataLen != sizeof(ControllerInformation))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						controllerInformation = *reinterpret_cast<ControllerInformation *>(data);
-						controllerInformation.toHost();
-						Logger::debug(controllerInformation.debugText());
-						break;
-					}
-					case Mgmt::ESetLocalNameCommand:
-					{
-						if (dataLen != sizeof(LocalName))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						localName = *reinterpret_cast<LocalName *>(data);
-						Logger::info(localName.debugText());
-						break;
-					}
-					case Mgmt::ESetPoweredCommand:
-					case Mgmt::ESetBREDRCommand:
-					case Mgmt::ESetSecureConnectionsCommand:
-					case Mgmt::ESetBondableCommand:
-					case Mgmt::ESetConnectableCommand:
-					case Mgmt::ESetLowEnergyCommand:
-					case Mgmt::ESetAdvertisingCommand:
-					{
-						if (dataLen != sizeof(AdapterSettings))
-						{
-							Logger::error("Invalid data length");
-							return;
-						}
-
-						adapterSettings = *reinterpret_cast<AdapterSettings *>(data);
-						adapterSettings.toHost();
-
-						Logger::debug(adapterSettings.debugText());
-						break;
-					}
-				}
+	// Make sure we're disconnected before we leave
+	hciSocket.disconnect();
 
-				// Notify anybody waiting that we received a response to their command code
-				setCommandResponse(event.commandCode);
+	// Nobody is left to answer any outstanding commands
+	failPendingCommands();
 
-				break;
-			}
-			// Command status event
-			case Mgmt::ECommandStatusEvent:
+	GGK_LOG_TRACE("Leaving the HciAdapter event thread");
+}
+
+// Handles a Command Complete event, recording any adapter information it carries and resolving the command that it answers
+void HciAdapter::onCommandComplete(const EventView &event)
+{
+	CommandCompleteEvent header;
+	if (!event.get(header))
+	{
+		GGK_LOG_ERROR("Invalid command complete event: too short");
+		return;
+	}
+
+	GGK_LOG_DEBUG(header.debugText());
+
+	// The return parameters follow the event
+	size_t offset = sizeof(CommandCompleteEvent);
+
+	// A failed command's return parameters (if any) don't describe the adapter's state, so we only record those of successful
+	// commands
+	if (EStatusSuccess == header.status)
+	{
+		switch(header.commandCode)
+		{
+			// We just log the version/revision info
+			case Mgmt::EReadVersionInformationCommand:
 			{
-				CommandStatusEvent event(responsePacket);
+				if (!event.get(versionInformation, offset))
+				{
+					GGK_LOG_ERROR("Invalid data length");
+					break;
+				}
 
-				// Notify anybody waiting that we received a response to their command code
-				setCommandResponse(event.commandCode);
+				GGK_LOG_DEBUG(versionInformation.debugText());
 				break;
 			}
-			// Command status event
-			case Mgmt::EDeviceConnectedEvent:
+			case Mgmt::EReadControllerInformationCommand:
 			{
-				DeviceConnectedEvent event(responsePacket);
-				activeConnections += 1;
-				Logger::debug(SSTR << "  > Connection count incremented to " << activeConnections);
+				if (!event.get(controllerInformation, offset))
+				{
+					GGK_LOG_ERROR("Invalid data length");
+					break;
+				}
+
+				GGK_LOG_DEBUG(controllerInformation.debugText());
 				break;
 			}
-			// Command status event
-			case Mgmt::EDeviceDisconnectedEvent:
+			case Mgmt::ESetLocalNameCommand:
 			{
-				DeviceDisconnectedEvent event(responsePacket);
-				if (activeConnections > 0)
-				{
-					activeConnections -= 1;
-					Logger::debug(SSTR << "  > Connection count decremented to " << activeConnections);
-				}
-				else
+				if (!event.get(localName, offset))
 				{
-					Logger::debug(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
+					GGK_LOG_ERROR("Invalid data length");
+					break;
 				}
+
+				GGK_LOG_INFO(localName.debugText());
 				break;
 			}
-			// Unsupported
-			default:
+			case Mgmt::ESetPoweredCommand:
+			case Mgmt::ESetBREDRCommand:
+			case Mgmt::ESetSecureConnectionsCommand:
+			case Mgmt::ESetBondableCommand:
+			case Mgmt::ESetConnectableCommand:
+			case Mgmt::ESetLowEnergyCommand:
+			case Mgmt::ESetAdvertisingCommand:
 			{
-				if (eventCode >= kMinEventType && eventCode <= kMaxEventType)
+				if (!event.get(adapterSettings, offset))
 				{
-					Logger::error("Unsupported response event type: " + Utils::hex(eventCode) + " (" + kEventTypeNames[eventCode] + ")");
-				}
-				else
-				{
-					Logger::error("Invalid event type response: " + Utils::hex(eventCode));					
+					GGK_LOG_ERROR("Invalid data length");
+					break;
 				}
+
+				GGK_LOG_DEBUG(adapterSettings.debugText());
+				break;
 			}
 		}
 	}
 
-	// Make sure we're disconnected before we leave
-	hciSocket.disconnect();
+	// Notify anybody waiting that we received a response to their command code
+	setCommandResponse(header.commandCode, header.header.controllerId, header.status, event.data(offset), event.dataLength(offset));
+}
+
+// Handles a Command Status event, resolving the command that it answers
+void HciAdapter::onCommandStatus(const EventView &event)
+{
+	CommandStatusEvent header;
+	if (!event.get(header))
+	{
+		GGK_LOG_ERROR("Invalid command status event: too short");
+		return;
+	}
+
+	GGK_LOG_DEBUG(header.debugText());
 
-	Logger::trace("Leaving the HciAdapter event thread");
+	// Notify anybody waiting that we received a response to their command code
+	setCommandResponse(header.commandCode, header.header.controllerId, header.status, nullptr, 0);
+}
+
+// Handles a Device Connected event
+void HciAdapter::onDeviceConnected(const EventView &event)
+{
+	DeviceConnectedEvent connected;
+	if (!event.get(connected))
+	{
+		GGK_LOG_ERROR("Invalid device connected event: too short");
+		return;
+	}
+
+	GGK_LOG_DEBUG(connected.debugText());
+
+	connections.connected(connected.address, connected.addressType);
+	GGK_LOG_DEBUG(SSTR << "  > Connection count incremented to " << connections.count());
+}
+
+// Handles a Device Disconnected event
+void HciAdapter::onDeviceDisconnected(const EventView &event)
+{
+	DeviceDisconnectedEvent disconnected;
+	if (!event.get(disconnected))
+	{
+		GGK_LOG_ERROR("Invalid device disconnected event: too short");
+		return;
+	}
+
+	GGK_LOG_DEBUG(disconnected.debugText());
+
+	if (connections.count() > 0)
+	{
+		connections.disconnected(disconnected.address, disconnected.addressType);
+		GGK_LOG_DEBUG(SSTR << "  > Connection count decremented to " << connections.count());
+	}
+	else
+	{
+		GGK_LOG_DEBUG(SSTR << "  > Connection count already at zero, ignoring non-connected disconnect event");
+	}
+}
+
+// Handles a New Connection Parameter event (the peer asked for new connection parameters)
+void HciAdapter::onNewConnectionParameter(const EventView &event)
+{
+	NewConnectionParameterEvent parameters;
+	if (!event.get(parameters))
+	{
+		GGK_LOG_ERROR("Invalid new connection parameter event: too short");
+		return;
+	}
+
+	GGK_LOG_DEBUG(parameters.debugText());
+
+	connections.parametersChanged(parameters.address, parameters.addressType, parameters.minInterval, parameters.maxInterval, parameters.latency, parameters.supervisionTimeout);
 }
 
 // Reads current values from the controller
@@ -381,27 +475,29 @@ void HciAdapter::runEventThread()
 // milliseconds. Therefore, it is not recommended attempt to retrieve the results from their accessors immediately.
 void HciAdapter::sync(uint16_t controllerIndex)
 {
-	Logger::debug("Synchronizing version information");
-
-	HciAdapter::HciHeader request;
-	request.code = Mgmt::EReadVersionInformationCommand;
-	request.controllerId = HciAdapter::kNonController;
-	request.dataSize = 0;
-
-	if (!HciAdapter::getInstance().sendCommand(request))
+	GGK_LOG_DEBUG("Synchronizing version information and controller information");
+
+	// The two requests are independent, so we send them back-to-back and then wait for both
+	HciAdapter::HciHeader versionRequest;
+	versionRequest.code = Mgmt::EReadVersionInformationCommand;
+	versionRequest.controllerId = HciAdapter::kNonController;
+	versionRequest.dataSize = 0;
+	CommandTicket versionTicket = submitCommand(versionRequest);
+
+	HciAdapter::HciHeader controllerRequest;
+	controllerRequest.code = Mgmt::EReadControllerInformationCommand;
+	controllerRequest.controllerId = controllerIndex;
+	controllerRequest.dataSize = 0;
+	CommandTicket controllerTicket = submitCommand(controllerRequest);
+
+	if (!waitForCommand(versionTicket).succeeded())
 	{
-		Logger::error("Failed to get version information");
+		GGK_LOG_ERROR("Failed to get version information");
 	}
 
-	Logger::debug("Synchronizing controller information");
-
-	request.code = Mgmt::EReadControllerInformationCommand;
-	request.controllerId = controllerIndex;
-	request.dataSize = 0;
-
-	if (!HciAdapter::getInstance().sendCommand(request))
+	if (!waitForCommand(controllerTicket).succeeded())
 	{
-		Logger::error("Failed to get current settings");
+		GGK_LOG_ERROR("Failed to get current settings");
 	}
 }
 
@@ -437,19 +533,22 @@ bool HciAdapter::start()
 	}
 	catch(std::system_error &ex)
 	{
-		Logger::error(SSTR << "HciAdapter thread was unable to start (code " << ex.code() << "): " << ex.what());
+		GGK_LOG_ERROR(SSTR << "HciAdapter thread was unable to start (code " << ex.code() << "): " << ex.what());
 		return false;
 	}
 
 	return true;
 }
 
-// Waits for the HciAdapter run thread to join
+// Wakes the HciAdapter run thread and waits for it to join
 //
 // This method will block until the thread joins
 void HciAdapter::stop()
 {
-	Logger::trace("HciAdapter waiting for thread termination");
+	GGK_LOG_TRACE("HciAdapter waiting for thread termination");
+
+	// Wake the event thread, which blocks until the adapter sends something
+	hciSocket.signalShutdown();
 
 	try
 	{
@@ -457,58 +556,84 @@ void HciAdapter::stop()
 		{
 			eventThread.join();
 
-			Logger::trace("Event thread has stopped");
+			GGK_LOG_TRACE("Event thread has stopped");
 		}
 		else
 		{
-			Logger::trace(" > Event thread is not joinable");
+			GGK_LOG_TRACE(" > Event thread is not joinable");
 		}
 	}
 	catch(std::system_error &ex)
 	{
 		if (ex.code() == std::errc::invalid_argument)
 		{
-			Logger::warn(SSTR << "HciAdapter event thread was not joinable during HciAdapter::wait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "HciAdapter event thread was not joinable during HciAdapter::wait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::no_such_process)
 		{
-			Logger::warn(SSTR << "HciAdapter event was not valid during HciAdapter::wait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "HciAdapter event was not valid during HciAdapter::wait(): " << ex.what());
 		}
 		else if (ex.code() == std::errc::resource_deadlock_would_occur)
 		{
-			Logger::warn(SSTR << "Deadlock avoided in call to HciAdapter::wait() (did the event thread try to stop itself?): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Deadlock avoided in call to HciAdapter::wait() (did the event thread try to stop itself?): " << ex.what());
 		}
 		else
 		{
-			Logger::warn(SSTR << "Unknown system_error code (" << ex.code() << ") during HciAdapter::wait(): " << ex.what());
+			GGK_LOG_WARN(SSTR << "Unknown system_error code (" << ex.code() << ") during HciAdapter::wait(): " << ex.what());
 		}
 	}
 }
 
-// Sends a command over the HCI socket
+// Sends a command over the HCI socket and waits for its response
 //
 // If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
 // a failure is returned.
 //
-// Returns true on success, otherwise false
-bool HciAdapter::sendCommand(HciHeader &request)
+// Returns the command's result as soon as its response arrives (see `CommandResult::succeeded()`)
+HciAdapter::CommandResult HciAdapter::sendCommand(HciHeader &request)
+{
+	CommandTicket ticket = submitCommand(request);
+	return waitForCommand(ticket);
+}
+
+// Sends a command over the HCI socket without waiting for its response
+//
+// Any number of commands may be submitted back-to-back; the adapter processes them in order and each response is matched to
+// its command as it arrives. Pass the returned ticket to `waitForCommand()` to collect the response. Note that `request` is
+// converted to network byte order in the process.
+HciAdapter::CommandTicket HciAdapter::submitCommand(HciHeader &request)
 {
+	CommandTicket ticket;
+	ticket.sequence = 0;
+	ticket.code = request.code;
+
 	// Auto-connect
 	if (!eventThread.joinable() && !start())
 	{
-		Logger::error("HciAdapter failed to start");
-		return false;
+		GGK_LOG_ERROR("HciAdapter failed to start");
+		std::promise<CommandResult> failed;
+		failed.set_value(CommandResult());
+		ticket.response = failed.get_future();
+		return ticket;
 	}
 
-	uint16_t code = request.code;
 	uint16_t dataSize = request.dataSize;
 
-	conditionalValue = -1;
-	std::future<bool> fut = std::async(std::launch::async,
-	[&]() mutable
+	// Register the command before it is written, since the response may arrive before `write()` returns
 	{
-		return waitForCommandResponse(code, kMaxEventWaitTimeMS);
-	});
+		std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+
+		PendingCommand pending;
+		pending.sequence = nextSequence++;
+		pending.code = request.code;
+		pending.controllerId = request.controllerId;
+		pending.abandoned = false;
+		ticket.sequence = pending.sequence;
+		ticket.response = pending.response.get_future();
+		pendingCommands.push_back(std::move(pending));
+
+		if (0 == nextSequence) { nextSequence = 1; }
+	}
 
 	// Prepare the request to be sent (endianness correction)
 	request.toNetwork();
@@ -517,46 +642,115 @@ bool HciAdapter::sendCommand(HciHeader &request)
 	std::vector<uint8_t> requestPacket = std::vector<uint8_t>(pRequest, pRequest + sizeof(request) + dataSize);
 	if (!hciSocket.write(requestPacket))
 	{
-		return false;
+		std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+		for (auto it = pendingCommands.begin(); it != pendingCommands.end(); ++it)
+		{
+			if (it->sequence == ticket.sequence)
+			{
+				it->response.set_value(CommandResult());
+				pendingCommands.erase(it);
+				break;
+			}
+		}
 	}
 
-	return fut.get();
+	return ticket;
 }
 
-// Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
+// Waits up to `timeoutMS` milliseconds for the response to a command sent with `submitCommand()`
 //
-// Returns true if the response event was received for `commandCode` or false if the timeout expired.
-//
-// Command responses are set via `setCommandResponse()`
-bool HciAdapter::waitForCommandResponse(uint16_t commandCode, int timeoutMS)
+// Returns the command's result. If no response arrived in time, the result's `responded` is false and the command is abandoned:
+// its response is discarded if it arrives later.
+HciAdapter::CommandResult HciAdapter::waitForCommand(CommandTicket &ticket, int timeoutMS)
 {
-	Logger::debug(SSTR << "  + Waiting on command code " << commandCode << " for up to " << timeoutMS << "ms");
+	if (!ticket.response.valid())
+	{
+		return CommandResult();
+	}
+
+	GGK_LOG_DEBUG(SSTR << "  + Waiting on command code " << ticket.code << " for up to " << timeoutMS << "ms");
 
-	bool success = cvCommandResponse.wait_for(commandResponseLock, std::chrono::milliseconds(timeoutMS),
-		[&]
+	if (std::future_status::ready == ticket.response.wait_for(std::chrono::milliseconds(timeoutMS)))
+	{
+		CommandResult result = ticket.response.get();
+		if (result.succeeded())
+		{
+			GGK_LOG_DEBUG(SSTR << "  + Recieved the command code we were waiting for: " << Utils::hex(ticket.code) << " (" << kCommandCodeNames[ticket.code] << ")");
+		}
+		else if (result.responded)
 		{
-			return conditionalValue == commandCode;
+			GGK_LOG_WARN(SSTR << "  + Command code " << Utils::hex(ticket.code) << " (" << kCommandCodeNames[ticket.code] << ") failed: " << result.statusText());
 		}
-	);
+		return result;
+	}
 
-	if (!success)
+	GGK_LOG_WARN(SSTR << "  + Timed out waiting on command code " << Utils::hex(ticket.code) << " (" << kCommandCodeNames[ticket.code] << ")");
+
+	// Leave the command in place, marked as abandoned, so that a late response is consumed by it rather than being mistaken for
+	// the response to a later command with the same code (see `setCommandResponse()`)
+	std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+	for (PendingCommand &pending : pendingCommands)
 	{
-		Logger::warn(SSTR << "  + Timed out waiting on command code " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+		if (pending.sequence == ticket.sequence)
+		{
+			pending.abandoned = true;
+			break;
+		}
 	}
-	else
+
+	return CommandResult();
+}
+
+// Resolves the oldest command awaiting a response with the given command code and controller
+//
+// Called from the event thread when a Command Complete or Command Status event arrives, with the status and any return
+// parameters from the event. If that command was abandoned, the response is discarded.
+//
+// The adapter answers commands in the order they were sent, so any abandoned command older than the one being answered will
+// never see its response and is reaped here.
+void HciAdapter::setCommandResponse(uint16_t commandCode, uint16_t controllerId, uint8_t status, const uint8_t *pPayload, size_t payloadLength)
+{
+	std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+	for (auto it = pendingCommands.begin(); it != pendingCommands.end(); ++it)
 	{
-		Logger::debug(SSTR << "  + Recieved the command code we were waiting for: " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+		if (it->code != commandCode || it->controllerId != controllerId)
+		{
+			continue;
+		}
+
+		for (auto older = pendingCommands.begin(); older != it;)
+		{
+			older = older->abandoned ? pendingCommands.erase(older) : std::next(older);
+		}
+
+		if (it->abandoned)
+		{
+			GGK_LOG_DEBUG(SSTR << "  + Discarding late response to command code " << Utils::hex(commandCode) << " (" << kCommandCodeNames[commandCode] << ")");
+		}
+		else
+		{
+			it->response.set_value(CommandResult(status, pPayload, payloadLength));
+		}
+
+		pendingCommands.erase(it);
+		return;
 	}
 
-	return success;
+	GGK_LOG_DEBUG(SSTR << "  + Ignoring response to command code " << Utils::hex(commandCode) << " that nobody is waiting for");
 }
 
-// Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-void HciAdapter::setCommandResponse(uint16_t commandCode)
+// Fails every command awaiting a response (used when the event thread stops, since no more responses will arrive)
+void HciAdapter::failPendingCommands()
 {
-	std::lock_guard<std::mutex> lk(commandResponseMutex);
-	conditionalValue = commandCode;
-	cvCommandResponse.notify_one();
+	std::lock_guard<std::mutex> lock(pendingCommandsMutex);
+	for (PendingCommand &pending : pendingCommands)
+	{
+		if (!pending.abandoned)
+		{
+			pending.response.set_value(CommandResult());
+		}
+	}
+	pendingCommands.clear();
 }
 
 }; // namespace ggk
\ No newline at end of file
@@ -25,12 +25,15 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include <vector>
+#include <list>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
+#include <future>
 
 #include "HciSocket.h"
+#include "ConnectionTable.h"
 #include "Utils.h"
 #include "Logger.h"
 
@@ -89,6 +92,32 @@ public:
 		EHciStaticAddress = (1<<15)
 	};
 
+	// Status codes returned in Command Complete and Command Status events (see kStatusCodes for their names)
+	enum StatusCodes
+	{
+		EStatusSuccess = 0x00,
+		EStatusUnknownCommand = 0x01,
+		EStatusNotConnected = 0x02,
+		EStatusFailed = 0x03,
+		EStatusConnectFailed = 0x04,
+		EStatusAuthenticationFailed = 0x05,
+		EStatusNotPaired = 0x06,
+		EStatusNoResources = 0x07,
+		EStatusTimeout = 0x08,
+		EStatusAlreadyConnected = 0x09,
+		EStatusBusy = 0x0A,
+		EStatusRejected = 0x0B,
+		EStatusNotSupported = 0x0C,
+		EStatusInvalidParameters = 0x0D,
+		EStatusDisconnected = 0x0E,
+		EStatusNotPowered = 0x0F,
+		EStatusCancelled = 0x10,
+		EStatusInvalidIndex = 0x11,
+		EStatusRFKilled = 0x12,
+		EStatusAlreadyPaired = 0x13,
+		EStatusPermissionDenied = 0x14
+	};
+
 	struct HciHeader
 	{
 		uint16_t code;
@@ -120,20 +149,102 @@ public:
 		}
 	} __attribute__((packed));
 
-	struct CommandCompleteEvent
+	// A bounds-checked view of an event packet in the HCI socket's receive buffer
+	//
+	// Nothing is copied until a handler asks for a structure with `get()`, which checks that the packet is long enough, copies just
+	// that structure onto the caller's stack (the packet's fields aren't aligned, so they can't be used in place) and converts it to
+	// host byte order. Variable-length data is left in the buffer and reached through `data()`.
+	class EventView
 	{
-		HciHeader header;
-		uint16_t commandCode;
+	public:
+		EventView(const uint8_t *pPacket, size_t packetLength) : pPacket(pPacket), packetLength(packetLength) {}
+
+		// Returns the length of the packet
+		size_t size() const { return packetLength; }
+
+		// Returns the event code, or EInvalidEvent (0) if the packet is too short to have one
+		uint16_t code() const
+		{
+			if (packetLength < sizeof(uint16_t)) { return 0; }
+			return static_cast<uint16_t>(pPacket[0] | (pPacket[1] << 8));
+		}
+
+		// Copies the structure at `offset` into `value` and converts it to host byte order
+		//
+		// Returns false (leaving `value` untouched) if the packet is too short to hold it
+		template <typename T>
+		bool get(T &value, size_t offset = 0) const
+		{
+			if (offset > packetLength || packetLength - offset < sizeof(T)) { return false; }
+			memcpy(&value, pPacket + offset, sizeof(T));
+			value.toHost();
+			return true;
+		}
+
+		// Returns the data starting at `offset`, or nullptr if the packet ends before then
+		const uint8_t *data(size_t offset) const { return offset <= packetLength ? pPacket + offset : nullptr; }
+
+		// Returns the number of bytes from `offset` to the end of the packet
+		size_t dataLength(size_t offset) const { return offset <= packetLength ? packetLength - offset : 0; }
+
+	private:
+		const uint8_t *pPacket;
+		size_t packetLength;
+	};
+
+	// The outcome of a command sent to the adapter
+	struct CommandResult
+	{
+		// True if the adapter responded; false if the command couldn't be sent, timed out, or the event thread stopped
+		bool responded;
+
+		// The status code from the response (see StatusCodes)
 		uint8_t status;
 
-		CommandCompleteEvent(const std::vector<uint8_t> &data)
+		// The return parameters from a Command Complete event (empty for a Command Status event)
+		std::vector<uint8_t> payload;
+
+		CommandResult() : responded(false), status(EStatusFailed) {}
+		CommandResult(uint8_t status, const uint8_t *pPayload, size_t payloadLength)
+		: responded(true), status(status), payload(pPayload, pPayload + payloadLength) {}
+
+		// Returns true if the adapter responded with a success status
+		bool succeeded() const { return responded && EStatusSuccess == status; }
+
+		// Returns true if the command failed in a way that sending it again won't fix (the adapter doesn't know or support the
+		// command, or rejected its parameters)
+		bool failedPermanently() const
 		{
-			*this = *reinterpret_cast<const CommandCompleteEvent *>(data.data());
-			toHost();
+			return responded && (EStatusUnknownCommand == status || EStatusNotSupported == status || EStatusInvalidParameters == status);
+		}
 
-			// Log it
-			Logger::debug(debugText());
+		// Returns a human-readable description of the outcome
+		std::string statusText() const
+		{
+			if (!responded) { return "No response"; }
+			if (status > kMaxStatusCode) { return "Unknown status (" + Utils::hex(status) + ")"; }
+			return std::string(kStatusCodes[status]) + " (" + Utils::hex(status) + ")";
 		}
+	};
+
+	// A command that has been sent to the adapter, whose response may not have arrived yet (see `submitCommand()`)
+	struct CommandTicket
+	{
+		// Identifies the command among those awaiting a response (0 if the command was never sent)
+		uint32_t sequence;
+
+		// The command code, for logging
+		uint16_t code;
+
+		// Receives the command's result when its response arrives (or when it can't be sent, or the event thread stops)
+		std::future<CommandResult> response;
+	};
+
+	struct CommandCompleteEvent
+	{
+		HciHeader header;
+		uint16_t commandCode;
+		uint8_t status;
 
 		void toNetwork()
 		{
@@ -166,15 +277,6 @@ public:
 		uint16_t commandCode;
 		uint8_t status;
 
-		CommandStatusEvent(const std::vector<uint8_t> &data)
-		{
-			*this = *reinterpret_cast<const CommandStatusEvent *>(data.data());
-			toHost();
-
-			// Log it
-			Logger::debug(debugText());
-		}
-
 		void toNetwork()
 		{
 			header.toNetwork();
@@ -208,15 +310,6 @@ public:
 		uint32_t flags;
 		uint16_t eirDataLength;
 
-		DeviceConnectedEvent(const std::vector<uint8_t> &data)
-		{
-			*this = *reinterpret_cast<const DeviceConnectedEvent *>(data.data());
-			toHost();
-
-			// Log it
-			Logger::debug(debugText());
-		}
-
 		void toNetwork()
 		{
 			header.toNetwork();
@@ -258,35 +351,72 @@ public:
 		uint8_t addressType;
 		uint8_t reason;
 
-		DeviceDisconnectedEvent(const std::vector<uint8_t> &data)
+		void toNetwork()
+		{
+			header.toNetwork();
+		}
+
+		void toHost()
 		{
-			*this = *reinterpret_cast<const DeviceDisconnectedEvent *>(data.data());
-			toHost();
+			header.toHost();
+		}
 
-			// Log it
-			Logger::debug(debugText());
+		std::string debugText()
+		{
+			std::string text = "";
+			text += "> DeviceDisconnected event\n";
+			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
+			text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
+			text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
+			text += "  + Address            : " + Utils::bluetoothAddressString(address) + "\n";
+			text += "  + Address type       : " + Utils::hex(addressType) + "\n";
+			text += "  + Reason             : " + Utils::hex(reason);
+			return text;
 		}
+	} __attribute__((packed));
+
+	struct NewConnectionParameterEvent
+	{
+		HciHeader header;
+		uint8_t address[6];
+		uint8_t addressType;
+		uint8_t storeHint;
+		uint16_t minInterval;
+		uint16_t maxInterval;
+		uint16_t latency;
+		uint16_t supervisionTimeout;
 
 		void toNetwork()
 		{
 			header.toNetwork();
+			minInterval = Utils::endianToHci(minInterval);
+			maxInterval = Utils::endianToHci(maxInterval);
+			latency = Utils::endianToHci(latency);
+			supervisionTimeout = Utils::endianToHci(supervisionTimeout);
 		}
 
 		void toHost()
 		{
 			header.toHost();
+			minInterval = Utils::endianToHost(minInterval);
+			maxInterval = Utils::endianToHost(maxInterval);
+			latency = Utils::endianToHost(latency);
+			supervisionTimeout = Utils::endianToHost(supervisionTimeout);
 		}
 
 		std::string debugText()
 		{
 			std::string text = "";
-			text += "> DeviceDisconnected event\n";
+			text += "> NewConnectionParameter event\n";
 			text += "  + Event code         : " + Utils::hex(header.code) + " (" + HciAdapter::kEventTypeNames[header.code] + ")\n";
 			text += "  + Controller Id      : " + Utils::hex(header.controllerId) + "\n";
 			text += "  + Data size          : " + std::to_string(header.dataSize) + " bytes\n";
 			text += "  + Address            : " + Utils::bluetoothAddressString(address) + "\n";
 			text += "  + Address type       : " + Utils::hex(addressType) + "\n";
-			text += "  + Reason             : " + Utils::hex(reason);
+			text += "  + Min interval       : " + std::to_string(minInterval) + "\n";
+			text += "  + Max interval       : " + std::to_string(maxInterval) + "\n";
+			text += "  + Latency            : " + std::to_string(latency) + "\n";
+			text += "  + Supervision timeout: " + std::to_string(supervisionTimeout);
 			return text;
 		}
 	} __attribute__((packed));
@@ -406,6 +536,10 @@ public:
 		char name[249];
 		char shortName[11];
 
+		void toHost()
+		{
+		}
+
 		std::string debugText()
 		{
 			std::string text = "";
@@ -431,7 +565,12 @@ public:
 	ControllerInformation getControllerInformation() { return controllerInformation; }
 	VersionInformation getVersionInformation() { return versionInformation; }
 	LocalName getLocalName() { return localName; }
-	int getActiveConnectionCount() { return activeConnections; }
+	int getActiveConnectionCount() { return connections.count(); }
+
+	// Returns the table of active connections
+	//
+	// The table is maintained by the event thread and may be read from any thread.
+	ConnectionTable &getConnections() { return connections; }
 
 	//
 	// Disallow copies of our singleton (c++11)
@@ -455,18 +594,31 @@ public:
 	// Returns true if the HCI socket is connected (either via a new connection or an existing one), otherwise false
 	bool start();
 
-	// Waits for the HciAdapter run thread to join
+	// Wakes the HciAdapter run thread and waits for it to join
 	//
 	// This method will block until the thread joins
 	void stop();
 
-	// Sends a command over the HCI socket
+	// Sends a command over the HCI socket and waits for its response
 	//
 	// If the HCI socket is not connected, it will auto-connect prior to sending the command. In the case of a failed auto-connect,
 	// a failure is returned.
 	//
-	// Returns true on success, otherwise false
-	bool sendCommand(HciHeader &request);
+	// Returns the command's result as soon as its response arrives (see `CommandResult::succeeded()`)
+	CommandResult sendCommand(HciHeader &request);
+
+	// Sends a command over the HCI socket without waiting for its response
+	//
+	// Any number of commands may be submitted back-to-back; the adapter processes them in order and each response is matched to
+	// its command as it arrives. Pass the returned ticket to `waitForCommand()` to collect the response. Note that `request` is
+	// converted to network byte order in the process.
+	CommandTicket submitCommand(HciHeader &request);
+
+	// Waits up to `timeoutMS` milliseconds for the response to a command sent with `submitCommand()`
+	//
+	// Returns the command's result. If no response arrived in time, the result's `responded` is false and the command is abandoned:
+	// its response is discarded if it arrives later.
+	CommandResult waitForCommand(CommandTicket &ticket, int timeoutMS = kMaxEventWaitTimeMS);
 
 	// Event processor, responsible for receiving events from the HCI socket
 	//
@@ -474,18 +626,43 @@ public:
 	void runEventThread();
 
 private:
+	// A command awaiting its response
+	//
+	// A command whose waiter timed out stays in the list as `abandoned` so that its late response is consumed rather than
+	// delivered to a later command with the same code
+	struct PendingCommand
+	{
+		uint32_t sequence;
+		uint16_t code;
+		uint16_t controllerId;
+		bool abandoned;
+		std::promise<CommandResult> response;
+	};
+
+	// Handles one type of event
+	typedef void (HciAdapter::*EventHandler)(const EventView &event);
+
+	// Our event handlers, indexed by event code (nullptr for events we ignore)
+	static const EventHandler kEventHandlers[kMaxEventType + 1];
+
 	// Private constructor for our Singleton
-	HciAdapter() : commandResponseLock(commandResponseMutex), activeConnections(0) {}
+	HciAdapter() : nextSequence(1) {}
 
-	// Uses a std::condition_variable to wait for a response event for the given `commandCode` or `timeoutMS` milliseconds.
-	//
-	// Returns true if the response event was received for `commandCode` or false if the timeout expired.
+	// Event handlers (see kEventHandlers)
+	void onCommandComplete(const EventView &event);
+	void onCommandStatus(const EventView &event);
+	void onDeviceConnected(const EventView &event);
+	void onDeviceDisconnected(const EventView &event);
+	void onNewConnectionParameter(const EventView &event);
+
+	// Resolves the oldest command awaiting a response with the given command code and controller
 	//
-	// Command responses are set via `setCommandResponse()`
-	bool waitForCommandResponse(uint16_t commandCode, int timeoutMS);
+	// Called from the event thread when a Command Complete or Command Status event arrives, with the status and any return
+	// parameters from the event. If that command was abandoned, the response is discarded.
+	void setCommandResponse(uint16_t commandCode, uint16_t controllerId, uint8_t status, const uint8_t *pPayload, size_t payloadLength);
 
-	// Sets the command response and notifies the waiting std::condition_variable (see `waitForCommandResponse`)
-	void setCommandResponse(uint16_t commandCode);
+	// Fails every command awaiting a response (used when the event thread stops, since no more responses will arrive)
+	void failPendingCommands();
 
 	// Our HCI Socket, which allows us to talk directly to the kernel
 	HciSocket hciSocket;
@@ -499,13 +676,13 @@ private:
 	VersionInformation versionInformation;
 	LocalName localName;
 
-	std::condition_variable cvCommandResponse;
-	std::mutex commandResponseMutex;
-	std::unique_lock<std::mutex> commandResponseLock;
-	int conditionalValue;
+	// Commands awaiting a response, oldest first
+	std::list<PendingCommand> pendingCommands;
+	std::mutex pendingCommandsMutex;
+	uint32_t nextSequence;
 
-	// Our active connection count
-	int activeConnections;
+	// Our active connections
+	ConnectionTable connections;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -28,12 +28,18 @@
 // The information for this implementation (as well as HciAdapter.h) came from:
 //
 //     https://git.kernel.org/pub/scm/bluetooth/bluez.git/tree/doc/mgmt-api.txt
+//
+// Reads block in epoll_wait() on both the socket and an eventfd, with no timeout. The event thread therefore sleeps until the
+// adapter sends something, and `signalShutdown()` wakes it at once by writing to the eventfd. Packets are received into a single
+// buffer allocated once, and handed to the caller in place.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <bluetooth/bluetooth.h>
 #include <bluetooth/hci.h>
 #include <thread>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "HciSocket.h"
 #include "Logger.h"
@@ -43,8 +49,13 @@ namespace ggk {
 
 // Initializes an unconnected socket
 HciSocket::HciSocket()
-: fdSocket(-1)
+: fdSocket(-1), fdEpoll(-1), fdShutdown(-1), receiveBuffer(kResponseMaxSize)
 {
+	fdShutdown = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fdShutdown < 0)
+	{
+		logErrno("eventfd");
+	}
 }
 
 // Socket destructor
@@ -53,6 +64,12 @@ HciSocket::HciSocket()
 HciSocket::~HciSocket()
 {
 	disconnect();
+
+	if (fdShutdown >= 0)
+	{
+		close(fdShutdown);
+		fdShutdown = -1;
+	}
 }
 
 // Connects to an HCI socket using the Bluetooth Management API protocol
@@ -82,7 +99,41 @@ bool HciSocket::connect()
 		return false;
 	}
 
-	Logger::debug(SSTR << "Connected to HCI control socket (fd = " << fdSocket << ")");
+	// Clear any shutdown signalled during a previous connection
+	uint64_t count;
+	if (fdShutdown >= 0 && ::read(fdShutdown, &count, sizeof(count)) < 0 && errno != EAGAIN)
+	{
+		logErrno("Connect(eventfd read)");
+	}
+
+	fdEpoll = epoll_create1(EPOLL_CLOEXEC);
+	if (fdEpoll < 0)
+	{
+		logErrno("Connect(epoll_create1)");
+		disconnect();
+		return false;
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = fdSocket;
+	if (epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdSocket, &event) < 0)
+	{
+		logErrno("Connect(epoll_ctl socket)");
+		disconnect();
+		return false;
+	}
+
+	event.data.fd = fdShutdown;
+	if (fdShutdown >= 0 && epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdShutdown, &event) < 0)
+	{
+		logErrno("Connect(epoll_ctl eventfd)");
+		disconnect();
+		return false;
+	}
+
+	GGK_LOG_DEBUG(SSTR << "Connected to HCI control socket (fd = " << fdSocket << ")");
 
 	return true;
 }
@@ -98,70 +149,82 @@ void HciSocket::disconnect()
 {
 	if (isConnected())
 	{
-		Logger::debug("HciSocket disconnecting");
+		GGK_LOG_DEBUG("HciSocket disconnecting");
+
+		if (fdEpoll >= 0 && close(fdEpoll) != 0)
+		{
+			logErrno("close(fdEpoll)");
+		}
 
 		if (close(fdSocket) != 0)
 		{
 			logErrno("close(fdSocket)");
 		}
 
+		fdEpoll = -1;
 		fdSocket = -1;
-		Logger::trace("HciSocket closed");
+		GGK_LOG_TRACE("HciSocket closed");
 	}
 }
 
-// Reads data from the HCI socket
+// Reads the next packet from the HCI socket, blocking until one arrives or `signalShutdown()` is called
 //
-// Raw data is read and returned in `response`.
+// On success, `pData` and `length` describe the packet. The packet lives in a buffer owned by the socket and remains valid until
+// the next call to `read()`.
 //
-// Returns true if data was read successfully, otherwise false is returned. A false return code does not necessarily depict
-// an error, as this can arise from expected conditions (such as an interrupt.)
-bool HciSocket::read(std::vector<uint8_t> &response) const
+// Returns true if a packet was read, otherwise false (on an error, or when shutting down.) A false return code does not
+// necessarily depict an error, as this can arise from expected conditions (such as an interrupt.)
+bool HciSocket::read(const uint8_t *&pData, size_t &length)
 {
-	// Fill our response with empty data
-	response.resize(kResponseMaxSize, 0);
-
 	// Wait for data or a cancellation
 	if (!waitForDataOrShutdown())
 	{
 		return false;
 	}
 
-	// Block until we receive data, a disconnect, or a signal
-	ssize_t bytesRead = ::recv(fdSocket, &response[0], kResponseMaxSize, MSG_WAITALL);
+	ssize_t bytesRead = ::recv(fdSocket, receiveBuffer.data(), receiveBuffer.size(), 0);
 
-	// If there was an error, wipe the data and return an error condition
+	// If there was an error, return an error condition
 	if (bytesRead < 0)
 	{
-		if (errno == EINTR)
+		if (errno == EINTR || errno == EAGAIN)
 		{
-			Logger::debug("HciSocket receive interrupted");
+			GGK_LOG_DEBUG("HciSocket receive interrupted");
 		}
 		else
 		{
 			logErrno("recv");
 		}
-		response.resize(0);
 		return false;
 	}
 	else if (bytesRead == 0)
 	{
-		Logger::error("Peer closed the socket");
-		response.resize(0);
+		GGK_LOG_ERROR("Peer closed the socket");
 		return false;
 	}
 
 	// We have data
-	response.resize(bytesRead);
+	pData = receiveBuffer.data();
+	length = static_cast<size_t>(bytesRead);
 
-	std::string dump = "";
-	dump += "  > Read " + std::to_string(response.size()) + " bytes\n";
-	dump += Utils::hex(response.data(), response.size());
-	Logger::debug(dump);
+	// The hex dump is only built if someone is listening for it
+	GGK_LOG_DEBUG(SSTR << "  > Read " << length << " bytes\n" << Utils::hex(pData, length));
 
 	return true;
 }
 
+// Wakes a blocked `read()` so that it returns false
+//
+// This may be called from any thread. Reads keep failing until the socket is next connected.
+void HciSocket::signalShutdown()
+{
+	uint64_t one = 1;
+	if (fdShutdown >= 0 && ::write(fdShutdown, &one, sizeof(one)) < 0)
+	{
+		logErrno("signalShutdown");
+	}
+}
+
 // Writes the array of bytes of a given count
 //
 // This method returns true if the bytes were written successfully, otherwise false
@@ -175,10 +238,7 @@ bool HciSocket::write(std::vector<uint8_t> buffer) const
 // This method returns true if the bytes were written successfully, otherwise false
 bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
 {
-	std::string dump = "";
-	dump += "  > Writing " + std::to_string(count) + " bytes\n";
-	dump += Utils::hex(pBuffer, count);
-	Logger::debug(dump);
+	GGK_LOG_DEBUG(SSTR << "  > Writing " << count << " bytes\n" << Utils::hex(pBuffer, count));
 
 	size_t len = ::write(fdSocket, pBuffer, count);
 
@@ -193,32 +253,32 @@ bool HciSocket::write(const uint8_t *pBuffer, size_t count) const
 
 // Wait for data to arrive, or for a shutdown event
 //
-// Returns true if data is available, false if we are shutting down
+// This blocks without a timeout. Returns true if data is available, false if we are shutting down (or on an error)
 bool HciSocket::waitForDataOrShutdown() const
 {
-	while(ggkIsServerRunning())
+	while(true)
 	{
-		fd_set rfds;
-		FD_ZERO(&rfds);
-		FD_SET(fdSocket, &rfds);
-
-		struct timeval tv;
-		tv.tv_sec = 0;
-		tv.tv_usec = kDataWaitTimeMS * 1000;
-
-		int retval = select(fdSocket+1, &rfds, NULL, NULL, &tv);
+		struct epoll_event events[2];
+		int count = epoll_wait(fdEpoll, events, 2, -1);
+		if (count < 0)
+		{
+			// A signal interrupted the wait; go back to waiting
+			if (errno == EINTR) { continue; }
 
-		// Do we have data?
-		if (retval > 0) { return true; }
+			logErrno("epoll_wait");
+			return false;
+		}
 
-		// We have an error
-		if (retval < 0) { return false; }
+		// A shutdown takes priority over any data that arrived with it
+		bool hasData = false;
+		for (int i = 0; i < count; ++i)
+		{
+			if (events[i].data.fd == fdShutdown) { return false; }
+			if (events[i].data.fd == fdSocket) { hasData = true; }
+		}
 
-		// No data; keep waiting
-		continue;
+		if (hasData) { return true; }
 	}
-
-	return false;
 }
 
 // Utilitarian function for logging errors for the given operation
@@ -230,7 +290,7 @@ void HciSocket::logErrno(const char *pOperation) const
 		errorDetail += " or not enough permission for this operation";
 	}
 
-	Logger::error(SSTR << "Error on Bluetooth management socket during " << pOperation << " operation. Error code " << errno << ": " << errorDetail);
+	GGK_LOG_ERROR(SSTR << "Error on Bluetooth management socket during " << pOperation << " operation. Error code " << errno << ": " << errorDetail);
 }
 
 }; // namespace ggk
@@ -50,13 +50,18 @@ public:
 	// Disconnects from the HCI socket
 	void disconnect();
 
-	// Reads data from the HCI socket
+	// Reads the next packet from the HCI socket, blocking until one arrives or `signalShutdown()` is called
 	//
-	// Raw data is read until no more data is available. If no data is available when this method initially starts to read, it will
-	// retry for a maximum timeout defined by `kMaxRetryTimeMS`.
+	// On success, `pData` and `length` describe the packet. The packet lives in a buffer owned by the socket and remains valid until
+	// the next call to `read()`.
 	//
-	// Returns true if any data was read successfully, otherwise false is returned in the case of an error or a timeout.
-	bool read(std::vector<uint8_t> &response) const;
+	// Returns true if a packet was read, otherwise false (on an error, or when shutting down.)
+	bool read(const uint8_t *&pData, size_t &length);
+
+	// Wakes a blocked `read()` so that it returns false
+	//
+	// This may be called from any thread. Reads keep failing until the socket is next connected.
+	void signalShutdown();
 
 	// Writes the array of bytes of a given count
 	//
@@ -70,9 +75,12 @@ public:
 
 private:
 
+	// The largest packet we can receive
+	static const size_t kResponseMaxSize = 64 * 1024;
+
 	// Wait for data to arrive, or for a shutdown event
 	//
-	// Returns true if data is available, false if we are shutting down
+	// This blocks without a timeout. Returns true if data is available, false if we are shutting down (or on an error)
 	bool waitForDataOrShutdown() const;
 
 	// Utilitarian function for logging errors for the given operation
@@ -80,8 +88,16 @@ private:
 
 	int	fdSocket;
 
-	const size_t kResponseMaxSize = 64 * 1024;
-	const int kDataWaitTimeMS = 10;
+	// Our epoll instance, watching `fdSocket` and `fdShutdown`
+	int fdEpoll;
+
+	// An eventfd that becomes readable when `signalShutdown()` is called
+	//
+	// This lives as long as the socket object (rather than the connection) so that it can be signalled at any time.
+	int fdShutdown;
+
+	// Packets are received into this buffer, allocated once
+	std::vector<uint8_t> receiveBuffer;
 };
 
 }; // namespace ggk
\ No newline at end of file
@@ -0,0 +1,151 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Flow control for indications on the msg_service channel: tracks indications awaiting confirmation
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Each indication must be confirmed by the central before the next one can go over the air. BlueZ queues indications until then,
+// so if we hand it messages faster than the central confirms them, they pile up inside bluetoothd where we can neither see nor
+// cancel them. Handing over one indication at a time avoids that but leaves the link idle while each confirmation travels back.
+//
+// Instead we keep a small window of indications in flight. BlueZ calls our characteristic's Confirm method as each confirmation
+// arrives; that frees a place in the window and the sender tops it up. This holds whether the indications go out as
+// PropertiesChanged signals or through an acquired notification socket. With a socket there's a second brake: if BlueZ
+// hasn't drained it, the write fails with EAGAIN and the sender waits for the socket to become writable
+// (see `GattCharacteristic::isNotifyBlocked()`.)
+//
+// Confirm doesn't say which device sent the confirmation, so the window covers the channel rather than each connection. With more
+// than one subscriber, each indication is confirmed once per subscriber, and we can't tell a second subscriber's confirmation of
+// one indication from the first subscriber's confirmation of the next. Each confirmation frees a place in the window, so a
+// window of N would let N indications per subscriber pile up in BlueZ. To keep that bounded, the window shrinks to a single
+// indication while more than one device is connected. A late confirmation can still free the place of the indication that
+// followed, so BlueZ may hold one indication per subscriber, but no more.
+//
+// Since we know when each message was queued, the confirmation of a message's last indication gives its full latency (queueing
+// plus delivery), which is reported to the application.
+//
+// If a confirmation never arrives (the central disconnected, or BlueZ is too old to call Confirm), `expire()` gives up on it
+// so that the window can't stall for good.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include "IndicationWindow.h"
+#include "UpdateQueue.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Our constructor sets the default window
+IndicationWindow::IndicationWindow()
+: inFlightHead(0), inFlightCount(0), confirming(true), confirmSeen(false), window(kDefaultWindow), confirmedCallback(nullptr)
+{
+}
+
+// Sets the number of indications that may await confirmation at once (clamped to [1, kMaxWindow])
+void IndicationWindow::setWindow(int size)
+{
+	if (size < 1) { size = 1; }
+	if (size > kMaxWindow) { size = kMaxWindow; }
+	window.store(size, std::memory_order_relaxed);
+}
+
+// Returns true if another indication may be sent now, given the number of active connections
+//
+// This is always true if the central isn't confirming indications (see `expire()`.) With more than one connection, only one
+// indication may await confirmation at a time.
+bool IndicationWindow::canSend(int connectionCount) const
+{
+	int limit = connectionCount > 1 ? 1 : getWindow();
+	return !confirming || getInFlight() < limit;
+}
+
+// Records an indication that was handed to BlueZ
+void IndicationWindow::sent(int messageId, int64_t queueTimeUS, bool lastFragment)
+{
+	int count = getInFlight();
+	if (!confirming || count >= kMaxWindow)
+	{
+		return;
+	}
+
+	InFlight &entry = inFlight[(inFlightHead + count) % kMaxWindow];
+	entry.messageId = messageId;
+	entry.queueTimeUS = queueTimeUS;
+	entry.sentTimeUS = UpdateQueue::nowUS();
+	entry.lastFragment = lastFragment;
+	inFlightCount.store(count + 1, std::memory_order_relaxed);
+}
+
+// Records a confirmation from BlueZ, freeing the oldest indication's place in the window
+//
+// If that indication ended a message, the message's latency is reported to the confirmed callback.
+void IndicationWindow::confirmed()
+{
+	confirmSeen = true;
+	if (!confirming)
+	{
+		GGK_LOG_INFO("Indication confirmations resumed; flow control re-enabled");
+		confirming = true;
+	}
+
+	int count = getInFlight();
+	if (0 == count)
+	{
+		return;
+	}
+
+	const InFlight &entry = inFlight[inFlightHead];
+	inFlightHead = (inFlightHead + 1) % kMaxWindow;
+	inFlightCount.store(count - 1, std::memory_order_relaxed);
+
+	GGKMessageConfirmed callback = confirmedCallback.load(std::memory_order_acquire);
+	if (entry.lastFragment && nullptr != callback)
+	{
+		callback(entry.messageId, static_cast<unsigned int>(UpdateQueue::nowUS() - entry.queueTimeUS));
+	}
+}
+
+// Gives up on indications that have waited longer than kConfirmTimeoutMS for confirmation
+//
+// If no confirmation has ever arrived, we assume confirmations aren't supported (BlueZ only calls Confirm from version 5.42) and
+// stop waiting for them until one turns up.
+void IndicationWindow::expire(int64_t nowUS)
+{
+	int count = getInFlight();
+	int expired = 0;
+	while (expired < count && nowUS - inFlight[inFlightHead].sentTimeUS >= static_cast<int64_t>(kConfirmTimeoutMS) * 1000)
+	{
+		inFlightHead = (inFlightHead + 1) % kMaxWindow;
+		++expired;
+	}
+
+	if (0 == expired)
+	{
+		return;
+	}
+
+	inFlightCount.store(count - expired, std::memory_order_relaxed);
+	GGK_LOG_DEBUG(SSTR << "Gave up waiting for confirmation of " << expired << " indication(s)");
+
+	if (!confirmSeen && confirming)
+	{
+		GGK_LOG_WARN("Indications are not being confirmed; flow control disabled until a confirmation arrives");
+		confirming = false;
+		inFlightHead = 0;
+		inFlightCount.store(0, std::memory_order_relaxed);
+	}
+}
+
+}; // namespace ggk
@@ -0,0 +1,135 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// Flow control for indications on the msg_service channel: tracks indications awaiting confirmation
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of IndicationWindow.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "../include/Gobbledegook.h"
+
+namespace ggk {
+
+struct IndicationWindow
+{
+	//
+	// Constants
+	//
+
+	// The largest number of indications that may await confirmation at once
+	static const int kMaxWindow = 32;
+
+	// The default number of indications that may await confirmation at once
+	static const int kDefaultWindow = 4;
+
+	// How long we wait for a confirmation before giving up on it
+	static const int kConfirmTimeoutMS = 1000;
+
+	//
+	// Types
+	//
+
+	// An indication awaiting confirmation
+	struct InFlight
+	{
+		// The message the indication belongs to, and when that message was queued
+		int messageId;
+		int64_t queueTimeUS;
+
+		// Monotonic time (in microseconds) at which the indication was handed to BlueZ
+		int64_t sentTimeUS;
+
+		// True if this indication carries the end of its message
+		bool lastFragment;
+	};
+
+	//
+	// Accessors
+	//
+
+	// Returns the instance to this singleton class
+	static IndicationWindow &getInstance()
+	{
+		static IndicationWindow instance;
+		return instance;
+	}
+
+	// Returns the number of indications that may await confirmation at once
+	int getWindow() const { return window.load(std::memory_order_relaxed); }
+
+	// Sets the number of indications that may await confirmation at once (clamped to [1, kMaxWindow])
+	void setWindow(int size);
+
+	// Returns the number of indications currently awaiting confirmation
+	int getInFlight() const { return inFlightCount.load(std::memory_order_relaxed); }
+
+	// Registers the callback that receives each message's latency once it is confirmed (nullptr to unregister)
+	void setConfirmedCallback(GGKMessageConfirmed callback) { confirmedCallback.store(callback, std::memory_order_release); }
+
+	//
+	// Sender (server thread only)
+	//
+
+	// Returns true if another indication may be sent now, given the number of active connections
+	//
+	// This is always true if the central isn't confirming indications (see `expire()`.) With more than one connection, only one
+	// indication may await confirmation at a time.
+	bool canSend(int connectionCount) const;
+
+	// Records an indication that was handed to BlueZ
+	void sent(int messageId, int64_t queueTimeUS, bool lastFragment);
+
+	// Records a confirmation from BlueZ, freeing the oldest indication's place in the window
+	//
+	// If that indication ended a message, the message's latency is reported to the confirmed callback.
+	void confirmed();
+
+	// Gives up on indications that have waited longer than kConfirmTimeoutMS for confirmation
+	//
+	// If no confirmation has ever arrived, we assume confirmations aren't supported (BlueZ only calls Confirm from version 5.42)
+	// and stop waiting for them until one turns up.
+	void expire(int64_t nowUS);
+
+private:
+
+	// Our constructor sets the default window
+	IndicationWindow();
+
+	// Our ring of indications awaiting confirmation, oldest first
+	InFlight inFlight[kMaxWindow];
+	int inFlightHead;
+
+	// The number of entries in `inFlight` (written by the server thread, read by the application)
+	std::atomic<int> inFlightCount;
+
+	// True until we time out without ever receiving a confirmation
+	bool confirming;
+
+	// True once at least one confirmation has been received
+	bool confirmSeen;
+
+	// Configuration
+	std::atomic<int> window;
+	std::atomic<GGKMessageConfirmed> confirmedCallback;
+};
+
+}; // namespace ggk
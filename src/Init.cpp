@@ -33,8 +33,11 @@
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <gio/gio.h>
+#include <glib-unix.h>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <unordered_map>
 #include <atomic>
 #include <chrono>
 #include <thread>
@@ -42,12 +45,16 @@
 #include "Server.h"
 #include "Globals.h"
 #include "Mgmt.h"
+#include "AdvertisingManager.h"
 #include "HciAdapter.h"
 #include "DBusObject.h"
 #include "DBusInterface.h"
 #include "GattCharacteristic.h"
 #include "GattProperty.h"
 #include "Logger.h"
+#include "UpdateQueue.h"
+#include "MessageQueue.h"
+#include "TimerWheel.h"
 #include "Init.h"
 
 namespace ggk {
@@ -56,15 +63,52 @@ namespace ggk {
 // Constants
 //
 
-static const int kPeriodicTimerFrequencySeconds = 1;
-static const int kRetryDelaySeconds = 2;
+static const int kRetryInitialDelayMS = 50;
+static const int kRetryMaxDelayMS = 2000;
 static const int kIdleFrequencyMS = 10;
 
 //
 // Retries
 //
 
-static time_t retryTimeStart = 0;
+// The pending retry timer (0 if none) and the delay before the next retry, which doubles with each consecutive retry and returns
+// to kRetryInitialDelayMS whenever initialization makes progress
+static guint retrySourceId = 0;
+static int retryDelayMS = kRetryInitialDelayMS;
+
+//
+// Startup timing
+//
+
+// The phases of initialization, in the order the state processor steps through them
+enum InitPhase
+{
+	EPhaseBusConnection,
+	EPhaseOwnedName,
+	EPhaseObjectManager,
+	EPhaseAdapterInterface,
+	EPhaseAdapterConfiguration,
+	EPhaseObjectRegistration,
+	EPhaseApplicationRegistration,
+	EPhaseCount
+};
+
+static const char * const kInitPhaseNames[EPhaseCount] =
+{
+	"bus connection",
+	"owned name",
+	"object manager",
+	"adapter interface",
+	"adapter configuration",
+	"object registration",
+	"application registration"
+};
+
+// The phase in progress (EPhaseCount if none), when it and initialization as a whole began, and the time spent in each phase
+static int currentPhase = EPhaseCount;
+static int64_t phaseStartUS = 0;
+static int64_t initStartUS = 0;
+static int64_t phaseDurationUS[EPhaseCount];
 
 //
 // Adapter configuration
@@ -73,7 +117,12 @@ static time_t retryTimeStart = 0;
 GDBusConnection *pBusConnection = nullptr;
 static guint ownedNameId = 0;
 static guint periodicTimeoutId = 0;
+static TimerWheel tickEventWheel;
+static guint updateQueueSourceId = 0;
 static std::vector<guint> registeredObjectIds;
+static std::vector<guint> registeredSubtreeIds;
+static std::atomic<bool> subtreeRegistration(false);
+static std::unordered_map<const DBusObject *, std::vector<GDBusInterfaceInfo *> > subtreeInterfaceInfo;
 static std::atomic<GMainLoop *> pMainLoop(nullptr);
 static GDBusObjectManager *pBluezObjectManager = nullptr;
 static GDBusObject *pBluezAdapterObject = nullptr;
@@ -83,6 +132,7 @@ static GDBusProxy *pBluezAdapterInterfaceProxy = nullptr;
 static GDBusProxy *pBluezDeviceInterfaceProxy = nullptr;
 static GDBusProxy *pBluezAdapterPropertiesInterfaceProxy = nullptr;
 static bool bOwnedNameAcquired = false;
+static bool bOwnedNameEverAcquired = false;
 static bool bAdapterConfigured = false;
 static bool bApplicationRegistered = false;
 static std::string bluezGattManagerInterfaceName = "";
@@ -94,12 +144,15 @@ static bool configured = false;
 
 extern void setServerRunState(enum GGKServerRunState newState);
 extern void setServerHealth(enum GGKServerHealth newHealth);
+extern void cancelIndicationTimeout();
 
 //
 // Forward declarations
 //
 
 static void initializationStateProcessor();
+gboolean onPeriodicTimer(gpointer pUserData);
+static void unregisterSubtrees();
 
 // ---------------------------------------------------------------------------------------------------------------------------------
 //  ___    _ _           __      _       _                                             _
@@ -113,12 +166,20 @@ static void initializationStateProcessor();
 // `TheServer` object, then call `ggkPushUpdateQueue` to trigger that data to be updated (in whatever way the service responsible
 // for that data() sees fit.
 //
-// This is done using the `ggkPushUpdateQueue` / `ggkPopUpdateQueue` methods to manage the queue of pending update messages. Each
-// entry represents an interface that needs to be updated. The idleFunc calls the interface's `onUpdatedValue` method for each
-// update.
+// This is done using the `ggkPushUpdateQueue` method to add to the queue of pending updates (see UpdateQueue.cpp). Each entry is
+// the interface that needs to be updated. The idleFunc calls the interface's `onUpdatedValue` method for each update.
+//
+// The idle processor isn't really run at idle any more. The update queue signals an eventfd whenever updates are pushed and the
+// main loop watches that descriptor, so updates are processed as soon as they arrive and the main loop sleeps when there are
+// none.
 //
-// The idle processor will perform one update per idle tick, however, it will notify that there is more data so the idle ticks
-// do not lag behind.
+// Updates are drained in batches of up to `ggkUpdateQueueGetBatchSize()` per wakeup. Within a batch, each interface is processed
+// once (in order of first appearance), since processing reads its latest value. If more updates remain after a batch, the queue
+// is re-signalled so that a flood of updates can't starve D-Bus dispatch.
+//
+// When update coalescing is enabled, an interface may also declare a minimum update interval. An update that arrives too soon
+// after the previous one is deferred with a one-shot timer rather than processed; it remains pending, so further updates are
+// collapsed into it until the timer fires.
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 // Our idle function
@@ -126,55 +187,150 @@ static void initializationStateProcessor();
 // This method is used to process data on the same thread as our main loop. This allows us to communicate with our service from
 // the outside.
 //
-// IMPORTANT: This method must return 'true' if any work was performed, otherwise it must return 'false'. Returning 'true' will
-// cause the idle loop to continue to call this method to process data at the maximum rate (which can peg the CPU at 100%.) By
-// returning false when there is no work to do, we are nicer to the system.
-bool idleFunc(void *pUserData)
+// Processes a single update for the given interface.
+void idleFunc(const DBusInterface *pInterface, void *pUserData)
+{
+	// Call the onUpdatedValue method on the interface
+	//
+	// Queue entries are resolved when they are pushed, so there's no need to search the server for the interface here
+	if (pInterface->getInterfaceType() == GattCharacteristic::kInterfaceType)
+	{
+		const GattCharacteristic *pCharacteristic = static_cast<const GattCharacteristic *>(pInterface);
+		GGK_LOG_DEBUG(SSTR << "Processing updated value for interface '" << pInterface->getName() << "' at path '" << pInterface->getPath() << "'");
+		pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
+	}
+}
+
+// Called when a deferred update's minimum interval has expired
+//
+// The update is released even if the server is no longer running, so that later updates to the interface aren't collapsed into
+// one that will never be delivered.
+gboolean onDeferredUpdate(gpointer pUserData)
 {
+	const DBusInterface *pInterface = static_cast<const DBusInterface *>(pUserData);
+	DBusInterface::UpdateState &state = pInterface->getUpdateState();
+	state.deferredSourceId = 0;
 
-	// Don't do anything unless we're running
-	if (ggkGetServerRunState() != ERunning)
+	UpdateQueue::getInstance().release(pInterface);
+
+	if (ggkGetServerRunState() == ERunning)
 	{
-		return false;
+		state.lastProcessedUS = UpdateQueue::nowUS();
+		idleFunc(pInterface, nullptr);
 	}
 
-	// Try to get an update
-	const int kQueueEntryLen = 1024;
-	char queueEntry[kQueueEntryLen];
-	if (ggkPopUpdateQueue(queueEntry, kQueueEntryLen, 0) != 1)
+	return G_SOURCE_REMOVE;
+}
+
+// Processes an update taken from the queue, honoring the interface's minimum update interval when coalescing
+void processUpdate(const DBusInterface *pInterface, void *pUserData)
+{
+	UpdateQueue &queue = UpdateQueue::getInstance();
+	DBusInterface::UpdateState &state = pInterface->getUpdateState();
+
+	// An update is already scheduled for this interface; it will carry the latest value
+	if (0 != state.deferredSourceId)
 	{
-		return false;
+		return;
 	}
 
-	std::string entryString = queueEntry;
-	auto token = entryString.find('|');
-	if (token == std::string::npos)
+	int64_t nowUS = UpdateQueue::nowUS();
+	int minIntervalMS = state.minIntervalMS;
+	if (queue.getCoalescing() && minIntervalMS > 0 && 0 != state.lastProcessedUS)
 	{
-		Logger::error("Queue entry was not formatted properly - could not find separating token");
-		return false;
+		int64_t dueUS = state.lastProcessedUS + static_cast<int64_t>(minIntervalMS) * 1000;
+		if (nowUS < dueUS)
+		{
+			// Too soon - leave the update pending and deliver it when the interval expires
+			guint delayMS = static_cast<guint>((dueUS - nowUS + 999) / 1000);
+			state.deferredSourceId = g_timeout_add(delayMS, onDeferredUpdate, const_cast<DBusInterface *>(pInterface));
+			return;
+		}
 	}
 
-	DBusObjectPath objectPath = DBusObjectPath(entryString.substr(0, token));
-	std::string interfaceName = entryString.substr(token+1);
+	queue.release(pInterface);
+	state.lastProcessedUS = nowUS;
+	idleFunc(pInterface, pUserData);
+}
 
-	// We have an update - call the onUpdatedValue method on the interface
-	std::shared_ptr<const DBusInterface> pInterface = TheServer->findInterface(objectPath, interfaceName);
-	if (nullptr == pInterface)
+// Removes the deferred update timers of an object and its descendants, releasing their updates
+static void cancelDeferredUpdates(const DBusObject &object)
+{
+	for (const std::shared_ptr<DBusInterface> &interface : object.getInterfaces())
 	{
-		Logger::warn(SSTR << "Unable to find interface for update: path[" << objectPath << "], name[" << interfaceName << "]");
+		DBusInterface::UpdateState &state = interface->getUpdateState();
+		if (0 != state.deferredSourceId)
+		{
+			g_source_remove(state.deferredSourceId);
+			state.deferredSourceId = 0;
+			UpdateQueue::getInstance().release(interface.get());
+		}
 	}
-	else
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		cancelDeferredUpdates(child);
+	}
+}
+
+// Called from the main loop when the update queue's eventfd becomes readable
+//
+// Processes a single batch of pending updates and re-signals the queue if any are left over.
+gboolean onUpdateQueueReady(gint /*fd*/, GIOCondition /*condition*/, gpointer pUserData)
+{
+	static UpdateQueue::Entry batch[UpdateQueue::kMaxBatchSize];
+
+	UpdateQueue &queue = UpdateQueue::getInstance();
+
+	// Acknowledge first, so any push from here on wakes us again
+	queue.acknowledgeWake();
+
+	// Don't do anything unless we're running (we'll be woken when we are)
+	if (ggkGetServerRunState() != ERunning)
+	{
+		return G_SOURCE_CONTINUE;
+	}
+
+	int count = queue.popBatch(batch, queue.getBatchSize());
+	if (count == 0)
+	{
+		return G_SOURCE_CONTINUE;
+	}
+
+	// With multiple producers, push times are only roughly ordered, so find the oldest
+	int64_t oldestPushUS = batch[0].pushTimeUS;
+	for (int i = 1; i < count; ++i)
 	{
-		// Is it a characteristic?
-		if (std::shared_ptr<const GattCharacteristic> pCharacteristic = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
+		if (batch[i].pushTimeUS < oldestPushUS) { oldestPushUS = batch[i].pushTimeUS; }
+	}
+
+	// Process each interface in the batch once, in the order of its first update. An update reads the interface's latest value
+	// when it is processed, so later updates to the same interface in this batch have nothing more to deliver.
+	for (int i = 0; i < count; ++i)
+	{
+		const DBusInterface *pInterface = batch[i].pInterface;
+		if (nullptr == pInterface) { continue; }
+
+		for (int j = i + 1; j < count; ++j)
 		{
-			Logger::debug(SSTR << "Processing updated value for interface '" << interfaceName << "' at path '" << objectPath << "'");
-			pCharacteristic->callOnUpdatedValue(pBusConnection, pUserData);
-			return true;
+			if (batch[j].pInterface == pInterface)
+			{
+				batch[j].pInterface = nullptr;
+			}
 		}
+
+		processUpdate(pInterface, pUserData);
 	}
 
-	return false;
+	queue.recordBatchLatency(UpdateQueue::nowUS() - oldestPushUS);
+
+	// If there's more to do, come back after the main loop has had a chance to dispatch other events
+	if (!queue.empty())
+	{
+		queue.wake();
+	}
+
+	return G_SOURCE_CONTINUE;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -244,12 +400,41 @@ void uninit()
 		registeredObjectIds.clear();
 	}
 
+	unregisterSubtrees();
+
 	if (0 != periodicTimeoutId)
 	{
 		g_source_remove(periodicTimeoutId);
 		periodicTimeoutId = 0;
 	}
 
+	tickEventWheel.reset(0);
+
+	cancelIndicationTimeout();
+
+	if (0 != retrySourceId)
+	{
+		g_source_remove(retrySourceId);
+		retrySourceId = 0;
+	}
+
+	if (0 != updateQueueSourceId)
+	{
+		g_source_remove(updateQueueSourceId);
+		updateQueueSourceId = 0;
+	}
+
+	if (nullptr != TheServer)
+	{
+		for (const DBusObject &object : TheServer->getObjects())
+		{
+			cancelDeferredUpdates(object);
+		}
+	}
+
+	// Nobody is left to send outbound messages, so let the application know they won't be sent
+	MessageQueue::getInstance().clear(EMessageCancelled);
+
   	if (ownedNameId > 0)
   	{
 		g_bus_unown_name(ownedNameId);
@@ -285,7 +470,7 @@ void shutdown()
 {
 	if (ggkGetServerRunState() > ERunning)
 	{
-		Logger::warn("Ignoring call to shutdown (we are already shutting down)");
+		GGK_LOG_WARN("Ignoring call to shutdown (we are already shutting down)");
 		return;
 	}
 
@@ -311,49 +496,94 @@ void shutdown()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// Fires a tick event that has come due (see TimerWheel.cpp)
+//
+// Events only fire once our application is registered. As they always have, callbacks receive the bus connection as their user
+// data.
+static void onTickEventDue(const TickEvent &event, void * /*pContext*/)
+{
+	if (bApplicationRegistered)
+	{
+		event.getOwner()->fireEvent(event, pBusConnection, pBusConnection);
+	}
+}
+
+// Arms the periodic timer for the next time the tick event wheel needs to advance (if it has any events)
+static void armPeriodicTimer()
+{
+	if (0 != periodicTimeoutId)
+	{
+		g_source_remove(periodicTimeoutId);
+		periodicTimeoutId = 0;
+	}
+
+	int64_t delayMS = tickEventWheel.getDelayMS(UpdateQueue::nowUS() / 1000);
+	if (delayMS >= 0)
+	{
+		periodicTimeoutId = g_timeout_add(static_cast<guint>(delayMS), onPeriodicTimer, nullptr);
+	}
+}
+
 // Periodic timer handler
 //
-// A periodic timer is a timer fires every so often (see kPeriodicTimerFrequencySeconds.) This is used for our initialization
-// failure retries, but custom code can also be added to a server description (see `onEvent()`)
-gboolean onPeriodicTimer(gpointer pUserData)
+// The periodic timer drives the events added to a server description (see `onEvent()`.) Rather than firing at a fixed rate, it is
+// armed for the next time one of them is due (see `armPeriodicTimer()`), so only due events are visited. Initialization retries
+// have their own timer (see `setRetry()`.)
+gboolean onPeriodicTimer(gpointer /*pUserData*/)
 {
+	// This is a one-shot timer; we re-arm it below
+	periodicTimeoutId = 0;
+
 	// If we're shutting down, don't do anything and stop the periodic timer
 	if (ggkGetServerRunState() > ERunning)
 	{
 		return FALSE;
 	}
 
-	// Deal with retry timers
-	if (0 != retryTimeStart)
-	{
-		Logger::debug(SSTR << "Ticking retry timer");
+	tickEventWheel.advance(UpdateQueue::nowUS() / 1000, onTickEventDue, nullptr);
+	armPeriodicTimer();
+
+	return FALSE;
+}
 
-		// Has the retry time expired?
-		int secondsRemaining = time(nullptr) - retryTimeStart - kRetryDelaySeconds;
-		if (secondsRemaining >= 0)
+// Adds the events of an object and its descendants to the tick event wheel
+static void addTickEvents(const DBusObject &object)
+{
+	for (const std::shared_ptr<DBusInterface> &interface : object.getInterfaces())
+	{
+		for (const TickEvent &event : interface->getEvents())
 		{
-			retryTimeStart = 0;
-			initializationStateProcessor();
+			tickEventWheel.add(event);
 		}
 	}
 
-	// If we're registered, then go ahead and emit signals
-	if (bApplicationRegistered)
+	for (const DBusObject &child : object.getChildren())
 	{
-		// Tick the object hierarchy
-		//
-		// The real goal here is to have the objects tick their interfaces (see `onEvent()` method when adding interfaces inside
-		// 'Server::Server()'
-		for (const DBusObject &object : TheServer->getObjects())
+		addTickEvents(child);
+	}
+}
+
+// Schedules the events of our published objects and arms the periodic timer
+//
+// The events are scheduled once per run of the server; later calls leave the schedule as it is.
+static void startTickEvents()
+{
+	if (0 != periodicTimeoutId || tickEventWheel.size() > 0)
+	{
+		return;
+	}
+
+	tickEventWheel.reset(UpdateQueue::nowUS() / 1000);
+	for (const DBusObject &object : TheServer->getObjects())
+	{
+		if (object.isPublished())
 		{
-			if (object.isPublished())
-			{
-				object.tickEvents(pBusConnection, pUserData);
-			}
+			addTickEvents(object);
 		}
 	}
 
-	return TRUE;
+	GGK_LOG_DEBUG(SSTR << "Scheduled " << tickEventWheel.size() << " tick events");
+	armPeriodicTimer();
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -380,12 +610,9 @@ void onMethodCall
 	gpointer pUserData
 )
 {
-	// Convert our input path into our custom type for path management
-	DBusObjectPath objectPath(pObjectPath);
-
-	if (!TheServer->callMethod(objectPath, pInterfaceName, pMethodName, pConnection, pParameters, pInvocation, pUserData))
+	if (!TheServer->callMethod(pObjectPath, pInterfaceName, pMethodName, pConnection, pParameters, pInvocation, pUserData))
 	{
-		Logger::error(SSTR << " + Method not found: [" << pSender << "]:[" << objectPath << "]:[" << pInterfaceName << "]:[" << pMethodName << "]");
+		GGK_LOG_ERROR(SSTR << " + Method not found: [" << pSender << "]:[" << pObjectPath << "]:[" << pInterfaceName << "]:[" << pMethodName << "]");
 		g_dbus_method_invocation_return_dbus_error(pInvocation, kErrorNotImplemented.c_str(), "This method is not implemented");
 		return;
 	}
@@ -393,6 +620,14 @@ void onMethodCall
 	return;
 }
 
+// Returns a description of a property request for the log and for errors returned to the caller
+//
+// This is only built when it's needed, so that a successful property request doesn't have to build strings.
+static std::string describeProperty(const gchar *pSender, const gchar *pObjectPath, const gchar *pInterfaceName, const gchar *pPropertyName)
+{
+	return std::string("[") + pSender + "]:[" + pObjectPath + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+}
+
 // Handle D-Bus requests to get a property
 GVariant *onGetProperty
 (
@@ -405,31 +640,29 @@ GVariant *onGetProperty
 	gpointer         pUserData
 )
 {
-	// Convert our input path into our custom type for path management
-	DBusObjectPath objectPath(pObjectPath);
-
-	const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
-
-	std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+	const GattProperty *pProperty = TheServer->findProperty(pObjectPath, pInterfaceName, pPropertyName);
 	if (!pProperty)
 	{
-		Logger::error(SSTR << "Property(get) not found: " << propertyPath);
+		std::string propertyPath = describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName);
+		GGK_LOG_ERROR(SSTR << "Property(get) not found: " << propertyPath);
 	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) not found: " + propertyPath).c_str(), pSender);
 		return nullptr;
 	}
 
 	if (!pProperty->getGetterFunc())
 	{
-		Logger::error(SSTR << "Property(get) func not found: " << propertyPath);
+		std::string propertyPath = describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName);
+		GGK_LOG_ERROR(SSTR << "Property(get) func not found: " << propertyPath);
 	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) func not found: " + propertyPath).c_str(), pSender);
 		return nullptr;
 	}
 
-	Logger::info(SSTR << "Calling property getter: " << propertyPath);
-	GVariant *pResult = pProperty->getGetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, ppError, pUserData);
+	GGK_LOG_INFO(SSTR << "Calling property getter: " << describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName));
+	GVariant *pResult = pProperty->getGetterFunc()(pConnection, pSender, pObjectPath, pInterfaceName, pPropertyName, ppError, pUserData);
 
 	if (nullptr == pResult)
 	{
+		std::string propertyPath = describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName);
 	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(get) failed: " + propertyPath).c_str(), pSender);
 	    return nullptr;
 	}
@@ -450,29 +683,27 @@ gboolean onSetProperty
 	gpointer         pUserData
 )
 {
-	// Convert our input path into our custom type for path management
-	DBusObjectPath objectPath(pObjectPath);
-
-	const GattProperty *pProperty = TheServer->findProperty(objectPath, pInterfaceName, pPropertyName);
-
-	std::string propertyPath = std::string("[") + pSender + "]:[" + objectPath.toString() + "]:[" + pInterfaceName + "]:[" + pPropertyName + "]";
+	const GattProperty *pProperty = TheServer->findProperty(pObjectPath, pInterfaceName, pPropertyName);
 	if (!pProperty)
 	{
-		Logger::error(SSTR << "Property(set) not found: " << propertyPath);
+		std::string propertyPath = describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName);
+		GGK_LOG_ERROR(SSTR << "Property(set) not found: " << propertyPath);
 	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) not found: " + propertyPath).c_str(), pSender);
 		return false;
 	}
 
 	if (!pProperty->getSetterFunc())
 	{
-		Logger::error(SSTR << "Property(set) func not found: " << propertyPath);
+		std::string propertyPath = describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName);
+		GGK_LOG_ERROR(SSTR << "Property(set) func not found: " << propertyPath);
 	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) func not found: " + propertyPath).c_str(), pSender);
 		return false;
 	}
 
-	Logger::info(SSTR << "Calling property getter: " << propertyPath);
-	if (!pProperty->getSetterFunc()(pConnection, pSender, objectPath.c_str(), pInterfaceName, pPropertyName, pValue, ppError, pUserData))
+	GGK_LOG_INFO(SSTR << "Calling property getter: " << describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName));
+	if (!pProperty->getSetterFunc()(pConnection, pSender, pObjectPath, pInterfaceName, pPropertyName, pValue, ppError, pUserData))
 	{
+		std::string propertyPath = describeProperty(pSender, pObjectPath, pInterfaceName, pPropertyName);
 	    g_set_error(ppError, G_IO_ERROR, G_IO_ERROR_FAILED, ("Property(set) failed: " + propertyPath).c_str(), pSender);
 	    return false;
 	}
@@ -490,18 +721,43 @@ gboolean onSetProperty
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// Retry timer handler: picks up initialization where it left off
+gboolean onRetryTimer(gpointer /*pUserData*/)
+{
+	retrySourceId = 0;
+	initializationStateProcessor();
+
+	// One-shot
+	return FALSE;
+}
+
 // Convenience method for setting a retry timer so that operations can be continuously retried until we eventually succeed
-void setRetry()
+//
+// Retries back off exponentially, from kRetryInitialDelayMS up to kRetryMaxDelayMS, so that a transient failure costs
+// milliseconds rather than seconds while a persistent one doesn't spin. The delay starts over once initialization makes progress
+// (see `enterPhase()`.) GLib's timers run on the monotonic clock, so changes to the wall clock don't affect them.
+//
+// Returns the delay, in milliseconds, until the retry
+int setRetry()
 {
-	retryTimeStart = time(nullptr);
+	// A retry is already on its way
+	if (0 != retrySourceId)
+	{
+		return retryDelayMS;
+	}
+
+	int delayMS = retryDelayMS;
+	retrySourceId = g_timeout_add(delayMS, onRetryTimer, nullptr);
+	retryDelayMS = std::min(retryDelayMS * 2, kRetryMaxDelayMS);
+	return delayMS;
 }
 
 // Convenience method for setting a retry timer so that failures (related to initialization) can be continuously retried until we
 // eventually succeed.
 void setRetryFailure()
 {
-	setRetry();
-	Logger::warn(SSTR << "  + Will retry the failed operation in about " << kRetryDelaySeconds << " seconds");
+	int delayMS = setRetry();
+	GGK_LOG_WARN(SSTR << "  + Will retry the failed operation in " << delayMS << "ms");
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -537,13 +793,13 @@ void doRegisterApplication()
 			GVariant *pVariant = g_dbus_proxy_call_finish(pBluezGattManagerProxy, pAsyncResult, &pError);
 			if (nullptr == pVariant)
 			{
-				Logger::error(SSTR << "Failed to register application: " << (nullptr == pError ? "Unknown" : pError->message));
+				GGK_LOG_ERROR(SSTR << "Failed to register application: " << (nullptr == pError ? "Unknown" : pError->message));
 				setRetryFailure();
 			}
 			else
 			{
 				g_variant_unref(pVariant);
-				Logger::debug(SSTR << "GATT application registered with BlueZ");
+				GGK_LOG_DEBUG(SSTR << "GATT application registered with BlueZ");
 				bApplicationRegistered = true;
 			}
 
@@ -563,8 +819,8 @@ void doRegisterApplication()
 //  \___/|_.__// |\___|\___|\__| |_|  \___|\__, |_|___/\__|_|  \__,_|\__|_|\___/|_| |_|
 //           |__/                          |___/
 //
-// Before we can register our service(s) with BlueZ, we must first register ourselves with D-Bus. The easiest way to do this is to
-// use an XML description of our D-Bus objects.
+// Before we can register our service(s) with BlueZ, we must first register ourselves with D-Bus. We describe our D-Bus objects
+// to GIO by building its introspection structures straight from our object tree (see `DBusObject::generateNodeInfo()`.)
 // ---------------------------------------------------------------------------------------------------------------------------------
 
 void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath = DBusObjectPath(), int depth = 1)
@@ -579,12 +835,12 @@ void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath
 
 	GDBusInterfaceInfo **ppInterface = pNode->interfaces;
 
-	Logger::debug(SSTR << prefix << "+ " << pNode->path);
+	GGK_LOG_DEBUG(SSTR << prefix << "+ " << pNode->path);
 
 	while(nullptr != *ppInterface)
 	{
 		GError *pError = nullptr;
-		Logger::debug(SSTR << prefix << "    (iface: " << (*ppInterface)->name << ")");
+		GGK_LOG_DEBUG(SSTR << prefix << "    (iface: " << (*ppInterface)->name << ")");
 		guint registeredObjectId = g_dbus_connection_register_object
 		(
 			pBusConnection,             // GDBusConnection *connection
@@ -598,7 +854,7 @@ void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath
 
 		if (0 == registeredObjectId)
 		{
-			Logger::error(SSTR << "Failed to register object: " << (nullptr == pError ? "Unknown" : pError->message));
+			GGK_LOG_ERROR(SSTR << "Failed to register object: " << (nullptr == pError ? "Unknown" : pError->message));
 
 			// Cleanup and pretend like we were never here
 			g_dbus_node_info_unref(pNode);
@@ -624,22 +880,211 @@ void registerNodeHierarchy(GDBusNodeInfo *pNode, const DBusObjectPath &basePath
 	}
 }
 
-void registerObjects()
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Subtree registration
+//
+// Registering every interface of every object (above) costs one D-Bus registration per interface, which adds up for large GATT
+// databases. With subtree registration enabled (see `setSubtreeRegistration()`), we instead register subtrees and let GIO ask
+// us which interfaces an object has only when a call for it arrives. Calls are then dispatched through the server's object
+// index (see `Server::findObject()`.)
+//
+// GIO only dispatches a subtree's own path and its direct children, so we register a subtree for each root object and for each
+// object that has children. Every other object is a leaf, served by its parent's subtree. The interface descriptions are built
+// the first time an object is asked for and kept until shutdown.
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Enables or disables subtree registration (disabled by default)
+//
+// This takes effect the next time our objects are registered with D-Bus, so it should be set before `ggkStart()`.
+void setSubtreeRegistration(bool enabled)
 {
-	// Parse each object into an XML interface tree
-	for (const DBusObject &object : TheServer->getObjects())
+	subtreeRegistration = enabled;
+}
+
+// Returns true if subtree registration is enabled
+bool getSubtreeRegistration()
+{
+	return subtreeRegistration;
+}
+
+// Returns the object a subtree call is for: the subtree's own object (`pNode` is null) or its child named `pNode`
+static const DBusObject *findSubtreeObject(const gchar *pObjectPath, const gchar *pNode)
+{
+	if (nullptr == pNode)
+	{
+		return TheServer->findObject(pObjectPath);
+	}
+
+	return TheServer->findObject((DBusObjectPath(pObjectPath) + DBusObjectPath(pNode)).c_str());
+}
+
+// Lists the children of a subtree's object
+gchar **onSubtreeEnumerate(GDBusConnection * /*pConnection*/, const gchar * /*pSender*/, const gchar * /*pObjectPath*/, gpointer pUserData)
+{
+	const DBusObject *pObject = static_cast<const DBusObject *>(pUserData);
+
+	gchar **ppNodes = g_new0(gchar *, pObject->getChildren().size() + 1);
+	int index = 0;
+	for (const DBusObject &child : pObject->getChildren())
+	{
+		// Nodes are named by the last element of their path
+		const std::string &childPath = child.getPath().toString();
+		ppNodes[index++] = g_strdup(childPath.c_str() + childPath.rfind('/') + 1);
+	}
+
+	return ppNodes;
+}
+
+// Describes the interfaces of an object within a subtree
+//
+// GIO calls this for every method call it dispatches to a subtree (to find the interface being called), so the descriptions are
+// built once and then shared.
+GDBusInterfaceInfo **onSubtreeIntrospect(GDBusConnection * /*pConnection*/, const gchar * /*pSender*/, const gchar *pObjectPath, const gchar *pNode, gpointer /*pUserData*/)
+{
+	const DBusObject *pObject = findSubtreeObject(pObjectPath, pNode);
+	if (nullptr == pObject)
+	{
+		return nullptr;
+	}
+
+	std::vector<GDBusInterfaceInfo *> &interfaceInfo = subtreeInterfaceInfo[pObject];
+	if (interfaceInfo.empty())
+	{
+		for (const std::shared_ptr<DBusInterface> &interface : pObject->getInterfaces())
+		{
+			interfaceInfo.push_back(interface->generateInterfaceInfo());
+		}
+	}
+
+	// GIO takes ownership of the (null-terminated) array and a reference to each description
+	GDBusInterfaceInfo **ppInterfaces = g_new0(GDBusInterfaceInfo *, interfaceInfo.size() + 1);
+	for (size_t i = 0; i < interfaceInfo.size(); ++i)
+	{
+		ppInterfaces[i] = g_dbus_interface_info_ref(interfaceInfo[i]);
+	}
+
+	return ppInterfaces;
+}
+
+// Returns the handlers for a call within a subtree
+//
+// These are the same handlers used for individually registered objects; they find their target from the call's object path.
+const GDBusInterfaceVTable *onSubtreeDispatch(GDBusConnection * /*pConnection*/, const gchar * /*pSender*/, const gchar * /*pObjectPath*/, const gchar * /*pInterfaceName*/, const gchar * /*pNode*/, gpointer *ppOutUserData, gpointer /*pUserData*/)
+{
+	static GDBusInterfaceVTable interfaceVtable;
+	interfaceVtable.method_call = onMethodCall;
+	interfaceVtable.get_property = onGetProperty;
+	interfaceVtable.set_property = onSetProperty;
+
+	*ppOutUserData = nullptr;
+	return &interfaceVtable;
+}
+
+// Registers a subtree for `object` if it needs one (see above), then does the same for its descendants
+//
+// Returns true on success, otherwise false
+static bool registerSubtreeHierarchy(const DBusObject &object, bool isRoot)
+{
+	static GDBusSubtreeVTable subtreeVtable;
+	subtreeVtable.enumerate = onSubtreeEnumerate;
+	subtreeVtable.introspect = onSubtreeIntrospect;
+	subtreeVtable.dispatch = onSubtreeDispatch;
+
+	if (isRoot || !object.getChildren().empty())
 	{
 		GError *pError = nullptr;
-		std::string xmlString = object.generateIntrospectionXML();
-		GDBusNodeInfo *pNode = g_dbus_node_info_new_for_xml(xmlString.c_str(), &pError);
-		if (nullptr == pNode)
+		GGK_LOG_DEBUG(SSTR << "  + " << object.getPath() << " (subtree)");
+		guint registeredSubtreeId = g_dbus_connection_register_subtree
+		(
+			pBusConnection,                        // GDBusConnection *connection
+			object.getPath().c_str(),              // const gchar *object_path
+			&subtreeVtable,                        // const GDBusSubtreeVTable *vtable
+			G_DBUS_SUBTREE_FLAGS_NONE,             // GDBusSubtreeFlags flags
+			const_cast<DBusObject *>(&object),     // gpointer user_data
+			nullptr,                               // GDestroyNotify user_data_free_func
+			&pError                                // GError **error
+		);
+
+		if (0 == registeredSubtreeId)
+		{
+			GGK_LOG_ERROR(SSTR << "Failed to register subtree: " << (nullptr == pError ? "Unknown" : pError->message));
+			return false;
+		}
+
+		// Save the registered subtree Id so we can clean it up later
+		registeredSubtreeIds.push_back(registeredSubtreeId);
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		if (!registerSubtreeHierarchy(child, false))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Unregisters our subtrees and releases the interface descriptions we built for them
+static void unregisterSubtrees()
+{
+	for (guint id : registeredSubtreeIds)
+	{
+		g_dbus_connection_unregister_subtree(pBusConnection, id);
+	}
+	registeredSubtreeIds.clear();
+
+	for (const auto &entry : subtreeInterfaceInfo)
+	{
+		for (GDBusInterfaceInfo *pInterfaceInfo : entry.second)
+		{
+			g_dbus_interface_info_unref(pInterfaceInfo);
+		}
+	}
+	subtreeInterfaceInfo.clear();
+}
+
+void registerSubtrees()
+{
+	GGK_LOG_DEBUG(SSTR << "Registering object subtrees with D-Bus");
+
+	for (const DBusObject &object : TheServer->getObjects())
+	{
+		if (!registerSubtreeHierarchy(object, true))
 		{
-			Logger::error(SSTR << "Failed to introspect XML: " << (nullptr == pError ? "Unknown" : pError->message));
+			// Cleanup and pretend like we were never here
+			unregisterSubtrees();
+
+			// Try again later
 			setRetryFailure();
 			return;
 		}
+	}
+
+	GGK_LOG_DEBUG(SSTR << "Registered " << registeredSubtreeIds.size() << " subtrees");
+
+	// Keep going
+	initializationStateProcessor();
+}
+
+void registerObjects()
+{
+	if (subtreeRegistration)
+	{
+		registerSubtrees();
+		return;
+	}
+
+	// Convert each object into an interface tree
+	for (const DBusObject &object : TheServer->getObjects())
+	{
+		// The XML describing the same tree is only generated for the debug log
+		GGK_LOG_DEBUG(SSTR << "Generated XML:\n" << object.generateIntrospectionXML());
 
-		Logger::debug(SSTR << "Registering object hierarchy with D-Bus hierarchy");
+		GDBusNodeInfo *pNode = object.generateNodeInfo();
+
+		GGK_LOG_DEBUG(SSTR << "Registering object hierarchy with D-Bus hierarchy");
 
 		// Register the node hierarchy
 		registerNodeHierarchy(pNode, DBusObjectPath(pNode->path));
@@ -698,15 +1143,20 @@ void configureAdapter()
 		// We need it off to start with
 		if (pwFlag)
 		{
-			Logger::debug("Powering off");
+			GGK_LOG_DEBUG("Powering off");
 			if (!mgmt.setPowered(false)) { setRetry(); return; }
 		}
 
+		// With the adapter off, the settings below are independent changes that the adapter applies in the order we send them,
+		// so we send them back-to-back and collect the responses together. Each command only reports success once it's sent;
+		// `finishBatch()` logs any that failed.
+		mgmt.beginBatch();
+
 		// Enable the LE state (we always set this state if it's not set)
 		if (!leFlag)
 		{
-			Logger::debug("Enabling LE");
-			if (!mgmt.setLE(true)) { setRetry(); return; }
+			GGK_LOG_DEBUG("Enabling LE");
+			mgmt.setLE(true);
 		}
 
 		// Change the Br/Edr state?
@@ -714,58 +1164,68 @@ void configureAdapter()
 		// Note that enabling this requries LE to already be enabled or this command will receive a 'rejected' result
 		if (!brFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableBREDR() ? "Enabling":"Disabling") << " BR/EDR");
-			if (!mgmt.setBredr(TheServer->getEnableBREDR())) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (TheServer->getEnableBREDR() ? "Enabling":"Disabling") << " BR/EDR");
+			mgmt.setBredr(TheServer->getEnableBREDR());
 		}
 
 		// Change the Secure Connectinos state?
 		if (!scFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableSecureConnection() ? "Enabling":"Disabling") << " Secure Connections");
-			if (!mgmt.setSecureConnections(TheServer->getEnableSecureConnection() ? 1 : 0)) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (TheServer->getEnableSecureConnection() ? "Enabling":"Disabling") << " Secure Connections");
+			mgmt.setSecureConnections(TheServer->getEnableSecureConnection() ? 1 : 0);
 		}
 
 		// Change the Bondable state?
 		if (!bnFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableBondable() ? "Enabling":"Disabling") << " Bondable");
-			if (!mgmt.setBondable(TheServer->getEnableBondable())) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (TheServer->getEnableBondable() ? "Enabling":"Disabling") << " Bondable");
+			mgmt.setBondable(TheServer->getEnableBondable());
 		}
 
 		// Change the Connectable state?
 		if (!cnFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableConnectable() ? "Enabling":"Disabling") << " Connectable");
-			if (!mgmt.setConnectable(TheServer->getEnableConnectable())) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (TheServer->getEnableConnectable() ? "Enabling":"Disabling") << " Connectable");
+			mgmt.setConnectable(TheServer->getEnableConnectable());
 		}
 
 		// Change the Discoverable state?
 		if (!diFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableDiscoverable() ? "Enabling":"Disabling") << " Discoverable");
-			if (!mgmt.setDiscoverable(TheServer->getEnableDiscoverable() ? 1 : 0, 0)) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (TheServer->getEnableDiscoverable() ? "Enabling":"Disabling") << " Discoverable");
+			mgmt.setDiscoverable(TheServer->getEnableDiscoverable() ? 1 : 0, 0);
 		}
 
 		// Change the Advertising state?
 		if (!adFlag)
 		{
-			Logger::debug(SSTR << (TheServer->getEnableAdvertising() ? "Enabling":"Disabling") << " Advertising");
-			if (!mgmt.setAdvertising(TheServer->getEnableAdvertising() ? 1 : 0)) { setRetry(); return; }
+			GGK_LOG_DEBUG(SSTR << (TheServer->getEnableAdvertising() ? "Enabling":"Disabling") << " Advertising");
+			mgmt.setAdvertising(TheServer->getEnableAdvertising() ? 1 : 0);
 		}
 
 		// Set the name?
 		if (!anFlag && !hasCustomerAdvertisingData)
 		{
-			Logger::info(SSTR << "Setting advertising name to '" << advertisingName << "' (with short name: '" << advertisingShortName << "')");
-			if (!mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str())) { setRetry(); return; }
+			GGK_LOG_INFO(SSTR << "Setting advertising name to '" << advertisingName << "' (with short name: '" << advertisingShortName << "')");
+			mgmt.setName(advertisingName.c_str(), advertisingShortName.c_str());
+		}
+
+		if (!mgmt.finishBatch())
+		{
+			// A setting the adapter doesn't support won't be any different next time, so only retry if something else failed
+			if (mgmt.isRetryable()) { setRetry(); return; }
+			GGK_LOG_WARN("The adapter does not support some of the requested settings; continuing without them");
 		}
 
 		// Turn it back on
-		Logger::debug("Powering on");
+		GGK_LOG_DEBUG("Powering on");
 
         if (hasCustomerAdvertisingData)
         {
-            if (!mgmt.setRawAdvertisingData(TheServer->getRawAdvertisingData())) { setRetry(); return;}
+            const RawAdvertisingData &adv = TheServer->getRawAdvertisingData();
+            AdvertisingManager &advertising = AdvertisingManager::getInstance();
+            advertising.forget();
+            if (!advertising.setInstance(AdvertisingManager::kDefaultInstance, adv.advData, adv.advDataLen, adv.rspData, adv.rspDataLen, 0)) { setRetry(); return;}
         }
 
 		if (!mgmt.setPowered(true)) { setRetry(); return; }
@@ -774,7 +1234,7 @@ void configureAdapter()
         configured = true;
 	}
 
-	Logger::info("The Bluetooth adapter is fully configured");
+	GGK_LOG_INFO("The Bluetooth adapter is fully configured");
 
 	// We're all set, nothing to do!
 	bAdapterConfigured = true;
@@ -799,7 +1259,7 @@ void findAdapterInterface()
 	GList *pObjects = g_dbus_object_manager_get_objects(pBluezObjectManager);
 	if (nullptr == pObjects)
 	{
-		Logger::error(SSTR << "Unable to get ObjectManager objects");
+		GGK_LOG_ERROR(SSTR << "Unable to get ObjectManager objects");
 		setRetryFailure();
 		return;
 	}
@@ -821,7 +1281,7 @@ void findAdapterInterface()
 		pBluezAdapterInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.bluez.Adapter1"));
 		if (nullptr == pBluezAdapterInterfaceProxy)
 		{
-			Logger::warn(SSTR << "Failed to get adapter proxy for interface 'org.bluez.Adapter1'");
+			GGK_LOG_WARN(SSTR << "Failed to get adapter proxy for interface 'org.bluez.Adapter1'");
 			continue;
 		}
 
@@ -829,7 +1289,7 @@ void findAdapterInterface()
 		pBluezAdapterPropertiesInterfaceProxy = reinterpret_cast<GDBusProxy *>(g_dbus_object_get_interface(pBluezAdapterObject, "org.freedesktop.DBus.Properties"));
 		if (nullptr == pBluezAdapterPropertiesInterfaceProxy)
 		{
-			Logger::warn(SSTR << "Failed to get adapter properties proxy for interface 'org.freedesktop.DBus.Properties'");
+			GGK_LOG_WARN(SSTR << "Failed to get adapter properties proxy for interface 'org.freedesktop.DBus.Properties'");
 			continue;
 		}
 
@@ -855,14 +1315,14 @@ void findAdapterInterface()
 	// If we didn't find the adapter object, reset things and we'll try again later
 	if (nullptr == pBluezAdapterObject || nullptr == pBluezDeviceObject)
 	{
-		Logger::warn(SSTR << "Unable to find BlueZ objects outside of object list");
+		GGK_LOG_WARN(SSTR << "Unable to find BlueZ objects outside of object list");
 		bluezGattManagerInterfaceName.clear();
 	}
 
 	// If we never ended up with an interface name, bail now
 	if (bluezGattManagerInterfaceName.empty())
 	{
-		Logger::error(SSTR << "Unable to find the adapter");
+		GGK_LOG_ERROR(SSTR << "Unable to find the adapter");
 		setRetryFailure();
 		return;
 	}
@@ -907,7 +1367,7 @@ void getBluezObjectManager()
 
 			if (nullptr == pBluezObjectManager)
 			{
-				Logger::error(SSTR << "Failed to get an ObjectManager client: " << (nullptr == pError ? "Unknown" : pError->message));
+				GGK_LOG_ERROR(SSTR << "Failed to get an ObjectManager client: " << (nullptr == pError ? "Unknown" : pError->message));
 				setRetryFailure();
 				return;
 			}
@@ -948,17 +1408,12 @@ void doOwnedNameAcquire()
 		// GBusNameAcquiredCallback name_acquired_handler
 		[](GDBusConnection *, const gchar *, gpointer)
 		{
-			// Handy way to get periodic activity
-			periodicTimeoutId = g_timeout_add_seconds(kPeriodicTimerFrequencySeconds, onPeriodicTimer, pBusConnection);
-			if (periodicTimeoutId <= 0)
-			{
-				Logger::fatal(SSTR << "Failed to add a periodic timer");
-				setServerHealth(EFailedInit);
-				shutdown();
-			}
+			// Start our periodic activity
+			startTickEvents();
 
 			// Bus name acquired
 			bOwnedNameAcquired = true;
+			bOwnedNameEverAcquired = true;
 
 			// Keep going...
 			initializationStateProcessor();
@@ -970,16 +1425,16 @@ void doOwnedNameAcquire()
 			// Bus name lost
 			bOwnedNameAcquired = false;
 
-			// If we don't have a periodicTimeout (which we use for error recovery) then we're sunk
-			if (0 == periodicTimeoutId)
+			// If we never had the name, then we're sunk
+			if (!bOwnedNameEverAcquired)
 			{
-				Logger::fatal(SSTR << "Unable to acquire an owned name ('" << TheServer->getOwnedName() << "') on the bus");
+				GGK_LOG_FATAL(SSTR << "Unable to acquire an owned name ('" << TheServer->getOwnedName() << "') on the bus");
 				setServerHealth(EFailedInit);
 				shutdown();
 			}
 			else
 			{
-				Logger::warn(SSTR << "Owned name ('" << TheServer->getOwnedName() << "') lost");
+				GGK_LOG_WARN(SSTR << "Owned name ('" << TheServer->getOwnedName() << "') lost");
 				setRetryFailure();
 				return;
 			}
@@ -1021,7 +1476,7 @@ void doBusAcquire()
 
 			if (nullptr == pBusConnection)
 			{
-				Logger::fatal(SSTR << "Failed to get bus connection: " << (nullptr == pError ? "Unknown" : pError->message));
+				GGK_LOG_FATAL(SSTR << "Failed to get bus connection: " << (nullptr == pError ? "Unknown" : pError->message));
 				setServerHealth(EFailedInit);
 				shutdown();
 			}
@@ -1044,13 +1499,49 @@ void doBusAcquire()
 //
 // ---------------------------------------------------------------------------------------------------------------------------------
 
+// Records that initialization has reached `phase`, charging the time since the previous phase began to that phase
+//
+// Reaching a new phase means the previous one succeeded, so the retry delay starts over. Pass EPhaseCount when initialization
+// completes.
+static void enterPhase(int phase)
+{
+	if (phase == currentPhase)
+	{
+		return;
+	}
+
+	int64_t nowUS = UpdateQueue::nowUS();
+	if (currentPhase < EPhaseCount)
+	{
+		phaseDurationUS[currentPhase] += nowUS - phaseStartUS;
+	}
+
+	currentPhase = phase;
+	phaseStartUS = nowUS;
+	retryDelayMS = kRetryInitialDelayMS;
+}
+
+// Logs how long initialization took, phase by phase
+static void logStartupTiming()
+{
+	std::string breakdown;
+	for (int phase = 0; phase < EPhaseCount; ++phase)
+	{
+		breakdown += std::string(phase == 0 ? "" : ", ") + kInitPhaseNames[phase] + ": " + std::to_string(phaseDurationUS[phase] / 1000) + "ms";
+	}
+
+	GGK_LOG_INFO(SSTR << "Initialization took " << (UpdateQueue::nowUS() - initStartUS) / 1000 << "ms (" << breakdown << ")");
+}
+
 // Poor-man's state machine, which effectively ensures everything is initialized in order by verifying actual initialization state
 // rather than stepping through a set of numeric states. This way, if something fails in an out-of-order sort of way, we can still
 // handle it and recover nicely.
+//
+// There is no polling here: each step's completion callback (or its retry timer) calls us again to take the next step.
 void initializationStateProcessor()
 {
 	// If we're in our end-of-life or waiting for a retry, don't process states
-	if (ggkGetServerRunState() > ERunning || 0 != retryTimeStart)
+	if (ggkGetServerRunState() > ERunning || 0 != retrySourceId)
 	{
 		return;
 	}
@@ -1060,7 +1551,8 @@ void initializationStateProcessor()
 	//
 	if (nullptr == pBusConnection)
 	{
-		Logger::debug(SSTR << "Acquiring bus connection");
+		enterPhase(EPhaseBusConnection);
+		GGK_LOG_DEBUG(SSTR << "Acquiring bus connection");
 		doBusAcquire();
 		return;
 	}
@@ -1070,7 +1562,8 @@ void initializationStateProcessor()
 	//
 	if (!bOwnedNameAcquired)
 	{
-		Logger::debug(SSTR << "Acquiring owned name: '" << TheServer->getOwnedName() << "'");
+		enterPhase(EPhaseOwnedName);
+		GGK_LOG_DEBUG(SSTR << "Acquiring owned name: '" << TheServer->getOwnedName() << "'");
 		doOwnedNameAcquire();
 		return;
 	}
@@ -1080,7 +1573,8 @@ void initializationStateProcessor()
 	//
 	if (nullptr == pBluezObjectManager)
 	{
-		Logger::debug(SSTR << "Getting BlueZ ObjectManager");
+		enterPhase(EPhaseObjectManager);
+		GGK_LOG_DEBUG(SSTR << "Getting BlueZ ObjectManager");
 		getBluezObjectManager();
 		return;
 	}
@@ -1090,7 +1584,8 @@ void initializationStateProcessor()
 	//
 	if (bluezGattManagerInterfaceName.empty())
 	{
-		Logger::debug(SSTR << "Finding BlueZ GattManager1 interface");
+		enterPhase(EPhaseAdapterInterface);
+		GGK_LOG_DEBUG(SSTR << "Finding BlueZ GattManager1 interface");
 		findAdapterInterface();
 		return;
 	}
@@ -1100,7 +1595,8 @@ void initializationStateProcessor()
 	//
 	if (!bAdapterConfigured)
 	{
-		Logger::debug(SSTR << "Configuring BlueZ adapter '" << bluezGattManagerInterfaceName << "'");
+		enterPhase(EPhaseAdapterConfiguration);
+		GGK_LOG_DEBUG(SSTR << "Configuring BlueZ adapter '" << bluezGattManagerInterfaceName << "'");
 		configureAdapter();
 		return;
 	}
@@ -1108,9 +1604,10 @@ void initializationStateProcessor()
 	//
 	// Register our object with D-bus
 	//
-	if (registeredObjectIds.empty())
+	if (registeredObjectIds.empty() && registeredSubtreeIds.empty())
 	{
-		Logger::debug(SSTR << "Registering with D-Bus");
+		enterPhase(EPhaseObjectRegistration);
+		GGK_LOG_DEBUG(SSTR << "Registering with D-Bus");
 		registerObjects();
 		return;
 	}
@@ -1118,7 +1615,8 @@ void initializationStateProcessor()
 	// Register our appliation with the BlueZ GATT manager
 	if (!bApplicationRegistered)
 	{
-		Logger::debug(SSTR << "Registering application with BlueZ GATT manager");
+		enterPhase(EPhaseApplicationRegistration);
+		GGK_LOG_DEBUG(SSTR << "Registering application with BlueZ GATT manager");
 
 		doRegisterApplication();
 		return;
@@ -1134,7 +1632,19 @@ void initializationStateProcessor()
 	}
 
 	// Successful initialization - switch to running state
+	if (currentPhase < EPhaseCount)
+	{
+		enterPhase(EPhaseCount);
+		logStartupTiming();
+	}
+
 	setServerRunState(ERunning);
+
+	// Anything that was queued while we were initializing was held back; make sure it gets processed
+	if (!UpdateQueue::getInstance().empty())
+	{
+		UpdateQueue::getInstance().wake();
+	}
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -1155,6 +1665,15 @@ void runServerThread()
 	// Set the initialization state
 	setServerRunState(EInitializing);
 
+	// Start the clock on our startup phases
+	initStartUS = UpdateQueue::nowUS();
+	currentPhase = EPhaseCount;
+	retryDelayMS = kRetryInitialDelayMS;
+	for (int phase = 0; phase < EPhaseCount; ++phase)
+	{
+		phaseDurationUS[phase] = 0;
+	}
+
 	// Start our state processor, which is really just a simplified state machine that steps us through an asynchronous
 	// initialization process.
 	//
@@ -1167,40 +1686,42 @@ void runServerThread()
 	// There are alternatives, but using async methods is the recommended way.
 	initializationStateProcessor();
 
-	Logger::debug(SSTR << "Creating GLib main loop");
+	GGK_LOG_DEBUG(SSTR << "Creating GLib main loop");
 	pMainLoop = g_main_loop_new(NULL, FALSE);
 
-	// Add the idle function
+	// Watch the update queue
 	//
-	// Note that we actually run the idle function from a lambda. This allows us to manage the inter-idle sleep so we don't
-	// soak up 100% of our CPU.
-	guint res = g_idle_add
-	(
-		[](gpointer pUserData) -> gboolean
-		{
-			// Try to process some data and if no data is processed, sleep for the requested frequency
-			if (!idleFunc(pUserData))
+	// The queue signals an eventfd when updates are pushed, so we only run when there's something to do. If the eventfd could not
+	// be created, fall back to polling the queue every `kIdleFrequencyMS` milliseconds.
+	int updateQueueFd = UpdateQueue::getInstance().getWakeFd();
+	if (updateQueueFd >= 0)
+	{
+		updateQueueSourceId = g_unix_fd_add(updateQueueFd, G_IO_IN, onUpdateQueueReady, nullptr);
+	}
+	else
+	{
+		updateQueueSourceId = g_timeout_add
+		(
+			kIdleFrequencyMS,
+			[](gpointer pUserData) -> gboolean
 			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(kIdleFrequencyMS));
-			}
-
-			// Always return TRUE so our idle remains in tact
-			return TRUE;
-		},
-		nullptr
-	);
+				return onUpdateQueueReady(-1, G_IO_IN, pUserData);
+			},
+			nullptr
+		);
+	}
 
-	if (res == 0)
+	if (updateQueueSourceId == 0)
 	{
-		Logger::error(SSTR << "Unable to add idle to main loop");
+		GGK_LOG_ERROR(SSTR << "Unable to add update queue watch to main loop");
 	}
 
-	Logger::trace(SSTR << "Starting GLib main loop");
+	GGK_LOG_TRACE(SSTR << "Starting GLib main loop");
 	g_main_loop_run(pMainLoop);
 
 	// We have stopped
 	setServerRunState(EStopped);
-	Logger::info("GGK server stopped");
+	GGK_LOG_INFO("GGK server stopped");
 
 	// Cleanup
 	uninit();
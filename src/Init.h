@@ -34,4 +34,12 @@ void shutdown();
 // This method should not be called directly, instead, direct your attention over to `ggkStart()`
 void runServerThread();
 
+// Enables or disables subtree registration (disabled by default)
+//
+// This takes effect the next time our objects are registered with D-Bus, so it should be set before `ggkStart()`.
+void setSubtreeRegistration(bool enabled);
+
+// Returns true if subtree registration is enabled
+bool getSubtreeRegistration();
+
 }; // namespace ggk
\ No newline at end of file
@@ -40,14 +40,24 @@
 //
 // Using the logger is simple:
 //
-//    Logger::error("Unable to locate configuration file (this is probably bad)");
+//    GGK_LOG_ERROR("Unable to locate configuration file (this is probably bad)");
 //
 // There is an additional macro (SSTR) which can simplify sending dynamic data to the logger via a string stream:
 //
-//    Logger::info(SSTR << "There were " << count << " entries in the list");
+//    GGK_LOG_INFO(SSTR << "There were " << count << " entries in the list");
+//
+// The GGK_LOG_* macros only evaluate their arguments if a receiver is registered for that level, so the string stream above is
+// never built if nobody is listening. Levels below the compile-time minimum (GGK_LOG_LEVEL, set via the CMake option of the same
+// name) are compiled out entirely. The Logger methods (`Logger::info()`, etc.) may still be called directly, but their arguments
+// are always evaluated.
+//
+// Receivers are normally called on the thread that logs. Applications whose receivers are slow (for example, forwarding to a
+// remote syslog) can enable asynchronous delivery with `ggkLogSetAsync()`, in which case messages are queued and delivered by a
+// background thread. See AsyncLogger.cpp for details.
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include "Logger.h"
+#include "AsyncLogger.h"
 
 namespace ggk {
 
@@ -115,12 +125,75 @@ void Logger::registerAlwaysReceiver(GGKLogReceiver receiver) { Logger::logReceiv
 // appropriate logging action. To unregister, call with `nullptr`
 void Logger::registerTraceReceiver(GGKLogReceiver receiver) { Logger::logReceiverTrace = receiver; }
 
+// Returns the receiver registered for the given level, or nullptr if there is none
+GGKLogReceiver Logger::getReceiver(LogLevel level)
+{
+	switch(level)
+	{
+		case EDebug: return logReceiverDebug;
+		case EInfo: return logReceiverInfo;
+		case EStatus: return logReceiverStatus;
+		case EWarn: return logReceiverWarn;
+		case EError: return logReceiverError;
+		case EFatal: return logReceiverFatal;
+		case EAlways: return logReceiverAlways;
+		case ETrace: return logReceiverTrace;
+	}
+
+	return nullptr;
+}
+
+//
+// Asynchronous delivery
+//
+
+// Enables or disables asynchronous delivery
+//
+// When enabled, log messages are queued and delivered to the receivers by a background thread rather than on the thread that
+// logged them (see AsyncLogger.cpp.) Disabling delivers any queued messages before returning.
+//
+// Returns true if the requested mode is in effect on return
+bool Logger::setAsync(bool enabled)
+{
+	if (!enabled)
+	{
+		if (AsyncLogger::isActive())
+		{
+			AsyncLogger::getInstance().stop();
+		}
+		return true;
+	}
+
+	return AsyncLogger::getInstance().start();
+}
+
+// Returns true if asynchronous delivery is enabled
+bool Logger::getAsync()
+{
+	return AsyncLogger::isActive();
+}
+
+// Hands a message to its receiver, either directly or through the asynchronous backend if it is enabled
+//
+// If the asynchronous backend's ring is full, the message is dropped (and counted) rather than blocking the caller.
+void Logger::deliver(LogLevel level, GGKLogReceiver receiver, const char *pText)
+{
+	if (AsyncLogger::isActive())
+	{
+		AsyncLogger::getInstance().push(level, pText);
+	}
+	else
+	{
+		receiver(pText);
+	}
+}
+
 //
 // Logging actions
 //
 
 // Log a DEBUG entry with a C string
-void Logger::debug(const char *pText) { if (nullptr != Logger::logReceiverDebug) { Logger::logReceiverDebug(pText); } }
+void Logger::debug(const char *pText) { if (nullptr != Logger::logReceiverDebug) { deliver(EDebug, Logger::logReceiverDebug, pText); } }
 
 // Log a DEBUG entry with a string
 void Logger::debug(const std::string &text) { if (nullptr != Logger::logReceiverDebug) { debug(text.c_str()); } }
@@ -129,7 +202,7 @@ void Logger::debug(const std::string &text) { if (nullptr != Logger::logReceiver
 void Logger::debug(const std::ostream &text) { if (nullptr != Logger::logReceiverDebug) { debug(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a INFO entry with a C string
-void Logger::info(const char *pText) { if (nullptr != Logger::logReceiverInfo) { Logger::logReceiverInfo(pText); } }
+void Logger::info(const char *pText) { if (nullptr != Logger::logReceiverInfo) { deliver(EInfo, Logger::logReceiverInfo, pText); } }
 
 // Log a INFO entry with a string
 void Logger::info(const std::string &text) { if (nullptr != Logger::logReceiverInfo) { info(text.c_str()); } }
@@ -138,7 +211,7 @@ void Logger::info(const std::string &text) { if (nullptr != Logger::logReceiverI
 void Logger::info(const std::ostream &text) { if (nullptr != Logger::logReceiverInfo) { info(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a STATUS entry with a C string
-void Logger::status(const char *pText) { if (nullptr != Logger::logReceiverStatus) { Logger::logReceiverStatus(pText); } }
+void Logger::status(const char *pText) { if (nullptr != Logger::logReceiverStatus) { deliver(EStatus, Logger::logReceiverStatus, pText); } }
 
 // Log a STATUS entry with a string
 void Logger::status(const std::string &text) { if (nullptr != Logger::logReceiverStatus) { status(text.c_str()); } }
@@ -147,7 +220,7 @@ void Logger::status(const std::string &text) { if (nullptr != Logger::logReceive
 void Logger::status(const std::ostream &text) { if (nullptr != Logger::logReceiverStatus) { status(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a WARN entry with a C string
-void Logger::warn(const char *pText) { if (nullptr != Logger::logReceiverWarn) { Logger::logReceiverWarn(pText); } }
+void Logger::warn(const char *pText) { if (nullptr != Logger::logReceiverWarn) { deliver(EWarn, Logger::logReceiverWarn, pText); } }
 
 // Log a WARN entry with a string
 void Logger::warn(const std::string &text) { if (nullptr != Logger::logReceiverWarn) { warn(text.c_str()); } }
@@ -156,7 +229,7 @@ void Logger::warn(const std::string &text) { if (nullptr != Logger::logReceiverW
 void Logger::warn(const std::ostream &text) { if (nullptr != Logger::logReceiverWarn) { warn(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a ERROR entry with a C string
-void Logger::error(const char *pText) { if (nullptr != Logger::logReceiverError) { Logger::logReceiverError(pText); } }
+void Logger::error(const char *pText) { if (nullptr != Logger::logReceiverError) { deliver(EError, Logger::logReceiverError, pText); } }
 
 // Log a ERROR entry with a string
 void Logger::error(const std::string &text) { if (nullptr != Logger::logReceiverError) { error(text.c_str()); } }
@@ -165,7 +238,7 @@ void Logger::error(const std::string &text) { if (nullptr != Logger::logReceiver
 void Logger::error(const std::ostream &text) { if (nullptr != Logger::logReceiverError) { error(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a FATAL entry with a C string
-void Logger::fatal(const char *pText) { if (nullptr != Logger::logReceiverFatal) { Logger::logReceiverFatal(pText); } }
+void Logger::fatal(const char *pText) { if (nullptr != Logger::logReceiverFatal) { deliver(EFatal, Logger::logReceiverFatal, pText); } }
 
 // Log a FATAL entry with a string
 void Logger::fatal(const std::string &text) { if (nullptr != Logger::logReceiverFatal) { fatal(text.c_str()); } }
@@ -174,7 +247,7 @@ void Logger::fatal(const std::string &text) { if (nullptr != Logger::logReceiver
 void Logger::fatal(const std::ostream &text) { if (nullptr != Logger::logReceiverFatal) { fatal(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a ALWAYS entry with a C string
-void Logger::always(const char *pText) { if (nullptr != Logger::logReceiverAlways) { Logger::logReceiverAlways(pText); } }
+void Logger::always(const char *pText) { if (nullptr != Logger::logReceiverAlways) { deliver(EAlways, Logger::logReceiverAlways, pText); } }
 
 // Log a ALWAYS entry with a string
 void Logger::always(const std::string &text) { if (nullptr != Logger::logReceiverAlways) { always(text.c_str()); } }
@@ -183,7 +256,7 @@ void Logger::always(const std::string &text) { if (nullptr != Logger::logReceive
 void Logger::always(const std::ostream &text) { if (nullptr != Logger::logReceiverAlways) { always(static_cast<const std::ostringstream &>(text).str().c_str()); } }
 
 // Log a TRACE entry with a C string
-void Logger::trace(const char *pText) { if (nullptr != Logger::logReceiverTrace) { Logger::logReceiverTrace(pText); } }
+void Logger::trace(const char *pText) { if (nullptr != Logger::logReceiverTrace) { deliver(ETrace, Logger::logReceiverTrace, pText); } }
 
 // Log a TRACE entry with a string
 void Logger::trace(const std::string &text) { if (nullptr != Logger::logReceiverTrace) { trace(text.c_str()); } }
@@ -32,10 +32,63 @@ namespace ggk {
 // Our handy stringstream macro
 #define SSTR std::ostringstream().flush()
 
+// Compile-time minimum log level
+//
+// Log statements below this level are compiled out entirely (including the formatting of their arguments.) The level is normally
+// set through the GGK_LOG_LEVEL CMake option (see options.cmake); by default, everything is compiled in. ALWAYS logs are never
+// compiled out.
+#define GGK_LOG_LEVEL_TRACE  0
+#define GGK_LOG_LEVEL_DEBUG  1
+#define GGK_LOG_LEVEL_INFO   2
+#define GGK_LOG_LEVEL_STATUS 3
+#define GGK_LOG_LEVEL_WARN   4
+#define GGK_LOG_LEVEL_ERROR  5
+#define GGK_LOG_LEVEL_FATAL  6
+
+#ifndef GGK_LOG_LEVEL
+#define GGK_LOG_LEVEL GGK_LOG_LEVEL_TRACE
+#endif
+
+// Lazily evaluated logging macros
+//
+// These check the compile-time level and whether a receiver is registered for the level *before* evaluating their arguments, so
+// a log statement for a level nobody is listening to costs a single pointer comparison (and nothing at all if it's below
+// GGK_LOG_LEVEL.) Prefer these over calling the Logger methods directly:
+//
+//    GGK_LOG_INFO(SSTR << "There were " << count << " entries in the list");
+#define GGK_LOG_AT(level, isEnabled, logMethod, ...) \
+	do { if ((level) >= GGK_LOG_LEVEL && ggk::Logger::isEnabled()) { ggk::Logger::logMethod(__VA_ARGS__); } } while (0)
+
+#define GGK_LOG_TRACE(...)  GGK_LOG_AT(GGK_LOG_LEVEL_TRACE,  traceEnabled,  trace,  __VA_ARGS__)
+#define GGK_LOG_DEBUG(...)  GGK_LOG_AT(GGK_LOG_LEVEL_DEBUG,  debugEnabled,  debug,  __VA_ARGS__)
+#define GGK_LOG_INFO(...)   GGK_LOG_AT(GGK_LOG_LEVEL_INFO,   infoEnabled,   info,   __VA_ARGS__)
+#define GGK_LOG_STATUS(...) GGK_LOG_AT(GGK_LOG_LEVEL_STATUS, statusEnabled, status, __VA_ARGS__)
+#define GGK_LOG_WARN(...)   GGK_LOG_AT(GGK_LOG_LEVEL_WARN,   warnEnabled,   warn,   __VA_ARGS__)
+#define GGK_LOG_ERROR(...)  GGK_LOG_AT(GGK_LOG_LEVEL_ERROR,  errorEnabled,  error,  __VA_ARGS__)
+#define GGK_LOG_FATAL(...)  GGK_LOG_AT(GGK_LOG_LEVEL_FATAL,  fatalEnabled,  fatal,  __VA_ARGS__)
+#define GGK_LOG_ALWAYS(...) GGK_LOG_AT(GGK_LOG_LEVEL_FATAL,  alwaysEnabled, always, __VA_ARGS__)
+
 class Logger
 {
 public:
 
+	//
+	// Types
+	//
+
+	// The logging categories, used to tag messages that are delivered asynchronously (see AsyncLogger.cpp)
+	enum LogLevel
+	{
+		EDebug,
+		EInfo,
+		EStatus,
+		EWarn,
+		EError,
+		EFatal,
+		EAlways,
+		ETrace
+	};
+
 	//
 	// Registration
 	//
@@ -72,6 +125,36 @@ public:
 	// appropriate logging action. To unregister, call with `nullptr`
 	static void registerTraceReceiver(GGKLogReceiver receiver);
 
+	//
+	// Receiver checks (used by the GGK_LOG_* macros to avoid formatting logs that nobody will receive)
+	//
+
+	static bool debugEnabled() { return nullptr != logReceiverDebug; }
+	static bool infoEnabled() { return nullptr != logReceiverInfo; }
+	static bool statusEnabled() { return nullptr != logReceiverStatus; }
+	static bool warnEnabled() { return nullptr != logReceiverWarn; }
+	static bool errorEnabled() { return nullptr != logReceiverError; }
+	static bool fatalEnabled() { return nullptr != logReceiverFatal; }
+	static bool alwaysEnabled() { return nullptr != logReceiverAlways; }
+	static bool traceEnabled() { return nullptr != logReceiverTrace; }
+
+	// Returns the receiver registered for the given level, or nullptr if there is none
+	static GGKLogReceiver getReceiver(LogLevel level);
+
+	//
+	// Asynchronous delivery
+	//
+
+	// Enables or disables asynchronous delivery
+	//
+	// When enabled, log messages are queued and delivered to the receivers by a background thread rather than on the thread that
+	// logged them (see AsyncLogger.cpp.) Disabling delivers any queued messages before returning.
+	//
+	// Returns true if the requested mode is in effect on return
+	static bool setAsync(bool enabled);
+
+	// Returns true if asynchronous delivery is enabled
+	static bool getAsync();
 
 	//
 	// Logging actions
@@ -151,6 +234,9 @@ public:
 
 private:
 
+	// Hands a message to its receiver, either directly or through the asynchronous backend if it is enabled
+	static void deliver(LogLevel level, GGKLogReceiver receiver, const char *pText);
+
 	// The registered log receiver for DEBUG logs - a nullptr will cause the logging for that receiver to be ignored
 	static GGKLogReceiver logReceiverDebug;
 
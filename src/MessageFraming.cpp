@@ -0,0 +1,270 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// MTU-aware fragmentation and reassembly of messages on the msg_service channel
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Each ATT write or indication carries at most MTU-3 bytes (20 bytes until the central negotiates a larger MTU.) Without framing,
+// every write to msg_receive is delivered to the application as a message and every message sent on msg_send must fit in one
+// indication, so larger messages are cut short. With framing enabled, a message is carried as a series of fragments, each with a
+// small header (see `ggkServerSetFraming()` in Gobbledegook.h for the wire format.)
+//
+// Outbound, messages are queued whole in the MessageQueue (spanning several of its 512-byte buffers if needed) and fragmented on
+// the server thread at send time, to the MTU of the connection as it is at that moment: the AcquireNotify socket's MTU if BlueZ
+// has acquired one, otherwise the last MTU reported by the central in a write. Fragments are built straight from the queue's
+// buffers into a buffer on the stack, so sending a message allocates nothing.
+//
+// Inbound, fragments from WriteValue calls or the AcquireWrite socket are appended to a preallocated reassembly buffer large
+// enough for the largest message. The sequence number catches lost or reordered fragments; on any error the partial message is
+// discarded and everything up to the next START fragment is ignored.
+//
+// The counters are updated by the server thread and read by the application from any thread, so they are atomics. Only payload
+// bytes are counted, so `bytesSent / elapsedUS` is the application-level throughput.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <string.h>
+
+#include "MessageFraming.h"
+#include "UpdateQueue.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Our constructor resets the counters
+MessageFraming::MessageFraming()
+: enabled(false), mtu(kDefaultMtu), sendMessageId(0), sendOffset(0), sendSequence(0), pendingPayload(0), pendingLast(false),
+  receiveLength(0), receiveExpected(0), receiveSequence(0), receiving(false), discarding(false)
+{
+	resetStats();
+}
+
+// Records the ATT MTU reported by the central (ignored if it is zero)
+void MessageFraming::setMtu(int newMtu)
+{
+	if (newMtu > 0)
+	{
+		mtu.store(newMtu, std::memory_order_relaxed);
+	}
+}
+
+// Retrieves the counters
+void MessageFraming::getStats(GGKFramingStats &stats) const
+{
+	stats.messagesSent = messagesSent.load(std::memory_order_relaxed);
+	stats.fragmentsSent = fragmentsSent.load(std::memory_order_relaxed);
+	stats.bytesSent = bytesSent.load(std::memory_order_relaxed);
+	stats.messagesReceived = messagesReceived.load(std::memory_order_relaxed);
+	stats.fragmentsReceived = fragmentsReceived.load(std::memory_order_relaxed);
+	stats.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+	stats.reassemblyErrors = reassemblyErrors.load(std::memory_order_relaxed);
+	stats.elapsedUS = static_cast<unsigned long long>(UpdateQueue::nowUS() - statsResetUS.load(std::memory_order_relaxed));
+}
+
+// Resets the counters
+void MessageFraming::resetStats()
+{
+	messagesSent.store(0, std::memory_order_relaxed);
+	fragmentsSent.store(0, std::memory_order_relaxed);
+	bytesSent.store(0, std::memory_order_relaxed);
+	messagesReceived.store(0, std::memory_order_relaxed);
+	fragmentsReceived.store(0, std::memory_order_relaxed);
+	bytesReceived.store(0, std::memory_order_relaxed);
+	reassemblyErrors.store(0, std::memory_order_relaxed);
+	statsResetUS.store(UpdateQueue::nowUS(), std::memory_order_relaxed);
+}
+
+// Builds the next fragment of the message at the front of `queue`, sized to fit `attMtu`
+//
+// Returns the length of the fragment written to `pFragment` (which must hold kMaxFragmentSize bytes), or -1 if the queue is
+// empty or the part of the message needed for this fragment has not been published yet. `isLast` is set if this fragment
+// completes the message, in which case the caller should pop the message once the fragment is sent.
+int MessageFraming::nextFragment(const MessageQueue &queue, int attMtu, uint8_t *pFragment, bool &isLast)
+{
+	const MessageQueue::Message *pFront = queue.front();
+	if (nullptr == pFront)
+	{
+		return -1;
+	}
+
+	// A new message starts from the beginning (even if the last one was abandoned part-way through)
+	if (pFront->messageId != sendMessageId)
+	{
+		sendMessageId = pFront->messageId;
+		sendOffset = 0;
+		sendSequence = 0;
+	}
+
+	if (attMtu < kDefaultMtu) { attMtu = kDefaultMtu; }
+	int fragmentSize = attMtu - kAttHeaderSize;
+	if (fragmentSize > kMaxFragmentSize) { fragmentSize = kMaxFragmentSize; }
+
+	// Write the header
+	bool isFirst = sendOffset == 0;
+	int headerSize = isFirst ? kStartHeaderSize : kHeaderSize;
+	int remaining = pFront->totalLength - sendOffset;
+	int payload = remaining < fragmentSize - headerSize ? remaining : fragmentSize - headerSize;
+	isLast = payload == remaining;
+
+	pFragment[0] = (isFirst ? kStartFlag : 0) | (isLast ? kEndFlag : 0) | (sendSequence & kSequenceMask);
+	if (isFirst)
+	{
+		pFragment[1] = static_cast<uint8_t>(pFront->totalLength & 0xff);
+		pFragment[2] = static_cast<uint8_t>((pFront->totalLength >> 8) & 0xff);
+	}
+
+	// Copy the payload from however many of the queue's buffers it spans
+	int copied = 0;
+	while (copied < payload)
+	{
+		int offset = sendOffset + copied;
+		const MessageQueue::Message *pChunk = queue.peek(static_cast<size_t>(offset / MessageQueue::kMaxMessageSize));
+		if (nullptr == pChunk)
+		{
+			return -1;
+		}
+
+		int chunkOffset = offset % MessageQueue::kMaxMessageSize;
+		int count = pChunk->length - chunkOffset;
+		if (count > payload - copied) { count = payload - copied; }
+
+		memcpy(pFragment + headerSize + copied, pChunk->data + chunkOffset, count);
+		copied += count;
+	}
+
+	pendingPayload = payload;
+	pendingLast = isLast;
+	return headerSize + payload;
+}
+
+// Records whether the fragment built by the last call to `nextFragment()` was sent
+//
+// If it wasn't, the rest of the message is abandoned and the caller should pop it as failed.
+void MessageFraming::fragmentSent(bool sent)
+{
+	if (!sent)
+	{
+		sendMessageId = 0;
+		return;
+	}
+
+	fragmentsSent.fetch_add(1, std::memory_order_relaxed);
+	bytesSent.fetch_add(pendingPayload, std::memory_order_relaxed);
+
+	if (pendingLast)
+	{
+		messagesSent.fetch_add(1, std::memory_order_relaxed);
+		sendMessageId = 0;
+		return;
+	}
+
+	sendOffset += pendingPayload;
+	sendSequence = (sendSequence + 1) & kSequenceMask;
+}
+
+// Abandons any partially reassembled message, counting an error
+void MessageFraming::reassemblyError(const char *pReason)
+{
+	GGK_LOG_DEBUG(SSTR << "Discarding framed message: " << pReason);
+
+	reassemblyErrors.fetch_add(1, std::memory_order_relaxed);
+	receiving = false;
+	discarding = true;
+}
+
+// Adds a received fragment to the message being reassembled
+//
+// Returns a pointer to the complete message (and sets `messageLength`) once the last fragment arrives, or nullptr otherwise.
+// The returned message remains valid until the next call. A fragment that doesn't follow on from the previous one is counted
+// as an error and the partial message is discarded; the next START fragment begins a new message.
+const uint8_t *MessageFraming::receiveFragment(const uint8_t *pFragment, int length, int &messageLength)
+{
+	if (length < kHeaderSize)
+	{
+		reassemblyError("empty fragment");
+		return nullptr;
+	}
+
+	fragmentsReceived.fetch_add(1, std::memory_order_relaxed);
+
+	uint8_t header = pFragment[0];
+	uint8_t sequence = header & kSequenceMask;
+	int headerSize = kHeaderSize;
+
+	if (0 != (header & kStartFlag))
+	{
+		if (receiving)
+		{
+			reassemblyError("new message started before the previous one ended");
+		}
+
+		if (length < kStartHeaderSize || 0 != sequence)
+		{
+			reassemblyError("malformed START fragment");
+			return nullptr;
+		}
+
+		receiveExpected = pFragment[1] | (pFragment[2] << 8);
+		receiveLength = 0;
+		receiveSequence = 0;
+		receiving = true;
+		discarding = false;
+		headerSize = kStartHeaderSize;
+	}
+	else if (!receiving)
+	{
+		// Only the first stray fragment counts as an error; the rest of a broken message is expected to follow it
+		if (!discarding)
+		{
+			reassemblyError("fragment without a START");
+		}
+		return nullptr;
+	}
+	else if (sequence != receiveSequence)
+	{
+		reassemblyError("fragment out of sequence");
+		return nullptr;
+	}
+
+	int payload = length - headerSize;
+	if (receiveLength + payload > receiveExpected)
+	{
+		reassemblyError("message longer than its stated length");
+		return nullptr;
+	}
+
+	memcpy(receiveBuffer + receiveLength, pFragment + headerSize, payload);
+	receiveLength += payload;
+	receiveSequence = (receiveSequence + 1) & kSequenceMask;
+	bytesReceived.fetch_add(payload, std::memory_order_relaxed);
+
+	if (0 == (header & kEndFlag))
+	{
+		return nullptr;
+	}
+
+	if (receiveLength != receiveExpected)
+	{
+		reassemblyError("message shorter than its stated length");
+		return nullptr;
+	}
+
+	receiving = false;
+	messagesReceived.fetch_add(1, std::memory_order_relaxed);
+	messageLength = receiveLength;
+	return receiveBuffer;
+}
+
+}; // namespace ggk
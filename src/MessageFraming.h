@@ -0,0 +1,158 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// MTU-aware fragmentation and reassembly of messages on the msg_service channel
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of MessageFraming.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "../include/Gobbledegook.h"
+#include "MessageQueue.h"
+
+namespace ggk {
+
+struct MessageFraming
+{
+	//
+	// Constants
+	//
+
+	// Fragment header bits
+	static const uint8_t kStartFlag = 0x80;
+	static const uint8_t kEndFlag = 0x40;
+	static const uint8_t kSequenceMask = 0x3f;
+
+	// The size of a fragment's header, and of a START fragment's header plus the message length that follows it
+	static const int kHeaderSize = 1;
+	static const int kStartHeaderSize = 3;
+
+	// The largest message that can be framed (the length field is 16 bits)
+	static const int kMaxMessageSize = 65535;
+
+	// The ATT MTU assumed until we learn the connection's actual MTU, and the ATT header that each value shares the MTU with
+	static const int kDefaultMtu = 23;
+	static const int kAttHeaderSize = 3;
+
+	// The largest fragment we build (the largest value an ATT attribute can hold)
+	static const int kMaxFragmentSize = 512;
+
+	//
+	// Accessors
+	//
+
+	// Returns the instance to this singleton class
+	static MessageFraming &getInstance()
+	{
+		static MessageFraming instance;
+		return instance;
+	}
+
+	// Returns true if framing is enabled
+	bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	// Enables or disables framing
+	//
+	// Both ends must agree, so this should be set before the central connects. A message that is part-way through being sent
+	// or received when framing is switched off is not completed.
+	void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+
+	// Returns the most recent ATT MTU reported by the central (or kDefaultMtu if it hasn't reported one)
+	int getMtu() const { return mtu.load(std::memory_order_relaxed); }
+
+	// Records the ATT MTU reported by the central (ignored if it is zero)
+	void setMtu(int newMtu);
+
+	// Retrieves the counters
+	void getStats(GGKFramingStats &stats) const;
+
+	// Resets the counters
+	void resetStats();
+
+	//
+	// Outbound (server thread only)
+	//
+
+	// Builds the next fragment of the message at the front of `queue`, sized to fit `attMtu`
+	//
+	// Returns the length of the fragment written to `pFragment` (which must hold kMaxFragmentSize bytes), or -1 if the queue is
+	// empty or the part of the message needed for this fragment has not been published yet. `isLast` is set if this fragment
+	// completes the message, in which case the caller should pop the message once the fragment is sent.
+	int nextFragment(const MessageQueue &queue, int attMtu, uint8_t *pFragment, bool &isLast);
+
+	// Records whether the fragment built by the last call to `nextFragment()` was sent
+	//
+	// If it wasn't, the rest of the message is abandoned and the caller should pop it as failed.
+	void fragmentSent(bool sent);
+
+	//
+	// Inbound (server thread only)
+	//
+
+	// Adds a received fragment to the message being reassembled
+	//
+	// Returns a pointer to the complete message (and sets `messageLength`) once the last fragment arrives, or nullptr otherwise.
+	// The returned message remains valid until the next call. A fragment that doesn't follow on from the previous one is counted
+	// as an error and the partial message is discarded; the next START fragment begins a new message.
+	const uint8_t *receiveFragment(const uint8_t *pFragment, int length, int &messageLength);
+
+private:
+
+	// Our constructor resets the counters
+	MessageFraming();
+
+	// Abandons any partially reassembled message, counting an error
+	void reassemblyError(const char *pReason);
+
+	// Configuration
+	std::atomic<bool> enabled;
+	std::atomic<int> mtu;
+
+	// Outbound state: the message being sent, how much of it has been sent, the sequence number of the next fragment and the
+	// fragment awaiting `fragmentSent()`
+	int sendMessageId;
+	int sendOffset;
+	uint8_t sendSequence;
+	int pendingPayload;
+	bool pendingLast;
+
+	// Inbound state: the message being reassembled, its expected length and the sequence number of the next fragment
+	uint8_t receiveBuffer[kMaxMessageSize];
+	int receiveLength;
+	int receiveExpected;
+	uint8_t receiveSequence;
+	bool receiving;
+
+	// True after an error until the next START fragment (so that the rest of a broken message isn't counted as more errors)
+	bool discarding;
+
+	// Counters (written by the server thread, read by the application)
+	std::atomic<uint64_t> messagesSent;
+	std::atomic<uint64_t> fragmentsSent;
+	std::atomic<uint64_t> bytesSent;
+	std::atomic<uint64_t> messagesReceived;
+	std::atomic<uint64_t> fragmentsReceived;
+	std::atomic<uint64_t> bytesReceived;
+	std::atomic<uint64_t> reassemblyErrors;
+	std::atomic<int64_t> statsResetUS;
+};
+
+}; // namespace ggk
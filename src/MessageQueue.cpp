@@ -0,0 +1,248 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A bounded, lock-free queue of outbound messages with pooled buffers
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Applications send messages (see `ggkServerSendMessage()`) from their own threads, but the messages must be sent from the
+// server's thread. This queue carries them across, in order.
+//
+// Like the UpdateQueue, this is a fixed-size ring of slots tagged with sequence numbers; producers claim slots with a
+// compare-and-swap and the consumer releases them. Here, each slot also owns a message buffer, so the ring doubles as the buffer
+// pool: queueing a message is a single copy into a buffer that already exists, and nothing is allocated after construction.
+//
+// A message longer than one buffer is stored in consecutive buffers. The producer reserves all of them with a single
+// compare-and-swap, which works because the consumer frees slots strictly in order: if the last slot of the run is free, every
+// slot before it is too.
+//
+// The ring always holds `kCapacity` buffers, but the application may limit how many buffers may wait at once (`maxDepth`.) A
+// message that would exceed the limit is rejected (the send fails immediately) rather than silently replacing an earlier message.
+//
+// Each queued message gets an ID, which is returned to the application. Once the server thread has dealt with the message, the
+// ID is reported to the application's completion callback along with the outcome: sent (handed to BlueZ), failed or cancelled
+// (discarded without being sent, for example because the server is shutting down.)
+//
+// The consumer looks at the front message without removing it (`front()`) and only removes it (`pop()`) once it has been dealt
+// with. This lets the sender leave a message in place if it can't be sent right now.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <string.h>
+
+#include "MessageQueue.h"
+#include "UpdateQueue.h"
+
+namespace ggk {
+
+// Our constructor initializes the sequence numbers for each slot in the ring
+MessageQueue::MessageQueue()
+: enqueuePos(0), dequeuePos(0), maxDepth(kDefaultMaxDepth), completionCallback(nullptr), nextMessageId(1)
+{
+	for (size_t i = 0; i < kCapacity; ++i)
+	{
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+// Sets the maximum number of buffers that may wait to be sent (clamped to [1, kCapacity])
+void MessageQueue::setMaxDepth(int depth)
+{
+	if (depth < 1) { depth = 1; }
+	if (depth > static_cast<int>(kCapacity)) { depth = static_cast<int>(kCapacity); }
+	maxDepth.store(depth, std::memory_order_relaxed);
+}
+
+// Copies a message into pooled buffers and adds it to the end of the queue
+//
+// Messages longer than kMaxMessageSize are split into chunks in consecutive buffers; the buffers are reserved together, so a
+// message is queued whole or not at all and is never interleaved with another.
+//
+// This method is safe to call from any number of threads concurrently. Returns the message's ID (always positive), or 0 if the
+// message would not fit within the queue's maximum depth.
+int MessageQueue::push(const void *pData, int length)
+{
+	if (length < 0)
+	{
+		return 0;
+	}
+
+	size_t chunkCount = length == 0 ? 1 : (static_cast<size_t>(length) + kMaxMessageSize - 1) / kMaxMessageSize;
+	if (chunkCount > static_cast<size_t>(getMaxDepth()))
+	{
+		return 0;
+	}
+
+	size_t pos = enqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		// Enforce the configured depth (the ring's capacity is enforced by the sequence check below.) Our `pos` may be stale and
+		// behind the consumer, in which case the sequence check sends us around again with a fresh one.
+		size_t dequeue = dequeuePos.load(std::memory_order_acquire);
+		if (pos >= dequeue && pos - dequeue + chunkCount > static_cast<size_t>(getMaxDepth()))
+		{
+			return 0;
+		}
+
+		// If the last slot we need is free, so are the ones before it
+		size_t lastPos = pos + chunkCount - 1;
+		size_t seq = slots[lastPos & kMask].sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(lastPos);
+
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + chunkCount, std::memory_order_relaxed))
+			{
+				// IDs are positive and wrap back to 1
+				int messageId = nextMessageId.fetch_add(1, std::memory_order_relaxed) & 0x7fffffff;
+				if (0 == messageId) { messageId = nextMessageId.fetch_add(1, std::memory_order_relaxed) & 0x7fffffff; }
+
+				int64_t queueTimeUS = UpdateQueue::nowUS();
+				const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+
+				// Fill and publish each chunk in order
+				for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+				{
+					Slot &slot = slots[(pos + chunk) & kMask];
+					int offset = static_cast<int>(chunk) * kMaxMessageSize;
+					int chunkLength = length - offset < kMaxMessageSize ? length - offset : kMaxMessageSize;
+
+					slot.message.messageId = messageId;
+					slot.message.queueTimeUS = queueTimeUS;
+					slot.message.chunkIndex = static_cast<int>(chunk);
+					slot.message.chunkCount = static_cast<int>(chunkCount);
+					slot.message.totalLength = length;
+					slot.message.length = chunkLength;
+					if (chunkLength > 0)
+					{
+						memcpy(slot.message.data, pBytes + offset, chunkLength);
+					}
+
+					slot.sequence.store(pos + chunk + 1, std::memory_order_release);
+				}
+
+				return messageId;
+			}
+		}
+		else if (diff < 0)
+		{
+			// The slot still holds a message from the previous lap - we're full
+			return 0;
+		}
+		else
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+// Returns the message (or first chunk of the message) at the front of the queue without removing it, or nullptr if the queue is
+// empty or the message at the front hasn't been completely queued yet
+//
+// The message remains valid until `pop()` is called.
+const MessageQueue::Message *MessageQueue::front() const
+{
+	const Message *pFirst = peek(0);
+	if (nullptr == pFirst || !isPublished(static_cast<size_t>(pFirst->chunkCount)))
+	{
+		return nullptr;
+	}
+
+	return pFirst;
+}
+
+// Returns the buffer `offset` places from the front of the queue without removing it, or nullptr if it does not hold a message
+// (yet)
+//
+// Use this to walk the chunks of the message at the front: chunk `n` is at `peek(n)`. Once `front()` has returned a message, all
+// of its chunks are visible.
+const MessageQueue::Message *MessageQueue::peek(size_t offset) const
+{
+	if (offset >= kCapacity)
+	{
+		return nullptr;
+	}
+
+	size_t pos = dequeuePos.load(std::memory_order_relaxed) + offset;
+	const Slot &slot = slots[pos & kMask];
+	if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+	{
+		return nullptr;
+	}
+
+	return &slot.message;
+}
+
+// Returns true if the first `chunkCount` buffers at the front of the queue have all been published by their producer
+//
+// Producers publish the chunks of a message in order, so it's enough to check the last one.
+bool MessageQueue::isPublished(size_t chunkCount) const
+{
+	return chunkCount > 0 && nullptr != peek(chunkCount - 1);
+}
+
+// Removes the message at the front of the queue (all of its chunks), reporting its completion status
+//
+// Returns false (and removes nothing) if there is no message at the front that has been completely queued. A producer may still
+// be copying the later chunks of a message it has reserved; rather than wait for it on the server thread, we leave the message
+// in place. The producer signals an update once it's done, and that will try again.
+bool MessageQueue::pop(GGKMessageStatus status)
+{
+	const Message *pFirst = front();
+	if (nullptr == pFirst)
+	{
+		return false;
+	}
+
+	int messageId = pFirst->messageId;
+	size_t chunkCount = static_cast<size_t>(pFirst->chunkCount);
+
+	size_t pos = dequeuePos.load(std::memory_order_relaxed);
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		dequeuePos.store(pos + chunk + 1, std::memory_order_release);
+		slots[(pos + chunk) & kMask].sequence.store(pos + chunk + kCapacity, std::memory_order_release);
+	}
+
+	complete(messageId, status);
+	return true;
+}
+
+// Removes all messages from the queue, reporting each with the given completion status
+//
+// A message that is still being queued when we reach it is left in place.
+void MessageQueue::clear(GGKMessageStatus status)
+{
+	while (pop(status)) {}
+}
+
+// Returns the (approximate) number of buffers waiting in the queue
+size_t MessageQueue::size() const
+{
+	size_t enqueue = enqueuePos.load(std::memory_order_acquire);
+	size_t dequeue = dequeuePos.load(std::memory_order_acquire);
+	return enqueue > dequeue ? enqueue - dequeue : 0;
+}
+
+// Reports a message's completion status to the application's callback, if one is registered
+void MessageQueue::complete(int messageId, GGKMessageStatus status) const
+{
+	GGKMessageSendComplete callback = completionCallback.load(std::memory_order_acquire);
+	if (nullptr != callback)
+	{
+		callback(messageId, status);
+	}
+}
+
+}; // namespace ggk
@@ -0,0 +1,189 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A bounded, lock-free queue of outbound messages with pooled buffers
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of MessageQueue.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "../include/Gobbledegook.h"
+
+namespace ggk {
+
+struct MessageQueue
+{
+	//
+	// Constants
+	//
+
+	// The number of message buffers in the pool, which is also the largest configurable queue depth
+	//
+	// This must be a power of two
+	static const size_t kCapacity = 256;
+
+	// The default maximum number of buffers waiting to be sent
+	//
+	// This is enough to hold a framed message of the largest size (65535 bytes, see MessageFraming::kMaxMessageSize.)
+	static const int kDefaultMaxDepth = 128;
+
+	// The size of each pooled buffer (the largest value an ATT attribute can hold)
+	//
+	// Larger messages are stored in consecutive buffers (see `push()`.)
+	static const int kMaxMessageSize = 512;
+
+	//
+	// Types
+	//
+
+	// A queued message, or one chunk of a message that spans several buffers
+	struct Message
+	{
+		// The ID returned to the application when the message was queued
+		int messageId;
+
+		// Monotonic time (in microseconds) at which the message was queued
+		int64_t queueTimeUS;
+
+		// This chunk's position within the message and the number of chunks (buffers) the message occupies
+		int chunkIndex;
+		int chunkCount;
+
+		// The length of the whole message
+		int totalLength;
+
+		// The length of this chunk
+		int length;
+		uint8_t data[kMaxMessageSize];
+	};
+
+	// A single slot within the ring
+	//
+	// The sequence number tells producers and the consumer whether the slot is free to write (sequence == position) or holds a
+	// message ready to be sent (sequence == position + 1). The message itself is only touched by whoever currently owns the slot,
+	// as decided by the sequence number.
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		Message message;
+	};
+
+	//
+	// Accessors
+	//
+
+	// Returns the instance to this singleton class
+	static MessageQueue &getInstance()
+	{
+		static MessageQueue instance;
+		return instance;
+	}
+
+	// Returns the maximum number of buffers that may wait to be sent
+	int getMaxDepth() const { return maxDepth.load(std::memory_order_relaxed); }
+
+	// Returns the largest message that can be queued at the current maximum depth
+	int getMaxMessageLength() const { return getMaxDepth() * kMaxMessageSize; }
+
+	// Sets the maximum number of buffers that may wait to be sent (clamped to [1, kCapacity])
+	void setMaxDepth(int depth);
+
+	// Registers the callback used to report each message's completion status (nullptr to unregister)
+	void setCompletionCallback(GGKMessageSendComplete callback) { completionCallback.store(callback, std::memory_order_release); }
+
+	//
+	// Producer
+	//
+
+	// Copies a message into pooled buffers and adds it to the end of the queue
+	//
+	// Messages longer than kMaxMessageSize are split into chunks in consecutive buffers; the buffers are reserved together, so a
+	// message is queued whole or not at all and is never interleaved with another.
+	//
+	// This method is safe to call from any number of threads concurrently. Returns the message's ID (always positive), or 0 if the
+	// message would not fit within the queue's maximum depth.
+	int push(const void *pData, int length);
+
+	//
+	// Consumer (server thread only)
+	//
+
+	// Returns the message (or first chunk of the message) at the front of the queue without removing it, or nullptr if the queue
+	// is empty or the message at the front hasn't been completely queued yet
+	//
+	// The message remains valid until `pop()` is called.
+	const Message *front() const;
+
+	// Returns the buffer `offset` places from the front of the queue without removing it, or nullptr if it does not hold a message
+	// (yet)
+	//
+	// Use this to walk the chunks of the message at the front: chunk `n` is at `peek(n)`. Once `front()` has returned a message,
+	// all of its chunks are visible.
+	const Message *peek(size_t offset) const;
+
+	// Removes the message at the front of the queue (all of its chunks), reporting its completion status
+	//
+	// Returns false (and removes nothing) if there is no message at the front that has been completely queued.
+	bool pop(GGKMessageStatus status);
+
+	// Removes all messages from the queue, reporting each with the given completion status
+	//
+	// A message that is still being queued when we reach it is left in place.
+	void clear(GGKMessageStatus status);
+
+	// Returns the (approximate) number of buffers waiting in the queue
+	size_t size() const;
+
+	// Returns true if the queue is empty
+	bool empty() const { return size() == 0; }
+
+	// Reports a message's completion status to the application's callback, if one is registered
+	void complete(int messageId, GGKMessageStatus status) const;
+
+private:
+
+	// Our constructor initializes the sequence numbers for each slot in the ring
+	MessageQueue();
+
+	static const size_t kMask = kCapacity - 1;
+
+	// Returns true if the first `chunkCount` buffers at the front of the queue have all been published by their producer
+	bool isPublished(size_t chunkCount) const;
+
+	// Our ring of slots (and their message buffers)
+	Slot slots[kCapacity];
+
+	// The next position to write (shared by all producers)
+	alignas(64) std::atomic<size_t> enqueuePos;
+
+	// The next position to read
+	alignas(64) std::atomic<size_t> dequeuePos;
+
+	// Configuration
+	std::atomic<int> maxDepth;
+	std::atomic<GGKMessageSendComplete> completionCallback;
+
+	// The ID of the next message
+	std::atomic<int> nextMessageId;
+};
+
+}; // namespace ggk
@@ -35,10 +35,16 @@ namespace ggk {
 //
 // Set `controllerIndex` to the zero-based index of the device as recognized by the OS. If this parameter is omitted, the index
 // of the first device (0) will be used.
-Mgmt::Mgmt(uint16_t controllerIndex)
-: controllerIndex(controllerIndex)
+//
+// Unless `syncAdapter` is false, this reads the controller's information into the HciAdapter, which takes two round trips to the
+// kernel. Long-lived instances that only send commands can skip it.
+Mgmt::Mgmt(uint16_t controllerIndex, bool syncAdapter)
+: controllerIndex(controllerIndex), batching(false), retryable(true)
 {
-	HciAdapter::getInstance().sync(controllerIndex);
+	if (syncAdapter)
+	{
+		HciAdapter::getInstance().sync(controllerIndex);
+	}
 }
 
 // Set the adapter name and short name
@@ -71,75 +77,99 @@ bool Mgmt::setName(std::string name, std::string shortName)
 	memset(request.shortName, 0, sizeof(request.shortName));
 	snprintf(request.shortName, sizeof(request.shortName), "%s", shortName.c_str());
 
-	if (!HciAdapter::getInstance().sendCommand(request))
+	return sendCommand(request, "  + Failed to set name");
+}
+
+// Sets the advertising and scan response data of advertising instance 1
+//
+// See `addAdvertising()`. Returns true on success, otherwise false
+bool Mgmt::setRawAdvertisingData(const RawAdvertisingData &data)
+{
+	return addAdvertising(1, 0, 0, 0, data.advData, data.advDataLen, data.rspData, data.rspDataLen);
+}
+
+// Adds advertising instance `instance` (1 or more), or updates it in place if it already exists
+//
+// `flags` are the Add Advertising flags (bit 0 = connectable, bit 1 = discoverable, etc.) With several instances, the kernel
+// rotates through them, advertising each for `durationS` seconds (0 for its default.) A non-zero `timeoutS` removes the instance
+// after that many seconds. The adapter doesn't need to be powered off, so existing connections are unaffected.
+//
+// Returns true on success, otherwise false
+bool Mgmt::addAdvertising(uint8_t instance, uint32_t flags, uint16_t durationS, uint16_t timeoutS, const uint8_t *pAdvData, uint8_t advDataLength, const uint8_t *pScanResponse, uint8_t scanResponseLength)
+{
+	if (advDataLength > kMaxAdvertisingDataLength || scanResponseLength > kMaxAdvertisingDataLength)
 	{
-		Logger::warn(SSTR << "  + Failed to set name");
+		GGK_LOG_WARN(SSTR << "  + Advertising data for instance " << static_cast<int>(instance) << " is too long");
 		return false;
 	}
 
-	return true;
+	struct SRequest : HciAdapter::HciHeader
+	{
+		uint8_t instance;
+		uint32_t flags;
+		uint16_t duration;
+		uint16_t timeout;
+		uint8_t advDataLength;
+		uint8_t scanResponseLength;
+		uint8_t data[kMaxAdvertisingDataLength * 2];
+	} __attribute__((packed));
+
+	SRequest request;
+	request.code = Mgmt::EAddAdvertisingCommand;
+	request.controllerId = controllerIndex;
+	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader) - sizeof(request.data) + advDataLength + scanResponseLength;
+	request.instance = instance;
+
+	/**
+		0	Switch into Connectable mode
+		1	Advertise as Discoverable
+		2	Advertise as Limited Discoverable
+		3	Add Flags field to Adv_Data
+		4	Add TX Power field to Adv_Data
+		5	Add Appearance field to Scan_Rsp
+		6	Add Local Name in Scan_Rsp
+		7	Secondary Channel with LE 1M
+		8	Secondary Channel with LE 2M
+		9	Secondary Channel with LE Coded
+	**/
+	request.flags = Utils::endianToHci(flags);
+	request.duration = Utils::endianToHci(durationS);
+	request.timeout = Utils::endianToHci(timeoutS);
+	request.advDataLength = advDataLength;
+	request.scanResponseLength = scanResponseLength;
+
+	if (advDataLength > 0)
+	{
+		memcpy(request.data, pAdvData, advDataLength);
+	}
+
+	if (scanResponseLength > 0)
+	{
+		memcpy(request.data + advDataLength, pScanResponse, scanResponseLength);
+	}
+
+	return sendCommand(request, std::string("  + Failed to add advertising instance ") + std::to_string(instance));
 }
 
-bool Mgmt::setRawAdvertisingData( const RawAdvertisingData &adv )
+// Removes advertising instance `instance`, or every instance if `instance` is 0
+//
+// Returns true on success, otherwise false
+bool Mgmt::removeAdvertising(uint8_t instance)
 {
-    setPowered(0);
-    usleep(200*1000);
-
-    size_t cp_len;
-    struct SRequest : HciAdapter::HciHeader
-    {
-        uint8_t Instance;
-        uint32_t Flags;
-        uint16_t Duration;
-        uint16_t Timeout;
-        uint8_t Adv_Data_Len;
-        uint8_t Scan_Rsp_Len;
-        uint8_t data[0];
-    } __attribute__((packed));
-
-    SRequest *request;
-    cp_len = sizeof(*request) + adv.advDataLen + adv.rspDataLen ;
-    uint8_t buf[cp_len];
-    request = (SRequest *)(buf);
-
-    request->code = Mgmt::EAddAdvertisingCommand;
-    request->controllerId = controllerIndex;
-    request->dataSize = cp_len - sizeof(HciAdapter::HciHeader);
-    request->Instance = 1;
-
-    request->Flags = 0b0000000000000000;
-
-    request->Timeout = 0;
-    request->Duration = 0 ;
-    request->Adv_Data_Len = adv.advDataLen;
-    request->Scan_Rsp_Len = adv.rspDataLen;
-
-    if (adv.advDataLen>0)
-        memcpy(request->data, adv.advData, adv.advDataLen);
-
-    /**
-        0	Switch into Connectable mode
-        1	Advertise as Discoverable
-        2	Advertise as Limited Discoverable
-        3	Add Flags field to Adv_Data
-        4	Add TX Power field to Adv_Data
-        5	Add Appearance field to Scan_Rsp
-        6	Add Local Name in Scan_Rsp
-        7	Secondary Channel with LE 1M
-        8	Secondary Channel with LE 2M
-        9	Secondary Channel with LE Coded
-    **/
-    if (adv.rspDataLen>0)
-        memcpy(request->data + adv.advDataLen, adv.rspData, adv.rspDataLen);
-
-    if (!HciAdapter::getInstance().sendCommand(*request))
-    {
-        Logger::warn(SSTR << "  + Failed to set discoverable");
-        return false;
-    }
-
-    return true;
+	struct SRequest : HciAdapter::HciHeader
+	{
+		uint8_t instance;
+	} __attribute__((packed));
+
+	SRequest request;
+	request.code = Mgmt::ERemoveAdvertisingCommand;
+	request.controllerId = controllerIndex;
+	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
+	request.instance = instance;
+
+	return sendCommand(request, std::string("  + Failed to remove advertising instance ") + std::to_string(instance));
 }
+
 // Sets discoverable mode
 // 0x00 disables discoverable
 // 0x01 enables general discoverable
@@ -160,13 +190,7 @@ bool Mgmt::setDiscoverable(uint8_t disc, uint16_t timeout)
 	request.disc = disc;
 	request.timeout = timeout;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
-	{
-		Logger::warn(SSTR << "  + Failed to set discoverable");
-		return false;
-	}
-
-	return true;
+	return sendCommand(request, "  + Failed to set discoverable");
 }
 
 // Set a setting state to 'newState'
@@ -187,13 +211,7 @@ bool Mgmt::setState(uint16_t commandCode, uint16_t controllerId, uint8_t newStat
 	request.dataSize = sizeof(SRequest) - sizeof(HciAdapter::HciHeader);
 	request.state = newState;
 
-	if (!HciAdapter::getInstance().sendCommand(request))
-	{
-		Logger::warn(SSTR << "  + Failed to set " << HciAdapter::kCommandCodeNames[commandCode] << " state to: " << static_cast<int>(newState));
-		return false;
-	}
-
-	return true;
+	return sendCommand(request, std::string("  + Failed to set ") + HciAdapter::kCommandCodeNames[commandCode] + " state to: " + std::to_string(newState));
 }
 
 // Set the powered state to `newState` (true = powered on, false = powered off)
@@ -253,6 +271,70 @@ bool Mgmt::setAdvertising(uint8_t newState)
 	return setState(Mgmt::ESetAdvertisingCommand, controllerIndex, newState);
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Batching
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+// Starts a batch of commands
+//
+// Until `finishBatch()` is called, commands are sent without waiting for their responses so that the adapter can process them
+// back-to-back. The adapter still processes them in the order they were sent. While batching, the methods above return true
+// once their command is sent; failures are reported by `finishBatch()`.
+void Mgmt::beginBatch()
+{
+	batching = true;
+}
+
+// Waits for the responses to every command sent since `beginBatch()` and ends the batch
+//
+// Returns true if every command succeeded, otherwise false
+bool Mgmt::finishBatch()
+{
+	bool success = true;
+	bool anyRetryable = false;
+	for (BatchedCommand &command : batch)
+	{
+		HciAdapter::CommandResult result = HciAdapter::getInstance().waitForCommand(command.ticket);
+		if (!result.succeeded())
+		{
+			GGK_LOG_WARN(SSTR << command.failureText << ": " << result.statusText());
+			anyRetryable = anyRetryable || !result.failedPermanently();
+			success = false;
+		}
+	}
+
+	batch.clear();
+	batching = false;
+	retryable = success || anyRetryable;
+	return success;
+}
+
+// Sends a command, logging `failureText` (along with the reason) if it fails
+//
+// Outside of a batch this waits for the response and returns true on success, otherwise false. Within a batch, it returns
+// once the command is sent (see `beginBatch()`.)
+bool Mgmt::sendCommand(HciAdapter::HciHeader &request, const std::string &failureText)
+{
+	if (batching)
+	{
+		BatchedCommand command;
+		command.ticket = HciAdapter::getInstance().submitCommand(request);
+		command.failureText = failureText;
+		batch.push_back(std::move(command));
+		return true;
+	}
+
+	HciAdapter::CommandResult result = HciAdapter::getInstance().sendCommand(request);
+	if (!result.succeeded())
+	{
+		GGK_LOG_WARN(SSTR << failureText << ": " << result.statusText());
+		retryable = !result.failedPermanently();
+		return false;
+	}
+
+	return true;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------
 // Utilitarian
 // ---------------------------------------------------------------------------------------------------------------------------------
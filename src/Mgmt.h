@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "HciAdapter.h"
 #include "Utils.h"
@@ -45,6 +46,13 @@ struct Mgmt
 	// The length of the controller's short name (not including null terminator)
 	static const int kMaxAdvertisingShortNameLength = 10;
 
+	// The most advertising (or scan response) data an advertising instance can carry. Controllers without extended advertising
+	// accept only 31 bytes; the kernel rejects anything longer than the controller supports.
+	static const int kMaxAdvertisingDataLength = 251;
+
+	// Default controller index
+	static const uint16_t kDefaultControllerIndex = 0;
+
 	//
 	// Types
 	//
@@ -169,7 +177,10 @@ struct Mgmt
 	//
 	// Set `controllerIndex` to the zero-based index of the device as recognized by the OS. If this parameter is omitted, the index
 	// of the first device (0) will be used.
-	Mgmt(uint16_t controllerIndex = kDefaultControllerIndex);
+	//
+	// Unless `syncAdapter` is false, this reads the controller's information into the HciAdapter, which takes two round trips to
+	// the kernel. Long-lived instances that only send commands can skip it.
+	Mgmt(uint16_t controllerIndex = kDefaultControllerIndex, bool syncAdapter = true);
 
 	// Set the adapter name and short name
 	//
@@ -180,7 +191,24 @@ struct Mgmt
 	// Returns true on success, otherwise false
 	bool setName(std::string name, std::string shortName);
 
-    bool setRawAdvertisingData( const RawAdvertisingData &data );
+	// Sets the advertising and scan response data of advertising instance 1
+	//
+	// See `addAdvertising()`. Returns true on success, otherwise false
+	bool setRawAdvertisingData(const RawAdvertisingData &data);
+
+	// Adds advertising instance `instance` (1 or more), or updates it in place if it already exists
+	//
+	// `flags` are the Add Advertising flags (bit 0 = connectable, bit 1 = discoverable, etc.) With several instances, the kernel
+	// rotates through them, advertising each for `durationS` seconds (0 for its default.) A non-zero `timeoutS` removes the instance
+	// after that many seconds. The adapter doesn't need to be powered off, so existing connections are unaffected.
+	//
+	// Returns true on success, otherwise false
+	bool addAdvertising(uint8_t instance, uint32_t flags, uint16_t durationS, uint16_t timeoutS, const uint8_t *pAdvData, uint8_t advDataLength, const uint8_t *pScanResponse, uint8_t scanResponseLength);
+
+	// Removes advertising instance `instance`, or every instance if `instance` is 0
+	//
+	// Returns true on success, otherwise false
+	bool removeAdvertising(uint8_t instance);
 
 	// Sets discoverable mode
 	// 0x00 disables discoverable
@@ -232,6 +260,28 @@ struct Mgmt
 	// Returns true on success, otherwise false
 	bool setAdvertising(uint8_t newState);
 
+	//
+	// Batching
+	//
+
+	// Starts a batch of commands
+	//
+	// Until `finishBatch()` is called, commands are sent without waiting for their responses so that the adapter can process them
+	// back-to-back. The adapter still processes them in the order they were sent. While batching, the methods above return true
+	// once their command is sent; failures are reported by `finishBatch()`.
+	void beginBatch();
+
+	// Waits for the responses to every command sent since `beginBatch()` and ends the batch
+	//
+	// Returns true if every command succeeded, otherwise false
+	bool finishBatch();
+
+	// Returns true if the most recent failure might succeed if it is retried
+	//
+	// After `finishBatch()`, this covers the whole batch: it is false only if every failure in the batch was permanent (see
+	// `HciAdapter::CommandResult::failedPermanently()`.)
+	bool isRetryable() const { return retryable; }
+
 	//
 	// Utilitarian
 	//
@@ -246,6 +296,19 @@ struct Mgmt
 
 private:
 
+	// A command sent as part of a batch, awaiting its response
+	struct BatchedCommand
+	{
+		HciAdapter::CommandTicket ticket;
+		std::string failureText;
+	};
+
+	// Sends a command, logging `failureText` (along with the reason) if it fails
+	//
+	// Outside of a batch this waits for the response and returns true on success, otherwise false. Within a batch, it returns
+	// once the command is sent (see `beginBatch()`.)
+	bool sendCommand(HciAdapter::HciHeader &request, const std::string &failureText);
+
 	//
 	// Data members
 	//
@@ -253,8 +316,12 @@ private:
 	// The default controller index (the first device)
 	uint16_t controllerIndex;
 
-	// Default controller index
-	static const uint16_t kDefaultControllerIndex = 0;
+	// True between `beginBatch()` and `finishBatch()`, and the commands sent in that time
+	bool batching;
+	std::vector<BatchedCommand> batch;
+
+	// See `isRetryable()`
+	bool retryable;
 };
 
 }; // namespace ggk
@@ -163,6 +163,10 @@
 #include "GattDescriptor.h"
 #include "Logger.h"
 #include "HciAdapter.h"
+#include "MessageQueue.h"
+#include "MessageFraming.h"
+#include "IndicationWindow.h"
+#include "UpdateQueue.h"
 
 namespace ggk {
 
@@ -189,8 +193,9 @@ static char * ggk_ble_model = NULL;
 static char * ggk_sender_char = NULL;
 static char * ggk_receiver_char = NULL;
 
-static char ggk_sender_cache[500] = {0};
-static int  ggk_sender_cache_len = 0;
+// The path of the characteristic that sends messages
+static const char *kMessageSendPath = "/com/bleggklinux/msg_service/msg_send";
+
 
 void ggkServerRegisterBrand( const char * brand )
 {
@@ -234,16 +239,176 @@ void ggkServerRegisterReceiverCB( const char * ch, GGKMessageReceived receivedCB
     messageReceivedCallback= receivedCB;
 }
 
-void ggkServerSendMessage( const char * message, int size )
+// Queues a message for sending
+//
+// Messages may be up to 512 bytes, or up to 65535 bytes with framing enabled (see `ggkServerSetFraming()`.) A framed message
+// takes one queue buffer per 512 bytes and must fit within the send queue's depth, so if the depth is lowered below its default
+// (see `ggkServerSetSendQueueDepth()`) the largest message is 512 bytes times the depth.
+//
+// Returns the message's ID (a positive value) on success or 0 on failure (the message is empty, too large for framing or for the
+// send queue's depth, the queue is at its maximum depth or there are no active connections.)
+int ggkServerSendMessage( const char * message, int size )
 {
-    memset(ggk_sender_cache,0,500);
-    memcpy(ggk_sender_cache,message,size);
-    ggk_sender_cache_len = size;
+    if(ggk::HciAdapter::getInstance().getActiveConnectionCount()<=0)
+        return 0;
+
+    // An empty message has nothing to send, and the msg_send characteristic would only report it as failed
+    if (nullptr == message || size <= 0)
+    {
+        GGK_LOG_WARN(SSTR << "Outbound message is empty");
+        return 0;
+    }
+
+    int maxSize = MessageFraming::getInstance().isEnabled() ? MessageFraming::kMaxMessageSize : MessageQueue::kMaxMessageSize;
+    if (size > maxSize)
+    {
+        GGK_LOG_WARN(SSTR << "Outbound message too large (" << size << " bytes, maximum is " << maxSize << ")");
+        return 0;
+    }
 
-    if(ggk::HciAdapter::getInstance().getActiveConnectionCount()>0){
+    int depthSize = MessageQueue::getInstance().getMaxMessageLength();
+    if (size > depthSize)
+    {
+        GGK_LOG_WARN(SSTR << "Outbound message too large for the send queue depth (" << size << " bytes, maximum is " << depthSize << ")");
+        return 0;
+    }
 
-        ggkNofifyUpdatedCharacteristic("/com/bleggklinux/msg_service/msg_send");
+    int messageId = MessageQueue::getInstance().push(message, size);
+    if (0 == messageId)
+    {
+        GGK_LOG_WARN(SSTR << "Unable to queue outbound message (" << size << " bytes, " << MessageQueue::getInstance().size() << " waiting)");
+        return 0;
     }
+
+    // The msg_send characteristic sends everything that's waiting each time it's updated, so it doesn't matter if this update is
+    // coalesced with one that's already pending
+    ggkNofifyUpdatedCharacteristic(kMessageSendPath);
+    return messageId;
+}
+
+void ggkServerRegisterSendCompleteCB( GGKMessageSendComplete completeCB )
+{
+    MessageQueue::getInstance().setCompletionCallback(completeCB);
+}
+
+void ggkServerSetSendQueueDepth( int depth )
+{
+    MessageQueue::getInstance().setMaxDepth(depth);
+}
+
+int ggkServerGetSendQueueDepth()
+{
+    return MessageQueue::getInstance().getMaxDepth();
+}
+
+int ggkServerSendQueueSize()
+{
+    return static_cast<int>(MessageQueue::getInstance().size());
+}
+
+void ggkServerSetFraming(int enabled)
+{
+    MessageFraming::getInstance().setEnabled(enabled != 0);
+}
+
+int ggkServerGetFraming()
+{
+    return MessageFraming::getInstance().isEnabled() ? 1 : 0;
+}
+
+void ggkServerGetFramingStats(struct GGKFramingStats *pStats)
+{
+    if (nullptr != pStats)
+    {
+        MessageFraming::getInstance().getStats(*pStats);
+    }
+}
+
+void ggkServerResetFramingStats()
+{
+    MessageFraming::getInstance().resetStats();
+}
+
+void ggkServerRegisterSendConfirmedCB( GGKMessageConfirmed confirmedCB )
+{
+    IndicationWindow::getInstance().setConfirmedCallback(confirmedCB);
+}
+
+void ggkServerSetIndicationWindow( int window )
+{
+    IndicationWindow::getInstance().setWindow(window);
+}
+
+int ggkServerGetIndicationWindow()
+{
+    return IndicationWindow::getInstance().getWindow();
+}
+
+int ggkServerIndicationsInFlight()
+{
+    return IndicationWindow::getInstance().getInFlight();
+}
+
+// GLib source ID of the timer that gives up on unconfirmed indications (0 if not running)
+static guint indicationTimeoutId = 0;
+
+// Called from the main loop when indications have been awaiting confirmation for too long
+//
+// The expired indications leave the window and the sender is updated so that it can carry on.
+static gboolean onIndicationTimeout(gpointer /*pUserData*/)
+{
+    indicationTimeoutId = 0;
+    IndicationWindow::getInstance().expire(UpdateQueue::nowUS());
+    ggkNofifyUpdatedCharacteristic(kMessageSendPath);
+    return G_SOURCE_REMOVE;
+}
+
+// Removes the indication timeout, if it's scheduled
+//
+// This is called as the server shuts down (see `uninit()` in Init.cpp), so that the timer doesn't outlive the main loop.
+void cancelIndicationTimeout()
+{
+    if (0 != indicationTimeoutId)
+    {
+        g_source_remove(indicationTimeoutId);
+        indicationTimeoutId = 0;
+    }
+}
+
+// Records data received from a peer in the connection table
+//
+// The peer is identified by its BlueZ device object path (empty or null if BlueZ didn't say.) A zero `mtu` is ignored.
+static void recordReceived(const char *pDevicePath, int length, guint16 mtu)
+{
+    uint8_t address[6];
+    if (!ConnectionTable::addressFromDevicePath(pDevicePath, address))
+        return;
+
+    ConnectionTable &connections = HciAdapter::getInstance().getConnections();
+    connections.setMtu(address, mtu);
+    connections.addBytesIn(address, static_cast<uint64_t>(length));
+}
+
+// Passes data written to the receiver characteristic to the application
+//
+// With framing enabled, the data is a fragment and the application only hears about complete messages.
+static void receiveMessageData(const guint8 *pData, int length)
+{
+    MessageFraming &framing = MessageFraming::getInstance();
+    if (framing.isEnabled())
+    {
+        int messageLength = 0;
+        pData = framing.receiveFragment(pData, length, messageLength);
+        if (nullptr == pData)
+        {
+            return;
+        }
+
+        length = messageLength;
+    }
+
+    if (messageReceivedCallback)
+        messageReceivedCallback( reinterpret_cast<const char *>(pData), length );
 }
 
 
@@ -359,8 +524,11 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	.gattServiceBegin("msg_service", "CAD0")
 
 
-            // FF81特征值(read, write)
-            .gattCharacteristicBegin("msg_receive", "6b44", { "write"})
+            // FF81特征值(read, write, write-without-response)
+            //
+            // Write-without-response lets the central stream writes without waiting for a response to each one. It's also what
+            // makes BlueZ use AcquireWrite (below) rather than a WriteValue call per write.
+            .gattCharacteristicBegin("msg_receive", "6b44", { "write", "write-without-response" })
 
 //			// 读操作回调
             .onReadValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
@@ -373,28 +541,130 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
             .onWriteValue(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
             {
                 GVariant *pAyBuffer = g_variant_get_child_value(pParameters, 0);
+                GVariant *pOptions = g_variant_get_child_value(pParameters, 1);
 
-                char ble_buffer[500] = {0};
-                int ble_buffer_len;
+                // Keep track of the MTU so outbound messages can be fragmented to fit
+                guint16 mtu = 0;
+                if (g_variant_lookup(pOptions, "mtu", "q", &mtu))
+                    MessageFraming::getInstance().setMtu(mtu);
 
-                Utils::BytesFromGVariantByteArray( pAyBuffer, ble_buffer, &ble_buffer_len );
+                // Read the value in place rather than copying it out
+                gsize length = 0;
+                const guint8 *pData = static_cast<const guint8 *>(g_variant_get_fixed_array(pAyBuffer, &length, sizeof(guint8)));
 
-                messageReceivedCallback( ble_buffer, ble_buffer_len );
+                const gchar *pDevicePath = nullptr;
+                g_variant_lookup(pOptions, "device", "&o", &pDevicePath);
+                recordReceived( pDevicePath, static_cast<int>(length), mtu );
+
+                receiveMessageData( pData, static_cast<int>(length) );
+
+                g_variant_unref(pOptions);
+                g_variant_unref(pAyBuffer);
 
                 self.callOnUpdatedValue(pConnection, pUserData);
+
+                // Write-without-response calls don't expect a reply, in which case this just releases the invocation
                 self.methodReturnVariant(pInvocation, NULL);
             })
 
+            // Let BlueZ acquire a socket for this characteristic, so inbound writes are read straight from the socket rather than
+            // arriving as WriteValue method calls
+            .enableAcquireWrite(CHARACTERISTIC_ACQUIRED_WRITE_CALLBACK_LAMBDA
+            {
+                MessageFraming::getInstance().setMtu(self.getWriteMtu());
+                recordReceived( self.getWriteDevicePath().c_str(), dataLen, self.getWriteMtu() );
+                receiveMessageData( pData, dataLen );
+            })
+
             .gattCharacteristicEnd()
 
                     // FF82特征值(indicate)
             .gattCharacteristicBegin("msg_send", "6b64", {"indicate"})
 
+            // Let BlueZ acquire a socket for this characteristic, so each message is a single write() rather than a
+            // PropertiesChanged signal
+            .enableAcquireNotify()
+
+            // Each confirmation frees a place in the indication window, so top it up
+            .onConfirm(CHARACTERISTIC_METHOD_CALLBACK_LAMBDA
+            {
+                IndicationWindow::getInstance().confirmed();
+                self.methodReturnVariant(pInvocation, NULL);
+                self.callOnUpdatedValue(pConnection, pUserData);
+            })
+
             .onUpdatedValue(CHARACTERISTIC_UPDATED_VALUE_CALLBACK_LAMBDA
             {
-                // TODO 这里要处理 数据为00的情况 ok
-                if (ggk_sender_cache_len)
-                self.sendChangeNotificationBytes( pConnection, (unsigned char*)ggk_sender_cache, ggk_sender_cache_len );
+                // Send what's waiting, in order, for as long as the indication window (and the notification socket, if acquired)
+                // has room
+                MessageQueue &queue = MessageQueue::getInstance();
+                MessageFraming &framing = MessageFraming::getInstance();
+                IndicationWindow &window = IndicationWindow::getInstance();
+                ConnectionTable &connections = HciAdapter::getInstance().getConnections();
+                while (const MessageQueue::Message *pMessage = queue.front())
+                {
+                    if (!window.canSend(connections.count()))
+                    {
+                        // Confirmations will resume sending; the timeout makes sure a lost one doesn't stall us
+                        if (0 == indicationTimeoutId)
+                            indicationTimeoutId = g_timeout_add(IndicationWindow::kConfirmTimeoutMS, onIndicationTimeout, nullptr);
+                        break;
+                    }
+
+                    int messageId = pMessage->messageId;
+                    int64_t queueTimeUS = pMessage->queueTimeUS;
+
+                    if (!framing.isEnabled())
+                    {
+                        // TODO 这里要处理 数据为00的情况 ok
+                        bool sent = pMessage->length > 0 && pMessage->chunkCount == 1 &&
+                            self.sendChangeNotificationBytes( pConnection, const_cast<guint8 *>(pMessage->data), pMessage->length );
+
+                        // The socket is full; the message stays at the front until it drains
+                        if (!sent && self.isNotifyBlocked())
+                            break;
+
+                        if (sent)
+                        {
+                            window.sent(messageId, queueTimeUS, true);
+                            connections.addBytesOut(static_cast<uint64_t>(pMessage->length));
+                        }
+
+                        queue.pop(sent ? EMessageSent : EMessageFailed);
+                        continue;
+                    }
+
+                    // Fragment to the MTU of the notify socket if BlueZ has acquired one, otherwise to the last MTU the central
+                    // reported
+                    int mtu = self.isNotifyAcquired() ? self.getNotifyMtu() : framing.getMtu();
+
+                    guint8 fragment[MessageFraming::kMaxFragmentSize];
+                    bool isLast = false;
+                    int length = framing.nextFragment(queue, mtu, fragment, isLast);
+                    if (length < 0)
+                    {
+                        // The rest of the message is still being queued; we'll be updated again when it is
+                        break;
+                    }
+
+                    bool sent = self.sendChangeNotificationBytes( pConnection, fragment, length );
+
+                    // The socket is full; the same fragment is built again once it drains
+                    if (!sent && self.isNotifyBlocked())
+                        break;
+
+                    framing.fragmentSent(sent);
+                    if (sent)
+                    {
+                        window.sent(messageId, queueTimeUS, isLast);
+                        connections.addBytesOut(static_cast<uint64_t>(length));
+                    }
+
+                    if (!sent)
+                        queue.pop(EMessageFailed);
+                    else if (isLast)
+                        queue.pop(EMessageSent);
+                }
 
                 return true;
             })
@@ -424,6 +694,47 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 	{
 		ServerUtils::getManagedObjects(pInvocation);
 	});
+
+	// The description is complete - index it for fast lookups
+	buildObjectIndex();
+}
+
+// Builds the object and interface indexes from the server description
+//
+// This is called once, at the end of the constructor, after which the object tree must not change.
+void Server::buildObjectIndex()
+{
+	objectIndex.clear();
+	interfaceIndex.clear();
+
+	for (const DBusObject &object : objects)
+	{
+		indexObject(object);
+	}
+
+	// A new tree needs a new reply to GetManagedObjects
+	ServerUtils::invalidateManagedObjects();
+
+	GGK_LOG_DEBUG(SSTR << "Indexed " << objectIndex.size() << " objects and " << interfaceIndex.size() << " interfaces");
+}
+
+// Adds an object and its descendants to the object and interface indexes
+void Server::indexObject(const DBusObject &object)
+{
+	// If two objects share a path, the first one wins (this matches the original depth-first search), and so do its interfaces
+	if (objectIndex.insert(std::make_pair(object.getPath().c_str(), &object)).second)
+	{
+		for (const std::shared_ptr<DBusInterface> &pInterface : object.getInterfaces())
+		{
+			InterfaceKey key = { object.getPath().c_str(), pInterface->getName().c_str() };
+			interfaceIndex.insert(std::make_pair(key, pInterface));
+		}
+	}
+
+	for (const DBusObject &child : object.getChildren())
+	{
+		indexObject(child);
+	}
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------
@@ -435,16 +746,32 @@ Server::Server(const std::string &serviceName, const std::string &advertisingNam
 // If the interface was found, it is returned, otherwise nullptr is returned
 std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath &objectPath, const std::string &interfaceName) const
 {
-	for (const DBusObject &object : objects)
+	return findInterface(objectPath.c_str(), interfaceName.c_str());
+}
+
+// Find a D-Bus interface within the given D-Bus object
+//
+// This is a single lookup in the interface index (see `buildObjectIndex()`.) If the interface was found, it is returned,
+// otherwise nullptr is returned
+std::shared_ptr<const DBusInterface> Server::findInterface(const char *pObjectPath, const char *pInterfaceName) const
+{
+	InterfaceKey key = { pObjectPath, pInterfaceName };
+	InterfaceIndex::const_iterator it = interfaceIndex.find(key);
+	if (it == interfaceIndex.end())
 	{
-		std::shared_ptr<const DBusInterface> pInterface = object.findInterface(objectPath, interfaceName);
-		if (pInterface != nullptr)
-		{
-			return pInterface;
-		}
+		return nullptr;
 	}
 
-	return nullptr;
+	return it->second;
+}
+
+// Find a D-Bus object by its full path
+//
+// If the object was found, it is returned, otherwise nullptr is returned
+const DBusObject *Server::findObject(const char *pObjectPath) const
+{
+	ObjectIndex::const_iterator it = objectIndex.find(pObjectPath);
+	return it == objectIndex.end() ? nullptr : it->second;
 }
 
 // Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
@@ -452,15 +779,21 @@ std::shared_ptr<const DBusInterface> Server::findInterface(const DBusObjectPath
 // If the method was called, this method returns true, otherwise false. There is no result from the method call itself.
 bool Server::callMethod(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
 {
-	for (const DBusObject &object : objects)
+	return callMethod(objectPath.c_str(), interfaceName.c_str(), methodName.c_str(), pConnection, pParameters, pInvocation, pUserData);
+}
+
+// Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
+//
+// If the method was called, this method returns true, otherwise false. There is no result from the method call itself.
+bool Server::callMethod(const char *pObjectPath, const char *pInterfaceName, const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const
+{
+	std::shared_ptr<const DBusInterface> pInterface = findInterface(pObjectPath, pInterfaceName);
+	if (nullptr == pInterface)
 	{
-		if (object.callMethod(objectPath, interfaceName, methodName, pConnection, pParameters, pInvocation, pUserData))
-		{
-			return true;
-		}
+		return false;
 	}
 
-	return false;
+	return pInterface->callMethod(pMethodName, pConnection, pParameters, pInvocation, pUserData);
 }
 
 // Find a GATT Property within the given D-Bus object on the given D-Bus interface
@@ -468,20 +801,32 @@ bool Server::callMethod(const DBusObjectPath &objectPath, const std::string &int
 // If the property was found, it is returned, otherwise nullptr is returned
 const GattProperty *Server::findProperty(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &propertyName) const
 {
-	std::shared_ptr<const DBusInterface> pInterface = findInterface(objectPath, interfaceName);
+	return findProperty(objectPath.c_str(), interfaceName.c_str(), propertyName.c_str());
+}
+
+// Find a GATT Property within the given D-Bus object on the given D-Bus interface
+//
+// If the property was found, it is returned, otherwise nullptr is returned
+const GattProperty *Server::findProperty(const char *pObjectPath, const char *pInterfaceName, const char *pPropertyName) const
+{
+	std::shared_ptr<const DBusInterface> pInterface = findInterface(pObjectPath, pInterfaceName);
+	if (nullptr == pInterface)
+	{
+		return nullptr;
+	}
 
 	// Try each of the GattInterface types that support properties?
 	if (std::shared_ptr<const GattInterface> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattInterface))
 	{
-		return pGattInterface->findProperty(propertyName);
+		return pGattInterface->findProperty(pPropertyName);
 	}
 	else if (std::shared_ptr<const GattService> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
 	{
-		return pGattInterface->findProperty(propertyName);
+		return pGattInterface->findProperty(pPropertyName);
 	}
 	else if (std::shared_ptr<const GattCharacteristic> pGattInterface = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattCharacteristic))
 	{
-		return pGattInterface->findProperty(propertyName);
+		return pGattInterface->findProperty(pPropertyName);
 	}
 
 	return nullptr;
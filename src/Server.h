@@ -30,9 +30,12 @@
 #include <vector>
 #include <list>
 #include <memory>
+#include <unordered_map>
+#include <string.h>
 
 #include "../include/Gobbledegook.h"
 #include "DBusObject.h"
+#include "Utils.h"
 
 namespace ggk {
 
@@ -58,6 +61,36 @@ struct Server
 	// Our server is a collection of D-Bus objects
 	typedef std::list<DBusObject> Objects;
 
+	// Maps a full object path to the object at that path
+	//
+	// The index is keyed on C strings, so it can be searched with the `const char *` paths that D-Bus gives us without first
+	// copying them into a std::string
+	typedef std::unordered_map<const char *, const DBusObject *, Utils::CStringHash, Utils::CStringEqual> ObjectIndex;
+
+	// An object path and interface name, as used to key the interface index
+	struct InterfaceKey
+	{
+		const char *pObjectPath;
+		const char *pInterfaceName;
+
+		bool operator==(const InterfaceKey &other) const
+		{
+			return strcmp(pObjectPath, other.pObjectPath) == 0 && strcmp(pInterfaceName, other.pInterfaceName) == 0;
+		}
+	};
+
+	struct InterfaceKeyHash
+	{
+		size_t operator()(const InterfaceKey &key) const
+		{
+			Utils::CStringHash hash;
+			return hash(key.pObjectPath) * 31 + hash(key.pInterfaceName);
+		}
+	};
+
+	// Maps an object path and interface name to the interface, keyed on C strings like the object index
+	typedef std::unordered_map<InterfaceKey, std::shared_ptr<const DBusInterface>, InterfaceKeyHash> InterfaceIndex;
+
 	//
 	// Accessors
 	//
@@ -167,26 +200,50 @@ struct Server
 	// Utilitarian
 	//
 
-	// Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
+	// Find a D-Bus object by its full path
 	//
-	// If the method was called, this method returns true, otherwise false.  There is no result from the method call itself.
+	// This is a single lookup in the object index (see `buildObjectIndex()`.) If the object was found, it is returned, otherwise
+	// nullptr is returned
+	const DBusObject *findObject(const char *pObjectPath) const;
+
+	// Find a D-Bus interface within the given D-Bus object
+	//
+	// This is a single lookup in the interface index (see `buildObjectIndex()`.) If the interface was found, it is returned,
+	// otherwise nullptr is returned
 	std::shared_ptr<const DBusInterface> findInterface(const DBusObjectPath &objectPath, const std::string &interfaceName) const;
+	std::shared_ptr<const DBusInterface> findInterface(const char *pObjectPath, const char *pInterfaceName) const;
 
-	// Find a D-Bus method within the given D-Bus object on the given D-Bus interface
+	// Find and call a D-Bus method within the given D-Bus object on the given D-Bus interface
 	//
-	// If the method was found, it is returned, otherwise nullptr is returned
+	// If the method was called, this method returns true, otherwise false.  There is no result from the method call itself.
 	bool callMethod(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &methodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
+	bool callMethod(const char *pObjectPath, const char *pInterfaceName, const char *pMethodName, GDBusConnection *pConnection, GVariant *pParameters, GDBusMethodInvocation *pInvocation, gpointer pUserData) const;
 
 	// Find a GATT Property within the given D-Bus object on the given D-Bus interface
 	//
 	// If the property was found, it is returned, otherwise nullptr is returned
 	const GattProperty *findProperty(const DBusObjectPath &objectPath, const std::string &interfaceName, const std::string &propertyName) const;
+	const GattProperty *findProperty(const char *pObjectPath, const char *pInterfaceName, const char *pPropertyName) const;
 
 private:
 
+	// Builds the object and interface indexes from the server description
+	//
+	// This is called once, at the end of the constructor, after which the object tree must not change.
+	void buildObjectIndex();
+
+	// Adds an object and its descendants to the object and interface indexes
+	void indexObject(const DBusObject &object);
+
 	// Our server's objects
 	Objects objects;
 
+	// Our index of objects by full path (the keys are the objects' own cached paths, see `DBusObject::getPath()`)
+	ObjectIndex objectIndex;
+
+	// Our index of interfaces by object path and interface name (the keys point into the indexed objects and interfaces)
+	InterfaceIndex interfaceIndex;
+
 	// BR/EDR requested state
 	bool enableBREDR;
 
@@ -21,12 +21,18 @@
 // Generally speaking, these are blocks of code that are too big to comfortably fit as lambdas within the `Server::Server()`
 // constructor are here.
 //
+// The reply to `GetManagedObjects` describes our entire object tree. BlueZ asks for it when we register and again whenever
+// bluetoothd restarts, and the tree doesn't change in between, so we build the reply once (already serialized) and send the
+// same one each time. Anything that changes the tree or its properties must call `invalidateManagedObjects()`. Properties with a
+// getter are reported as their getter returns them when the reply is built, just as `Get` would report them.
+//
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
 #include <glib.h>
 #include <string>
 #include <fstream>
 #include <regex>
+#include <atomic>
 
 #include "ServerUtils.h"
 #include "DBusObject.h"
@@ -41,6 +47,28 @@
 
 namespace ggk {
 
+// Returns the value to report for `property` of the interface `interfaceName` at `path`
+//
+// A property with a getter reports what the getter returns, falling back to the property's stored value if the getter fails.
+static const GVariant *getManagedPropertyValue(GDBusConnection *pConnection, const DBusObjectPath &path, const std::string &interfaceName, const GattProperty &property)
+{
+	GDBusInterfaceGetPropertyFunc getter = property.getGetterFunc();
+	if (nullptr != getter)
+	{
+		GError *pError = nullptr;
+		GVariant *pValue = getter(pConnection, nullptr, path.c_str(), interfaceName.c_str(), property.getName().c_str(), &pError, nullptr);
+		if (nullptr != pValue)
+		{
+			return pValue;
+		}
+
+		GGK_LOG_WARN(SSTR << "Property getter failed for " << path << ": " << interfaceName << "." << property.getName() << (nullptr != pError ? std::string(" (") + pError->message + ")" : std::string()));
+		g_clear_error(&pError);
+	}
+
+	return property.getValue();
+}
+
 // Adds an object to the tree of managed objects as returned from the `GetManagedObjects` method call from the D-Bus interface
 // `org.freedesktop.DBus.ObjectManager`.
 //
@@ -56,7 +84,7 @@ namespace ggk {
 //     the empty dict is returned.
 //
 //     (a{oa{sa{sv}}})
-static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath &basePath, GVariantBuilder *pObjectArray)
+static void addManagedObjectsNode(GDBusConnection *pConnection, const DBusObject &object, const DBusObjectPath &basePath, GVariantBuilder *pObjectArray)
 {
 	if (!object.isPublished())
 	{
@@ -66,29 +94,29 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 	if (!object.getInterfaces().empty())
 	{
 		DBusObjectPath path = basePath + object.getPathNode();
-		Logger::debug(SSTR << "  Object: " << path);
+		GGK_LOG_DEBUG(SSTR << "  Object: " << path);
 
 		GVariantBuilder *pInterfaceArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 		for (std::shared_ptr<const DBusInterface> pInterface : object.getInterfaces())
 		{
-			Logger::debug(SSTR << "  + Interface (type: " << pInterface->getInterfaceType() << ")");
+			GGK_LOG_DEBUG(SSTR << "  + Interface (type: " << pInterface->getInterfaceType() << ")");
 
 			if (std::shared_ptr<const GattService> pService = TRY_GET_CONST_INTERFACE_OF_TYPE(pInterface, GattService))
 			{
 				if (!pService->getProperties().empty())
 				{
-					Logger::debug(SSTR << "    GATT Service interface: " << pService->getName());
+					GGK_LOG_DEBUG(SSTR << "    GATT Service interface: " << pService->getName());
 
 					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 					for (const GattProperty &property : pService->getProperties())
 					{
-						Logger::debug(SSTR << "      Property " << property.getName());
+						GGK_LOG_DEBUG(SSTR << "      Property " << property.getName());
 						g_variant_builder_add
 						(
 							pPropertyArray,
 							"{sv}",
 							property.getName().c_str(),
-							property.getValue()
+							getManagedPropertyValue(pConnection, path, pService->getName(), property)
 						);
 					}
 
@@ -105,18 +133,18 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 			{
 				if (!pCharacteristic->getProperties().empty())
 				{
-					Logger::debug(SSTR << "    GATT Characteristic interface: " << pCharacteristic->getName());
+					GGK_LOG_DEBUG(SSTR << "    GATT Characteristic interface: " << pCharacteristic->getName());
 
 					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 					for (const GattProperty &property : pCharacteristic->getProperties())
 					{
-						Logger::debug(SSTR << "      Property " << property.getName());
+						GGK_LOG_DEBUG(SSTR << "      Property " << property.getName());
 						g_variant_builder_add
 						(
 							pPropertyArray,
 							"{sv}",
 							property.getName().c_str(),
-							property.getValue()
+							getManagedPropertyValue(pConnection, path, pCharacteristic->getName(), property)
 						);
 					}
 
@@ -133,18 +161,18 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 			{
 				if (!pDescriptor->getProperties().empty())
 				{
-					Logger::debug(SSTR << "    GATT Descriptor interface: " << pDescriptor->getName());
+					GGK_LOG_DEBUG(SSTR << "    GATT Descriptor interface: " << pDescriptor->getName());
 
 					GVariantBuilder *pPropertyArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
 					for (const GattProperty &property : pDescriptor->getProperties())
 					{
-						Logger::debug(SSTR << "      Property " << property.getName());
+						GGK_LOG_DEBUG(SSTR << "      Property " << property.getName());
 						g_variant_builder_add
 						(
 							pPropertyArray,
 							"{sv}",
 							property.getName().c_str(),
-							property.getValue()
+							getManagedPropertyValue(pConnection, path, pDescriptor->getName(), property)
 						);
 					}
 
@@ -159,7 +187,7 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 			}
 			else
 			{
-				Logger::error(SSTR << "    Unknown interface type");
+				GGK_LOG_ERROR(SSTR << "    Unknown interface type");
 				return;
 			}
 		}
@@ -175,23 +203,59 @@ static void addManagedObjectsNode(const DBusObject &object, const DBusObjectPath
 
 	for (const DBusObject &child : object.getChildren())
 	{
-		addManagedObjectsNode(child, basePath + object.getPathNode(), pObjectArray);
+		addManagedObjectsNode(pConnection, child, basePath + object.getPathNode(), pObjectArray);
 	}
 }
 
-// Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+// Our cached reply to `GetManagedObjects`, and the generation of the object tree it was built from
+//
+// The reply is only touched on the main loop thread, but invalidation can come from anywhere, so it bumps an atomic generation
+// number rather than releasing the reply directly.
+static GVariant *pManagedObjectsReply = nullptr;
+static unsigned int managedObjectsReplyGeneration = 0;
+static std::atomic<unsigned int> managedObjectsGeneration(1);
+
+// Responds to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+//
+// The reply is built on the first call and reused until `invalidateManagedObjects()` is called.
 void ServerUtils::getManagedObjects(GDBusMethodInvocation *pInvocation)
 {
-	Logger::debug(SSTR << "Reporting managed objects");
-
-	GVariantBuilder *pObjectArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
-	for (const DBusObject &object : TheServer->getObjects())
+	unsigned int generation = managedObjectsGeneration.load(std::memory_order_acquire);
+	if (nullptr == pManagedObjectsReply || managedObjectsReplyGeneration != generation)
 	{
-		addManagedObjectsNode(object, DBusObjectPath(""), pObjectArray);
+		GGK_LOG_DEBUG(SSTR << "Building managed objects");
+
+		GVariantBuilder *pObjectArray = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
+		for (const DBusObject &object : TheServer->getObjects())
+		{
+			addManagedObjectsNode(g_dbus_method_invocation_get_connection(pInvocation), object, DBusObjectPath(""), pObjectArray);
+		}
+
+		if (nullptr != pManagedObjectsReply)
+		{
+			g_variant_unref(pManagedObjectsReply);
+		}
+
+		pManagedObjectsReply = g_variant_ref_sink(g_variant_new("(a{oa{sa{sv}}})", pObjectArray));
+		g_variant_builder_unref(pObjectArray);
+		managedObjectsReplyGeneration = generation;
+
+		// Serialize the reply now, so that each reply only has to copy the serialized bytes into the message
+		g_variant_get_data(pManagedObjectsReply);
 	}
 
-	GVariant *pParams = g_variant_new("(a{oa{sa{sv}}})", pObjectArray);
-	g_dbus_method_invocation_return_value(pInvocation, pParams);
+	GGK_LOG_DEBUG(SSTR << "Reporting managed objects");
+
+	// The invocation takes its own reference to the reply
+	g_dbus_method_invocation_return_value(pInvocation, pManagedObjectsReply);
+}
+
+// Discards the cached reply to `GetManagedObjects`, so that the next call rebuilds it
+//
+// Call this whenever the object tree or one of its properties changes. This may be called from any thread.
+void ServerUtils::invalidateManagedObjects()
+{
+	managedObjectsGeneration.fetch_add(1, std::memory_order_acq_rel);
 }
 
 // WARNING: Hacky code - don't count on this working properly on all systems
@@ -31,9 +31,16 @@ namespace ggk {
 
 struct ServerUtils
 {
-	// Builds the response to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+	// Responds to the method call `GetManagedObjects` from the D-Bus interface `org.freedesktop.DBus.ObjectManager`
+	//
+	// The reply is built on the first call and reused until `invalidateManagedObjects()` is called.
 	static void getManagedObjects(GDBusMethodInvocation *pInvocation);
 
+	// Discards the cached reply to `GetManagedObjects`, so that the next call rebuilds it
+	//
+	// Call this whenever the object tree or one of its properties changes. This may be called from any thread.
+	static void invalidateManagedObjects();
+
 	// WARNING: Hacky code - don't count on this working properly on all systems
 	//
 	// This routine will attempt to parse /proc/cpuinfo to return the CPU count/model. Results are cached on the first call, with
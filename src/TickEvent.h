@@ -21,14 +21,14 @@
 // regular basis or performing other periodic tasks. One example usage might be checking the battery level every 60 seconds and if
 // it has changed since the last update, send out a notification to subscribers.
 //
-// The frequency at which events fire is dependent upon two values: the driving timer's tick frequency multiplied by the tick
-// freuency of the TickEvent itself.
+// Each tick event has its own period. Events added via the `onEvent()` method to the server description are given a tick
+// frequency, which is a number of kTickPeriodMS (one second) ticks. Events added via `onTimerEvent()` are given their period in
+// milliseconds directly.
 //
-// The tick event's frequency is set when a tick event is added via the `onEvent()` method to the server description.
-//
-// The driving timer's frequency is a one-second-resolution low-frequency timer with a default of one second. To modify this, see
-// `kPeriodicTimerFrequencySeconds` at the top of Init.cpp. Note that the periodic timer (which drives tick events) is intentionally
-// a low-frequency timer. Higher frequency timers would lend themselves to using more battery on both, the server and client.
+// The server schedules events on a timer wheel (see TimerWheel.cpp), waking only when an event is due, so events with long
+// periods cost nothing in between. The wheel's resolution is TimerWheel::kResolutionMS; shorter periods are rounded up to it.
+// A period of zero or less (such as a `tickFrequency` of 0) fires every kTickPeriodMS, as with the original one-second timer.
+// Higher frequency events lend themselves to using more battery on both, the server and client.
 //
 // When using a TickEvent, be careful not to demand too much of your client. Notifiations that are too frequent may place undue
 // stress on their battery to receive and process the updates.
@@ -63,12 +63,19 @@ struct TickEvent
 	// A tick event callback, which is called whenever the TickEvent fires
 	typedef void (*Callback)(const DBusInterface &self, const TickEvent &event, GDBusConnection *pConnection, void *pUserData);
 
-	// Construct a TickEvent that will fire after a specified 'tickFrequency' number of ticks of the periodic timer.
 	//
-	// Note that the actual time between a callback's execution is the event's 'tickFrequency' multiplied by the time between each
-	// periodic timer tick.
+	// Constants
+	//
+
+	// The length of a tick, in milliseconds
+	static const int kTickPeriodMS = 1000;
+
+	// Construct a TickEvent that will fire after a specified 'tickFrequency' number of ticks.
+	//
+	// Note that the actual time between a callback's execution is the event's 'tickFrequency' multiplied by kTickPeriodMS. To
+	// use a period that isn't a whole number of ticks, see `setPeriodMS()`.
 	TickEvent(const DBusInterface *pOwner, int tickFrequency, Callback callback, void *pUserData)
-	: pOwner(pOwner), elapsedTicks(0), tickFrequency(tickFrequency), callback(callback), pUserData(pUserData)
+	: pOwner(pOwner), elapsedTicks(0), tickFrequency(tickFrequency), periodMS(tickFrequency * kTickPeriodMS), callback(callback), pUserData(pUserData)
 	{
 	}
 
@@ -85,8 +92,19 @@ struct TickEvent
 	// Returns the tick frequency between schedule tick events
 	int getTickFrequency() const { return tickFrequency; }
 
-	// Sets the tick frequency between schedule tick events
-	void setTickFrequency(int frequency) { tickFrequency = frequency; }
+	// Sets the tick frequency between schedule tick events (this also sets the period to `frequency` ticks)
+	void setTickFrequency(int frequency) { tickFrequency = frequency; periodMS = frequency * kTickPeriodMS; }
+
+	// Returns the time between firings, in milliseconds
+	int getPeriodMS() const { return periodMS; }
+
+	// Sets the time between firings, in milliseconds
+	//
+	// This takes effect when the server schedules its events at startup.
+	void setPeriodMS(int period) { periodMS = period; }
+
+	// Returns the interface that owns this TickEvent
+	const DBusInterface *getOwner() const { return pOwner; }
 
 	// Returns the user data pointer associated to this TickEvent
 	void *getUserData() { return pUserData; }
@@ -117,16 +135,24 @@ struct TickEvent
 		elapsedTicks += 1;
 		if (elapsedTicks >= tickFrequency)
 		{
-			if (nullptr != callback)
-			{
-				Logger::debug(SSTR << "Ticking at path '" << path << "'");
-				callback(*static_cast<const T *>(pOwner), *this, pConnection, pUserData);
-			}
-
+			fire<T>(path, pConnection, pUserData);
 			elapsedTicks = 0;
 		}
 	}
 
+	// Fires the TickEvent, calling its `callback` with its owner as type T
+	//
+	// The server's timer wheel calls this (through `DBusInterface::fireEvent()`) each time the event's period elapses.
+	template<typename T>
+	void fire(const DBusObjectPath &path, GDBusConnection *pConnection, void *pUserData) const
+	{
+		if (nullptr != callback)
+		{
+			GGK_LOG_DEBUG(SSTR << "Ticking at path '" << path << "'");
+			callback(*static_cast<const T *>(pOwner), *this, pConnection, pUserData);
+		}
+	}
+
 private:
 
 	//
@@ -136,6 +162,7 @@ private:
 	const DBusInterface *pOwner;
 	mutable int elapsedTicks;
 	int tickFrequency;
+	int periodMS;
 	Callback callback;
 	void *pUserData;
 };
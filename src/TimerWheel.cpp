@@ -0,0 +1,233 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A hierarchical timer wheel that schedules the server's tick events
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Each tick event has its own period. Rather than visiting every event on a fixed timer to see whether it's due, we file each
+// event into a slot of a timer wheel by its deadline, so that only the slots holding due events are ever visited.
+//
+// The wheel has kLevelCount levels of kSlotCount slots. A slot of the lowest level spans a single tick (kResolutionMS); a slot of
+// each higher level spans as many ticks as the whole level below it. An event is filed in the lowest level that reaches its
+// deadline. When the clock reaches the start of a higher-level slot, that slot's events are "cascaded": refiled into the levels
+// below, where they come due at their exact tick. So an event with a long period is touched a handful of times per period, not
+// on every tick.
+//
+// While the lowest level is empty, the clock skips straight to the next cascade, so catching up after a long sleep costs little.
+// `getDelayMS()` reports the earliest deadline of any event, so the caller can arm a single timer for exactly then and sleep until
+// it fires.
+//
+// This class isn't thread-safe; the server uses it only from its main loop.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <algorithm>
+
+#include "TimerWheel.h"
+#include "TickEvent.h"
+
+namespace ggk {
+
+// Our constructor leaves the wheel empty
+TimerWheel::TimerWheel()
+{
+	reset(0);
+}
+
+// Removes every event and restarts the wheel's clock at `nowMS` (a monotonic time in milliseconds)
+void TimerWheel::reset(int64_t nowMS)
+{
+	timers.clear();
+	for (int level = 0; level < kLevelCount; ++level)
+	{
+		levelSizes[level] = 0;
+		for (int slot = 0; slot < kSlotCount; ++slot)
+		{
+			slots[level][slot] = nullptr;
+		}
+	}
+
+	currentTick = nowMS / kResolutionMS;
+}
+
+// Schedules `event` to come due every `event.getPeriodMS()` milliseconds, starting one period from now
+//
+// The event must outlive the wheel (or the next `reset()`.)
+void TimerWheel::add(const TickEvent &event)
+{
+	// A non-positive period fires on every tick of the old one-second periodic timer, as it always has
+	int64_t periodMS = event.getPeriodMS() > 0 ? event.getPeriodMS() : TickEvent::kTickPeriodMS;
+
+	// Round the period up to whole ticks
+	int64_t period = std::max<int64_t>(1, (periodMS + kResolutionMS - 1) / kResolutionMS);
+
+	Timer timer;
+	timer.pEvent = &event;
+	timer.deadline = currentTick + period;
+	timer.period = period;
+	timer.pNext = nullptr;
+
+	timers.push_back(timer);
+	insert(&timers.back());
+}
+
+// Files a timer into the slot for its deadline, relative to `currentTick`
+//
+// A timer goes in the lowest level whose slots reach its deadline without wrapping around to the current slot. Past the top
+// level, it goes in the top level's last slot and is refiled when that slot is cascaded.
+void TimerWheel::insert(Timer *pTimer)
+{
+	int64_t deadline = std::max(pTimer->deadline, currentTick);
+
+	int level = 0;
+	int64_t distance = deadline - currentTick;
+	while (distance >= kSlotCount && level < kLevelCount - 1)
+	{
+		++level;
+		distance = (deadline >> (kLevelBits * level)) - (currentTick >> (kLevelBits * level));
+	}
+
+	int64_t position = (currentTick >> (kLevelBits * level)) + std::min<int64_t>(distance, kSlotCount - 1);
+	int slot = static_cast<int>(position & kSlotMask);
+
+	pTimer->pNext = slots[level][slot];
+	slots[level][slot] = pTimer;
+	levelSizes[level] += 1;
+}
+
+// Empties slot `slot` of level `level`, returning its list of timers
+TimerWheel::Timer *TimerWheel::takeSlot(int level, int slot)
+{
+	Timer *pList = slots[level][slot];
+	slots[level][slot] = nullptr;
+
+	for (Timer *pTimer = pList; nullptr != pTimer; pTimer = pTimer->pNext)
+	{
+		levelSizes[level] -= 1;
+	}
+
+	return pList;
+}
+
+// Moves the timers of the current slot of `level` down to the levels below
+void TimerWheel::cascade(int level)
+{
+	Timer *pTimer = takeSlot(level, static_cast<int>((currentTick >> (kLevelBits * level)) & kSlotMask));
+	while (nullptr != pTimer)
+	{
+		Timer *pNext = pTimer->pNext;
+		insert(pTimer);
+		pTimer = pNext;
+	}
+}
+
+// Advances the wheel's clock to `nowMS`, calling `visitor` for each event that came due on the way
+//
+// Only the slots for due events are visited; each event is then rescheduled for one period later.
+void TimerWheel::advance(int64_t nowMS, Visitor visitor, void *pContext)
+{
+	int64_t targetTick = nowMS / kResolutionMS;
+	while (currentTick < targetTick)
+	{
+		// With nothing filed in the lowest level, nothing can come due before the next cascade, so skip ahead to it
+		if (0 == levelSizes[0])
+		{
+			currentTick = std::min(targetTick, (currentTick | kSlotMask) + 1);
+		}
+		else
+		{
+			currentTick += 1;
+		}
+
+		// At the start of a slot in a higher level, cascade it, starting from the highest level so that its timers can continue
+		// down through the levels below
+		int boundaryLevels = 0;
+		while (boundaryLevels + 1 < kLevelCount && 0 == (currentTick & ((int64_t(1) << (kLevelBits * (boundaryLevels + 1))) - 1)))
+		{
+			++boundaryLevels;
+		}
+
+		for (int level = boundaryLevels; level >= 1; --level)
+		{
+			cascade(level);
+		}
+
+		// Everything in the current slot of the lowest level is due now
+		Timer *pTimer = takeSlot(0, static_cast<int>(currentTick & kSlotMask));
+		while (nullptr != pTimer)
+		{
+			Timer *pNext = pTimer->pNext;
+
+			visitor(*pTimer->pEvent, pContext);
+
+			// If we fell behind, don't try to catch up on the periods we missed
+			pTimer->deadline += pTimer->period;
+			if (pTimer->deadline <= currentTick)
+			{
+				pTimer->deadline = currentTick + pTimer->period;
+			}
+
+			insert(pTimer);
+			pTimer = pNext;
+		}
+	}
+}
+
+// Returns the number of milliseconds from `nowMS` until the wheel next needs to advance, or -1 if it is empty
+//
+// That is the earliest deadline of any event. There's no need to wake for cascades along the way, since `advance()` performs them
+// as it passes each slot boundary.
+int64_t TimerWheel::getDelayMS(int64_t nowMS) const
+{
+	int64_t nextTick = -1;
+	for (int level = 0; level < kLevelCount; ++level)
+	{
+		if (0 == levelSizes[level])
+		{
+			continue;
+		}
+
+		// The current slot of the lowest level has already been visited, as has the current slot of each higher level (its
+		// events were cascaded when it began), so the search starts with the next one. The slots of a level are in deadline order,
+		// so the earliest deadline of the level is in its first occupied slot.
+		int64_t base = currentTick >> (kLevelBits * level);
+		for (int offset = 1; offset <= kSlotCount; ++offset)
+		{
+			const Timer *pTimer = slots[level][(base + offset) & kSlotMask];
+			if (nullptr == pTimer)
+			{
+				continue;
+			}
+
+			for (; nullptr != pTimer; pTimer = pTimer->pNext)
+			{
+				if (nextTick < 0 || pTimer->deadline < nextTick)
+				{
+					nextTick = pTimer->deadline;
+				}
+			}
+			break;
+		}
+	}
+
+	if (nextTick < 0)
+	{
+		return -1;
+	}
+
+	return std::max<int64_t>(0, nextTick * kResolutionMS - nowMS);
+}
+
+}; // namespace ggk
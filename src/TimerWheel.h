@@ -0,0 +1,117 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A hierarchical timer wheel that schedules the server's tick events
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of TimerWheel.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+
+namespace ggk {
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Forward declarations
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+struct TickEvent;
+
+// ---------------------------------------------------------------------------------------------------------------------------------
+// Implementation
+// ---------------------------------------------------------------------------------------------------------------------------------
+
+struct TimerWheel
+{
+	//
+	// Constants
+	//
+
+	// The length of one tick of the wheel, in milliseconds (event periods are rounded up to a whole number of ticks)
+	static const int kResolutionMS = 10;
+
+	// Each level of the wheel has 2^kLevelBits slots, each spanning 2^kLevelBits times as many ticks as a slot of the level below
+	static const int kLevelBits = 6;
+	static const int kSlotCount = 1 << kLevelBits;
+	static const int kSlotMask = kSlotCount - 1;
+
+	// With four levels of 64 slots at 10ms per tick, the top level covers about 46 hours; longer periods simply pass through it
+	// more than once
+	static const int kLevelCount = 4;
+
+	//
+	// Types
+	//
+
+	// Called for each event that comes due
+	typedef void (*Visitor)(const TickEvent &event, void *pContext);
+
+	// Our constructor leaves the wheel empty
+	TimerWheel();
+
+	// Removes every event and restarts the wheel's clock at `nowMS` (a monotonic time in milliseconds)
+	void reset(int64_t nowMS);
+
+	// Schedules `event` to come due every `event.getPeriodMS()` milliseconds, starting one period from now
+	//
+	// The event must outlive the wheel (or the next `reset()`.)
+	void add(const TickEvent &event);
+
+	// Returns the number of events scheduled
+	int size() const { return static_cast<int>(timers.size()); }
+
+	// Advances the wheel's clock to `nowMS`, calling `visitor` for each event that came due on the way
+	//
+	// Only the slots for due events are visited; each event is then rescheduled for one period later.
+	void advance(int64_t nowMS, Visitor visitor, void *pContext);
+
+	// Returns the number of milliseconds from `nowMS` until the wheel next needs to advance, or -1 if it is empty
+	//
+	// That is the earliest deadline of any event.
+	int64_t getDelayMS(int64_t nowMS) const;
+
+private:
+
+	// A scheduled event, linked into the slot for its deadline
+	struct Timer
+	{
+		const TickEvent *pEvent;
+		int64_t deadline;
+		int64_t period;
+		Timer *pNext;
+	};
+
+	// Files a timer into the slot for its deadline, relative to `currentTick`
+	void insert(Timer *pTimer);
+
+	// Empties slot `slot` of level `level`, returning its list of timers
+	Timer *takeSlot(int level, int slot);
+
+	// Moves the timers of the current slot of `level` down to the levels below
+	void cascade(int level);
+
+	// Timers are kept in a deque so that adding one never moves the others
+	std::deque<Timer> timers;
+
+	Timer *slots[kLevelCount][kSlotCount];
+	int levelSizes[kLevelCount];
+	int64_t currentTick;
+};
+
+}; // namespace ggk
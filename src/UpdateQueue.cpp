@@ -0,0 +1,396 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A bounded, lock-free queue of pending interface updates
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// Applications notify the server of updated data from their own threads, while the updates themselves must be processed on the
+// server's thread (see `idleFunc` in Init.cpp.) This queue is where those threads meet.
+//
+// The queue is a fixed-size ring of slots, each tagged with a sequence number. Producers claim a position with a compare-and-swap
+// on `enqueuePos` and publish the slot by advancing its sequence; the consumer does the reverse. No locks are taken and nothing
+// is allocated after construction.
+//
+// Entries are pre-resolved interface handles rather than path/interface strings. The object tree is fixed once the server is
+// constructed, so a raw `DBusInterface` pointer remains valid for the lifetime of the server.
+//
+// When the ring is full, the overflow policy decides what to discard. EDropNewest rejects the incoming update, EDropOldest
+// removes the oldest pending update to make room. In either case `dropCount` is incremented so the application can tell that it
+// is producing updates faster than they can be delivered.
+//
+// The consumer doesn't poll. Each push signals an eventfd which the server's main loop watches, so the main loop sleeps until
+// there is work and wakes as soon as there is. To keep bursts cheap, only the first push after the consumer has acknowledged
+// the previous wakeup actually writes to the eventfd.
+//
+// Coalescing is opt-in. When enabled, each interface carries a `pending` state (see `DBusInterface::UpdateState`.) The first push
+// for an interface moves it to EPushing while it queues the entry and to EQueued once the entry is certain to be queued; the
+// consumer returns it to ENotPending just before the update is processed. A push that finds the interface EQueued has nothing to
+// do: the update that's already waiting will read the latest value when it is processed. A push that finds it EPushing waits
+// the few instructions it takes for the other push to finish, so that it never reports success for an update that the overflow
+// policy is about to reject; if that push fails, the waiting push tries for itself. This means that, with coalescing enabled,
+// the queue never holds more than one entry per interface. An interface may also declare a minimum
+// update interval, in which case the consumer defers updates that arrive too soon (see `processUpdate` in Init.cpp.)
+//
+// The consumer drains the queue in batches of up to `batchSize` updates per main loop iteration (see `onUpdateQueueReady` in
+// Init.cpp.) Each update carries the time it was pushed, and the time from the oldest push in a batch until the batch has been
+// processed is recorded in a log2 histogram so applications can see how long their updates wait.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "UpdateQueue.h"
+#include "DBusInterface.h"
+#include "Logger.h"
+
+namespace ggk {
+
+// Our constructor initializes the sequence numbers for each slot in the ring
+UpdateQueue::UpdateQueue()
+: enqueuePos(0), dequeuePos(0), overflowPolicy(EDropNewest), dropCount(0), coalescing(false), coalescedCount(0), batchSize(kDefaultBatchSize), wakeFd(-1), wakePending(false)
+{
+	for (size_t i = 0; i < kCapacity; ++i)
+	{
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+		slots[i].pInterface.store(nullptr, std::memory_order_relaxed);
+		slots[i].pushTimeUS.store(0, std::memory_order_relaxed);
+	}
+
+	for (int i = 0; i < kLatencyBuckets; ++i)
+	{
+		latencyHistogram[i].store(0, std::memory_order_relaxed);
+	}
+
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (wakeFd < 0)
+	{
+		GGK_LOG_ERROR(SSTR << "Unable to create update queue eventfd: " << strerror(errno));
+	}
+}
+
+// Our destructor closes the wakeup descriptor
+UpdateQueue::~UpdateQueue()
+{
+	if (wakeFd >= 0)
+	{
+		close(wakeFd);
+		wakeFd = -1;
+	}
+}
+
+// Returns the current monotonic time in microseconds, as used for `Entry::pushTimeUS`
+int64_t UpdateQueue::nowUS()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Sets the maximum number of updates processed per main loop iteration (clamped to [1, kMaxBatchSize])
+void UpdateQueue::setBatchSize(int size)
+{
+	if (size < 1) { size = 1; }
+	if (size > kMaxBatchSize) { size = kMaxBatchSize; }
+	batchSize.store(size, std::memory_order_relaxed);
+}
+
+// Records the latency of a batch, measured from the push of its oldest update until processing completed
+void UpdateQueue::recordBatchLatency(int64_t latencyUS)
+{
+	int bucket = 0;
+	while (bucket < kLatencyBuckets - 1 && latencyUS >= (static_cast<int64_t>(2) << bucket))
+	{
+		++bucket;
+	}
+
+	latencyHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Copies the batch latency histogram into `pBuckets` (up to `bucketCount` entries)
+//
+// Returns the number of buckets copied
+int UpdateQueue::getLatencyHistogram(uint64_t *pBuckets, int bucketCount) const
+{
+	int count = bucketCount < kLatencyBuckets ? bucketCount : kLatencyBuckets;
+	for (int i = 0; i < count; ++i)
+	{
+		pBuckets[i] = latencyHistogram[i].load(std::memory_order_relaxed);
+	}
+
+	return count;
+}
+
+// Signal the consumer that updates are waiting
+//
+// Only the first call after `acknowledgeWake()` touches the descriptor, so a burst of pushes costs a single write.
+void UpdateQueue::wake()
+{
+	if (wakeFd < 0 || wakePending.exchange(true, std::memory_order_acq_rel))
+	{
+		return;
+	}
+
+	uint64_t one = 1;
+	if (write(wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+	{
+		GGK_LOG_WARN(SSTR << "Unable to signal update queue eventfd: " << strerror(errno));
+	}
+}
+
+// Called by the consumer when it is woken, before draining the queue
+//
+// This clears the pending wakeup so that any push from this point on will wake the consumer again.
+void UpdateQueue::acknowledgeWake()
+{
+	// This must be a read-modify-write rather than a plain store: a producer that saw the flag still set (and so skipped the
+	// eventfd) published its entry before our exchange, and the acquire ordering makes that entry visible to the drain that follows
+	wakePending.exchange(false, std::memory_order_acq_rel);
+
+	uint64_t count;
+	if (wakeFd >= 0 && read(wakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+	{
+		GGK_LOG_WARN(SSTR << "Unable to read update queue eventfd: " << strerror(errno));
+	}
+}
+
+// Attempt to add an entry without applying the overflow policy
+//
+// If `markQueued` is set, the interface's pending state is set to EQueued once the entry is certain to be queued, but before the
+// consumer can see it. Returns false if the queue is full
+bool UpdateQueue::tryPush(const DBusInterface *pInterface, bool markQueued)
+{
+	size_t pos = enqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Slot &slot = slots[pos & kMask];
+		size_t seq = slot.sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				slot.pInterface.store(pInterface, std::memory_order_relaxed);
+				slot.pushTimeUS.store(nowUS(), std::memory_order_relaxed);
+				if (markQueued)
+				{
+					pInterface->getUpdateState().pending.store(DBusInterface::UpdateState::EQueued, std::memory_order_release);
+				}
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			// The slot still holds an entry from the previous lap - we're full
+			return false;
+		}
+		else
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+// Adds an update for the given interface to the queue
+//
+// This method is safe to call from any number of threads concurrently.
+//
+// Returns true if the update was queued (or, with coalescing enabled, collapsed into an update that is queued.) If the queue is
+// full, the overflow policy decides whether the new entry (EDropNewest) or the oldest pending entry (EDropOldest) is discarded;
+// in either case the drop counter is incremented.
+bool UpdateQueue::push(const DBusInterface *pInterface)
+{
+	bool coalesce = getCoalescing();
+	if (coalesce)
+	{
+		std::atomic<int> &pending = pInterface->getUpdateState().pending;
+		int state = pending.load(std::memory_order_acquire);
+		while (true)
+		{
+			// If this interface already has an update waiting, that update will carry the latest value
+			if (DBusInterface::UpdateState::EQueued == state)
+			{
+				coalescedCount.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+
+			// Another push is queueing this interface's update; wait to see whether it succeeds
+			if (DBusInterface::UpdateState::EPushing == state)
+			{
+				std::this_thread::yield();
+				state = pending.load(std::memory_order_acquire);
+				continue;
+			}
+
+			// Nothing pending, so it's up to us
+			if (pending.compare_exchange_weak(state, DBusInterface::UpdateState::EPushing, std::memory_order_acq_rel))
+			{
+				break;
+			}
+		}
+	}
+
+	// The drop counter counts discarded entries, not attempts: a failed attempt under EDropOldest may find that the consumer (or
+	// another producer) has already made room
+	while (!tryPush(pInterface, coalesce))
+	{
+		if (getOverflowPolicy() != EDropOldest)
+		{
+			dropCount.fetch_add(1, std::memory_order_relaxed);
+
+			// The failure is final, so any push waiting on ours may now try for itself
+			if (coalesce)
+			{
+				release(pInterface);
+			}
+			return false;
+		}
+
+		// Make room by discarding the oldest entry, then try again
+		const DBusInterface *pDiscarded;
+		if (pop(pDiscarded))
+		{
+			dropCount.fetch_add(1, std::memory_order_relaxed);
+			release(pDiscarded);
+		}
+	}
+
+	wake();
+	return true;
+}
+
+// Releases the pending state of an update that has been removed from the queue
+//
+// With coalescing enabled, further pushes for an interface are collapsed until this is called. The consumer calls it just
+// before processing an update; it is also called for updates that are discarded.
+void UpdateQueue::release(const DBusInterface *pInterface)
+{
+	pInterface->getUpdateState().pending.store(DBusInterface::UpdateState::ENotPending, std::memory_order_release);
+}
+
+// Removes the oldest update from the queue, storing its interface in `pInterface`
+//
+// Returns true if an entry was removed, or false if the queue was empty
+bool UpdateQueue::pop(const DBusInterface *&pInterface)
+{
+	Entry entry;
+	if (!pop(entry))
+	{
+		return false;
+	}
+
+	pInterface = entry.pInterface;
+	return true;
+}
+
+// Removes the oldest update from the queue, storing it in `entry`
+//
+// Returns true if an entry was removed, or false if the queue was empty
+bool UpdateQueue::pop(Entry &entry)
+{
+	size_t pos = dequeuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Slot &slot = slots[pos & kMask];
+		size_t seq = slot.sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+		if (diff == 0)
+		{
+			// Producers may also pop (see EDropOldest) so we must claim the position
+			if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				entry.pInterface = slot.pInterface.load(std::memory_order_relaxed);
+				entry.pushTimeUS = slot.pushTimeUS.load(std::memory_order_relaxed);
+				slot.sequence.store(pos + kCapacity, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			// Nothing has been published at this position yet
+			return false;
+		}
+		else
+		{
+			pos = dequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+// Removes up to `maxCount` of the oldest updates from the queue, in order, storing them in `pEntries`
+//
+// Returns the number of entries removed
+int UpdateQueue::popBatch(Entry *pEntries, int maxCount)
+{
+	int count = 0;
+	while (count < maxCount && pop(pEntries[count]))
+	{
+		++count;
+	}
+
+	return count;
+}
+
+// Retrieves the oldest update from the queue without removing it
+//
+// This should only be called from the consumer. Returns true if an entry was retrieved, or false if the queue was empty
+bool UpdateQueue::peek(const DBusInterface *&pInterface) const
+{
+	while (true)
+	{
+		size_t pos = dequeuePos.load(std::memory_order_acquire);
+		const Slot &slot = slots[pos & kMask];
+		size_t seq = slot.sequence.load(std::memory_order_acquire);
+		if (seq != pos + 1)
+		{
+			if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0) { return false; }
+			continue;
+		}
+
+		const DBusInterface *pPeeked = slot.pInterface.load(std::memory_order_relaxed);
+
+		// If a producer discarded this entry (EDropOldest) while we were reading it, try again
+		if (slot.sequence.load(std::memory_order_acquire) == seq && dequeuePos.load(std::memory_order_acquire) == pos)
+		{
+			pInterface = pPeeked;
+			return true;
+		}
+	}
+}
+
+// Returns the (approximate) number of entries waiting in the queue
+size_t UpdateQueue::size() const
+{
+	size_t tail = dequeuePos.load(std::memory_order_acquire);
+	size_t head = enqueuePos.load(std::memory_order_acquire);
+	return head > tail ? head - tail : 0;
+}
+
+// Removes all entries from the queue
+void UpdateQueue::clear()
+{
+	const DBusInterface *pInterface;
+	while (pop(pInterface))
+	{
+		release(pInterface);
+	}
+}
+
+}; // namespace ggk
@@ -0,0 +1,243 @@
+// Copyright 2017-2019 Paul Nettle
+//
+// This file is part of Gobbledegook.
+//
+// Use of this source code is governed by a BSD-style license that can be found
+// in the LICENSE file in the root of the source tree.
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// >>
+// >>>  INSIDE THIS FILE
+// >>
+//
+// A bounded, lock-free queue of pending interface updates
+//
+// >>
+// >>>  DISCUSSION
+// >>
+//
+// See the discussion at the top of UpdateQueue.cpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "../include/Gobbledegook.h"
+
+namespace ggk {
+
+//
+// Forward declarations
+//
+
+struct DBusInterface;
+
+//
+// Implementation
+//
+
+struct UpdateQueue
+{
+	//
+	// Constants
+	//
+
+	// The maximum number of pending updates
+	//
+	// This must be a power of two
+	static const size_t kCapacity = 1024;
+
+	// The largest number of updates that can be processed in a single batch, and the default batch size
+	static const int kMaxBatchSize = 256;
+	static const int kDefaultBatchSize = 32;
+
+	// Number of buckets in the batch latency histogram
+	//
+	// Bucket 0 counts batches that completed in under 2us, bucket `n` counts [2^n, 2^(n+1)) microseconds and the last bucket
+	// counts everything above that.
+	static const int kLatencyBuckets = 16;
+
+	//
+	// Types
+	//
+
+	// An update as it is removed from the queue
+	struct Entry
+	{
+		const DBusInterface *pInterface;
+
+		// Monotonic time (in microseconds) at which the update was pushed
+		int64_t pushTimeUS;
+	};
+
+	// A single slot within the ring
+	//
+	// The sequence number tells producers and the consumer whether the slot is free to write (sequence == position) or holds a
+	// value ready to be read (sequence == position + 1)
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		std::atomic<const DBusInterface *> pInterface;
+		std::atomic<int64_t> pushTimeUS;
+	};
+
+	//
+	// Accessors
+	//
+
+	// Returns the instance to this singleton class
+	static UpdateQueue &getInstance()
+	{
+		static UpdateQueue instance;
+		return instance;
+	}
+
+	// Returns the current overflow policy
+	GGKUpdateQueueOverflowPolicy getOverflowPolicy() const { return overflowPolicy.load(std::memory_order_relaxed); }
+
+	// Sets the policy used when a push finds the queue full
+	void setOverflowPolicy(GGKUpdateQueueOverflowPolicy policy) { overflowPolicy.store(policy, std::memory_order_relaxed); }
+
+	// Returns the number of updates that were discarded because the queue was full
+	uint64_t getDropCount() const { return dropCount.load(std::memory_order_relaxed); }
+
+	// Returns true if updates to an interface that already has an update pending are collapsed into the pending update
+	bool getCoalescing() const { return coalescing.load(std::memory_order_relaxed); }
+
+	// Enables or disables update coalescing
+	void setCoalescing(bool enabled) { coalescing.store(enabled, std::memory_order_relaxed); }
+
+	// Returns the number of updates that were collapsed into an already-pending update
+	uint64_t getCoalescedCount() const { return coalescedCount.load(std::memory_order_relaxed); }
+
+	// Returns the maximum number of updates processed per main loop iteration
+	int getBatchSize() const { return batchSize.load(std::memory_order_relaxed); }
+
+	// Sets the maximum number of updates processed per main loop iteration (clamped to [1, kMaxBatchSize])
+	void setBatchSize(int size);
+
+	// Copies the batch latency histogram into `pBuckets` (up to `bucketCount` entries)
+	//
+	// Returns the number of buckets copied
+	int getLatencyHistogram(uint64_t *pBuckets, int bucketCount) const;
+
+	// Records the latency of a batch, measured from the push of its oldest update until processing completed
+	void recordBatchLatency(int64_t latencyUS);
+
+	// Returns the current monotonic time in microseconds, as used for `Entry::pushTimeUS`
+	static int64_t nowUS();
+
+	// Returns the file descriptor that becomes readable when updates are waiting
+	//
+	// The server thread watches this descriptor from its main loop (see `runServerThread`)
+	int getWakeFd() const { return wakeFd; }
+
+	//
+	// Consumer wakeup
+	//
+
+	// Signal the consumer that updates are waiting
+	//
+	// Only the first call after `acknowledgeWake()` touches the descriptor, so a burst of pushes costs a single write.
+	void wake();
+
+	// Called by the consumer when it is woken, before draining the queue
+	//
+	// This clears the pending wakeup so that any push from this point on will wake the consumer again.
+	void acknowledgeWake();
+
+	//
+	// Queue management
+	//
+
+	// Adds an update for the given interface to the queue
+	//
+	// This method is safe to call from any number of threads concurrently.
+	//
+	// Returns true if the update was queued (or, with coalescing enabled, collapsed into an update that is queued.) If the queue is
+	// full, the overflow policy decides whether the new entry (EDropNewest) or the oldest pending entry (EDropOldest) is discarded;
+	// in either case the drop counter is incremented.
+	bool push(const DBusInterface *pInterface);
+
+	// Removes the oldest update from the queue, storing its interface in `pInterface`
+	//
+	// Returns true if an entry was removed, or false if the queue was empty
+	bool pop(const DBusInterface *&pInterface);
+
+	// Removes the oldest update from the queue, storing it in `entry`
+	//
+	// Returns true if an entry was removed, or false if the queue was empty
+	bool pop(Entry &entry);
+
+	// Removes up to `maxCount` of the oldest updates from the queue, in order, storing them in `pEntries`
+	//
+	// Returns the number of entries removed
+	int popBatch(Entry *pEntries, int maxCount);
+
+	// Retrieves the oldest update from the queue without removing it
+	//
+	// This should only be called from the consumer. Returns true if an entry was retrieved, or false if the queue was empty
+	bool peek(const DBusInterface *&pInterface) const;
+
+	// Releases the pending state of an update that has been removed from the queue
+	//
+	// With coalescing enabled, further pushes for an interface are collapsed until this is called. The consumer calls it just
+	// before processing an update; it is also called for updates that are discarded.
+	void release(const DBusInterface *pInterface);
+
+	// Returns the (approximate) number of entries waiting in the queue
+	size_t size() const;
+
+	// Returns true if the queue is empty
+	bool empty() const { return size() == 0; }
+
+	// Removes all entries from the queue
+	void clear();
+
+private:
+
+	// Our constructor initializes the sequence numbers for each slot in the ring
+	UpdateQueue();
+
+	// Our destructor closes the wakeup descriptor
+	~UpdateQueue();
+
+	// Attempt to add an entry without applying the overflow policy
+	//
+	// If `markQueued` is set, the interface's pending state is set to EQueued once the entry is certain to be queued, but before
+	// the consumer can see it. Returns false if the queue is full
+	bool tryPush(const DBusInterface *pInterface, bool markQueued);
+
+	static const size_t kMask = kCapacity - 1;
+
+	// Our ring of slots
+	Slot slots[kCapacity];
+
+	// The next position to write (shared by all producers)
+	alignas(64) std::atomic<size_t> enqueuePos;
+
+	// The next position to read
+	alignas(64) std::atomic<size_t> dequeuePos;
+
+	// Overflow policy and statistics
+	std::atomic<GGKUpdateQueueOverflowPolicy> overflowPolicy;
+	std::atomic<uint64_t> dropCount;
+
+	// Coalescing configuration and statistics
+	std::atomic<bool> coalescing;
+	std::atomic<uint64_t> coalescedCount;
+
+	// Batch configuration and latency statistics
+	std::atomic<int> batchSize;
+	std::atomic<uint64_t> latencyHistogram[kLatencyBuckets];
+
+	// Our wakeup eventfd and whether a wakeup is already pending on it
+	int wakeFd;
+	std::atomic<bool> wakePending;
+};
+
+}; // namespace ggk
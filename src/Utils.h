@@ -35,6 +35,7 @@
 #include <vector>
 #include <string>
 #include <endian.h>
+#include <string.h>
 
 #include "DBusObjectPath.h"
 
@@ -64,6 +65,27 @@ struct Utils
 	// Trim from both ends (copying)
 	static std::string trim(const std::string &str);
 
+	// Hash and equality for C strings, so that a hash table can be searched with the `const char *` names that D-Bus gives us
+	// without first copying them into a std::string
+	struct CStringHash
+	{
+		size_t operator()(const char *pString) const
+		{
+			// FNV-1a
+			size_t hash = static_cast<size_t>(14695981039346656037ULL);
+			for (; *pString; ++pString)
+			{
+				hash = (hash ^ static_cast<unsigned char>(*pString)) * static_cast<size_t>(1099511628211ULL);
+			}
+			return hash;
+		}
+	};
+
+	struct CStringEqual
+	{
+		bool operator()(const char *pLeft, const char *pRight) const { return strcmp(pLeft, pRight) == 0; }
+	};
+
 	// -----------------------------------------------------------------------------------------------------------------------------
 	// Hex output functions
 	// -----------------------------------------------------------------------------------------------------------------------------